@@ -1,59 +1,160 @@
 #include "AAudioRender.h"
-#include "android/log.h"
+#include "Log.h"
+#include <time.h>
 
 
 #define LOG_TAG "AAudioRender"
-#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
-#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+
+
+// 每隔多少次回调检查一次 XRun 计数
+#define XRUN_CHECK_INTERVAL 16
 
 
 AAudioRender::AAudioRender() {
+    this->stream = nullptr;
     this->paused = false;
     this->sample_rate = 44100;
     this->channel_count = 2;
     this->format = AAUDIO_FORMAT_PCM_I16;
     this->callback = nullptr;
+    this->user_data = nullptr;
+    this->frames_per_burst = 0;
+    this->sharing_mode = AAUDIO_SHARING_MODE_SHARED;
+    this->last_xrun_count = 0;
+    this->callback_count = 0;
+    this->buffer_frames = 0;
 }
 
 AAudioRender::~AAudioRender() {
-    AAudioStream_close(stream);
+    stop();
 }
 
-int AAudioRender::start() {
+// 按共享模式打开音频流，失败返回 nullptr
+static AAudioStream* openStream(int32_t sampleRate, int32_t channelCount, aaudio_format_t format,
+                                aaudio_sharing_mode_t sharingMode,
+                                AAudioStream_dataCallback callback, void* userData) {
     AAudioStreamBuilder *builder;
     aaudio_result_t result = AAudio_createStreamBuilder(&builder);
     if (result != AAUDIO_OK) {
-        LOGE(LOG_TAG, "createStreamBuilder failed: %s", AAudio_convertResultToText(result));
-        return -1;
+        LOGE("createStreamBuilder failed: %s", AAudio_convertResultToText(result));
+        return nullptr;
     }
-    AAudioStreamBuilder_setSampleRate(builder, this->sample_rate);
-    AAudioStreamBuilder_setChannelCount(builder, this->channel_count);
-    AAudioStreamBuilder_setFormat(builder, this->format);
+    if (sampleRate > 0) {
+        AAudioStreamBuilder_setSampleRate(builder, sampleRate);
+    }
+    AAudioStreamBuilder_setChannelCount(builder, channelCount);
+    AAudioStreamBuilder_setFormat(builder, format);
     AAudioStreamBuilder_setPerformanceMode(builder, AAUDIO_PERFORMANCE_MODE_LOW_LATENCY);
-    AAudioStreamBuilder_setSharingMode(builder, AAUDIO_SHARING_MODE_SHARED);
+    AAudioStreamBuilder_setSharingMode(builder, sharingMode);
+    AAudioStreamBuilder_setDataCallback(builder, callback, userData);
+    AAudioStream* stream = nullptr;
+    result = AAudioStreamBuilder_openStream(builder, &stream);
+    AAudioStreamBuilder_delete(builder);
+    if (result != AAUDIO_OK) {
+        LOGW("openStream failed (sharing mode %d): %s", sharingMode, AAudio_convertResultToText(result));
+        return nullptr;
+    }
+    return stream;
+}
+
+int AAudioRender::start() {
     if (!this->callback) {
-        LOGE(LOG_TAG, "callback is nullptr");
+        LOGE("callback is nullptr");
         return -1;
     }
-    AAudioStreamBuilder_setDataCallback(builder, callback, user_data);
-    result = AAudioStreamBuilder_openStream(builder, &stream);
-    if (result != AAUDIO_OK) {
-        LOGE(LOG_TAG, "openStream failed: %s", AAudio_convertResultToText(result));
+    stop();
+    // 独占模式可能走 MMAP 通路，设备或其他应用占用时退回共享模式
+    AAudioStream* opened = openStream(sample_rate, channel_count, format, AAUDIO_SHARING_MODE_EXCLUSIVE, dataCallback, this);
+    if (!opened) {
+        opened = openStream(sample_rate, channel_count, format, AAUDIO_SHARING_MODE_SHARED, dataCallback, this);
+    }
+    if (!opened) {
         return -1;
     }
+    {
+        std::lock_guard<std::mutex> lock(stream_mtx);
+        stream = opened;
+    }
+    // 请求独占时设备也可能给出共享流，以实际结果为准
+    this->sharing_mode = AAudioStream_getSharingMode(stream);
+    if (AAudioStream_getFormat(stream) != this->format) {
+        LOGW("stream format %d differs from requested %d", AAudioStream_getFormat(stream), this->format);
+    }
     this->format = AAudioStream_getFormat(stream);
     this->channel_count = AAudioStream_getChannelCount(stream);
     this->sample_rate = AAudioStream_getSampleRate(stream);
-    result = AAudioStream_requestStart(stream);
+    this->frames_per_burst = AAudioStream_getFramesPerBurst(stream);
+    // 从两个 burst 开始，出现 XRun 时再逐个 burst 加大
+    this->last_xrun_count = 0;
+    int32_t initial = frames_per_burst > 0 ? frames_per_burst * 2 : AAudioStream_getBufferSizeInFrames(stream);
+    int32_t actual = AAudioStream_setBufferSizeInFrames(stream, initial);
+    this->buffer_frames = actual > 0 ? actual : AAudioStream_getBufferSizeInFrames(stream);
+    LOGI("AAudio stream: %d Hz, %d ch, burst %d, buffer %d/%d, %s", sample_rate, channel_count,
+         frames_per_burst, buffer_frames.load(), AAudioStream_getBufferCapacityInFrames(stream),
+         isExclusive() ? "exclusive" : "shared");
+    aaudio_result_t result = AAudioStream_requestStart(stream);
     if (result != AAUDIO_OK) {
-        LOGE(LOG_TAG, "requestStart failed: %s", AAudio_convertResultToText(result));
+        LOGE("requestStart failed: %s", AAudio_convertResultToText(result));
+        stop();
         return -1;
     }
-    AAudioStreamBuilder_delete(builder);
+    this->paused = false;
     return 0;
 }
 
+void AAudioRender::stop() {
+    std::lock_guard<std::mutex> lock(stream_mtx);
+    if (!stream) {
+        return;
+    }
+    AAudioStream_requestStop(stream);
+    AAudioStream_close(stream);
+    stream = nullptr;
+}
+
+bool AAudioRender::getPresentedPosition(int64_t* framePosition, int64_t* timeNs) {
+    std::lock_guard<std::mutex> lock(stream_mtx);
+    if (!stream) {
+        return false;
+    }
+    // 暂停或刚启动时还没有时间戳，返回 AAUDIO_ERROR_INVALID_STATE
+    return AAudioStream_getTimestamp(stream, CLOCK_MONOTONIC, framePosition, timeNs) == AAUDIO_OK;
+}
+
+aaudio_data_callback_result_t AAudioRender::dataCallback(AAudioStream* stream, void* userData,
+                                                         void* audioData, int32_t numFrames) {
+    AAudioRender* render = static_cast<AAudioRender*>(userData);
+    int ret = render->callback(stream, render->user_data, audioData, numFrames);
+    render->tuneBufferSize();
+    return ret == 0 ? AAUDIO_CALLBACK_RESULT_CONTINUE : AAUDIO_CALLBACK_RESULT_STOP;
+}
+
+// XRun 次数增加说明缓冲区不够，加大一个 burst，直到容量上限。只增不减，稳定后不再变化
+void AAudioRender::tuneBufferSize() {
+    if (++callback_count % XRUN_CHECK_INTERVAL != 0) {
+        return;
+    }
+    int32_t xruns = AAudioStream_getXRunCount(stream);
+    if (xruns <= last_xrun_count) {
+        return;
+    }
+    last_xrun_count = xruns;
+    int32_t capacity = AAudioStream_getBufferCapacityInFrames(stream);
+    int32_t current = AAudioStream_getBufferSizeInFrames(stream);
+    if (frames_per_burst <= 0 || current + frames_per_burst > capacity) {
+        return;
+    }
+    int32_t actual = AAudioStream_setBufferSizeInFrames(stream, current + frames_per_burst);
+    if (actual > 0) {
+        buffer_frames = actual;
+        LOGD("XRun %d, buffer size -> %d frames", xruns, actual);
+    }
+}
+
 int AAudioRender::flush() { // 用于清空缓冲区
+    if (!stream) {
+        return -1;
+    }
     const int64_t timeout = 100000000; //100ms
     AAudioStream_requestPause(stream);
     aaudio_result_t result = AAUDIO_OK;
@@ -78,7 +179,7 @@ int AAudioRender::flush() { // 用于清空缓冲区
 }
 
 int AAudioRender::pause(bool p) { // 暂停播放
-    if (p == paused) {
+    if (!stream || p == paused) {
         return 0;
     }
     if (p) {
@@ -1,10 +1,8 @@
 #include "ANWRender.h"
 #include <string.h>
-#include "android/log.h"
+#include "Log.h"
 
 #define LOG_TAG "ANWDisplay"
-#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
-#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
 
 
 ANWRender::ANWRender(ANativeWindow* window) {
@@ -0,0 +1,118 @@
+#include "AudioClock.h"
+#include <math.h>
+#include <time.h>
+
+// 平滑系数与直接对齐的偏差阈值（秒）
+#define CLOCK_SMOOTHING 0.1
+#define CLOCK_RESYNC_THRESHOLD 0.05
+
+SimulatedLatencySource::SimulatedLatencySource(int sampleRate, int latencyMs)
+        : latency_frames((int64_t)sampleRate * latencyMs / 1000) {}
+
+void SimulatedLatencySource::onFramesWritten(int64_t frames) {
+    int64_t now;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    now = (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+    written.fetch_add(frames, std::memory_order_relaxed);
+    write_time_ns.store(now, std::memory_order_relaxed);
+}
+
+bool SimulatedLatencySource::getPresentedPosition(int64_t* framePosition, int64_t* timeNs) {
+    int64_t time = write_time_ns.load(std::memory_order_relaxed);
+    int64_t position = written.load(std::memory_order_relaxed) - latency_frames;
+    if (time == 0 || position < 0) {
+        return false;
+    }
+    *framePosition = position;
+    *timeNs = time;
+    return true;
+}
+
+int64_t AudioClock::monotonicNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void AudioClock::reset(PresentationSource* presentationSource) {
+    std::lock_guard<std::mutex> lock(mtx);
+    source = presentationSource;
+    sample_rate = 0;
+    has_anchor = false;
+    paused = false;
+    has_offset = false;
+    paused_value = NAN;
+    ring_read = 0;
+    written = 0;
+    latency_us = 0;
+}
+
+void AudioClock::setSampleRate(int sampleRate) {
+    std::lock_guard<std::mutex> lock(mtx);
+    sample_rate = sampleRate;
+}
+
+void AudioClock::setAnchor(int64_t ringFrame, double pts) {
+    std::lock_guard<std::mutex> lock(mtx);
+    anchor_frame = ringFrame;
+    anchor_pts = pts;
+    has_anchor = true;
+}
+
+void AudioClock::onCallback(int64_t ringFrame, int64_t deviceFrame) {
+    ring_read.store(ringFrame, std::memory_order_relaxed);
+    written.store(deviceFrame, std::memory_order_relaxed);
+}
+
+void AudioClock::setPaused(bool p) {
+    double value = p ? now() : NAN;
+    std::lock_guard<std::mutex> lock(mtx);
+    paused = p;
+    paused_value = value;
+    // 恢复后时间戳重新开始推进，重新对齐
+    has_offset = false;
+}
+
+double AudioClock::mediaTimeAt(int64_t ringFrame) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (!has_anchor || sample_rate <= 0) {
+        return NAN;
+    }
+    return anchor_pts + (double)(ringFrame - anchor_frame) / sample_rate;
+}
+
+double AudioClock::now() {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (paused) {
+        return paused_value;
+    }
+    if (!has_anchor || sample_rate <= 0) {
+        return NAN;
+    }
+    int64_t now_ns = monotonicNs();
+    int64_t ring_frame = ring_read.load(std::memory_order_relaxed);
+    int64_t written_frames = written.load(std::memory_order_relaxed);
+    int64_t position, time_ns;
+    if (source && source->getPresentedPosition(&position, &time_ns)) {
+        // 时间戳之后按采样率外推到现在；仍在设备缓冲中的帧还没有被听到
+        int64_t presented = position + (now_ns - time_ns) * sample_rate / 1000000000;
+        int64_t pending = written_frames - presented;
+        if (pending < 0) {
+            pending = 0;
+        }
+        latency_us = pending * 1000000 / sample_rate;
+        // 设备缓冲中补的静音不来自环形缓冲区，欠载时这里会略微偏早
+        ring_frame -= pending;
+    }
+    double media = anchor_pts + (double)(ring_frame - anchor_frame) / sample_rate;
+
+    double offset = media - now_ns / 1e9;
+    if (!has_offset || fabs(offset - smoothed_offset) > CLOCK_RESYNC_THRESHOLD) {
+        smoothed_offset = offset;
+        has_offset = true;
+    } else {
+        smoothed_offset += (offset - smoothed_offset) * CLOCK_SMOOTHING;
+    }
+    return now_ns / 1e9 + smoothed_offset;
+}
@@ -0,0 +1,99 @@
+#include "AudioCrossfade.h"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+void AudioCrossfade::configure(int sampleRate, int channelCount, int durationMs) {
+    channels = channelCount;
+    window = (size_t)((int64_t)sampleRate * durationMs / 1000) * channels;
+    tail.assign(window, 0);
+    fade_from.assign(window, 0);
+    mixed.assign(window, 0);
+    reset();
+}
+
+void AudioCrossfade::take(size_t count, int16_t* dst) {
+    size_t first = std::min(count, window - tail_start);
+    memcpy(dst, tail.data() + tail_start, first * sizeof(int16_t));
+    memcpy(dst + first, tail.data(), (count - first) * sizeof(int16_t));
+    tail_start = (tail_start + count) % window;
+    tail_size -= count;
+}
+
+void AudioCrossfade::append(const int16_t* in, size_t count, std::vector<int16_t>& out) {
+    // 先输出为容纳新数据需要挤出的最早数据，新数据比整个窗口还长时超出的部分直接输出
+    size_t overflow = tail_size + count > window ? tail_size + count - window : 0;
+    size_t from_tail = std::min(overflow, tail_size);
+    if (from_tail > 0) {
+        size_t offset = out.size();
+        out.resize(offset + from_tail);
+        take(from_tail, out.data() + offset);
+    }
+    size_t direct = overflow - from_tail;
+    out.insert(out.end(), in, in + direct);
+    in += direct;
+    count -= direct;
+    size_t end = (tail_start + tail_size) % window;
+    size_t first = std::min(count, window - end);
+    memcpy(tail.data() + end, in, first * sizeof(int16_t));
+    memcpy(tail.data(), in + first, (count - first) * sizeof(int16_t));
+    tail_size += count;
+}
+
+void AudioCrossfade::process(const int16_t* in, int frames, std::vector<int16_t>& out) {
+    size_t count = (size_t)frames * channels;
+    if (window == 0) {
+        out.insert(out.end(), in, in + count);
+        return;
+    }
+    size_t i = 0;
+    // 淡化期间：上一项尾部淡出，当前输入淡入
+    if (fade_pos < fade_size) {
+        size_t n = std::min(fade_size - fade_pos, count) / channels * channels;
+        float fade_frames = (float)(fade_size / channels);
+        for (; i < n; i += channels) {
+            float t = (float)(fade_pos / channels) / fade_frames;
+            float gain_out = cosf(t * (float)M_PI_2);
+            float gain_in = sinf(t * (float)M_PI_2);
+            for (int c = 0; c < channels; c++, fade_pos++) {
+                float value = fade_from[fade_pos] * gain_out + in[i + c] * gain_in;
+                mixed[i + c] = (int16_t)std::max(-32768.0f, std::min(32767.0f, value));
+            }
+        }
+        append(mixed.data(), n, out);
+        if (fade_pos >= fade_size) {
+            fade_size = 0;
+            fade_pos = 0;
+        }
+    }
+    append(in + i, count - i, out);
+}
+
+void AudioCrossfade::markBoundary() {
+    if (window == 0) {
+        return;
+    }
+    // 上一项短于淡化窗口时，上一次淡化尚未结束，剩余的更早一项的尾部直接丢弃
+    fade_size = tail_size;
+    fade_pos = 0;
+    take(tail_size, fade_from.data());
+}
+
+void AudioCrossfade::reset() {
+    tail_start = 0;
+    tail_size = 0;
+    fade_size = 0;
+    fade_pos = 0;
+}
+
+void AudioCrossfade::flush(std::vector<int16_t>& out) {
+    if (fade_pos < fade_size) {
+        out.insert(out.end(), fade_from.begin() + fade_pos, fade_from.begin() + fade_size);
+    }
+    if (tail_size > 0) {
+        size_t offset = out.size();
+        out.resize(offset + tail_size);
+        take(tail_size, out.data() + offset);
+    }
+    reset();
+}
@@ -0,0 +1,347 @@
+#include "AudioDsp.h"
+#include "Log.h"
+#include <math.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#define LOG_TAG "AudioDsp"
+
+// middle 中表示有未取走的新设置
+#define SETTINGS_DIRTY 4
+// 增益平滑、限幅释放的时间常数与限幅前视时长
+#define GAIN_SMOOTH_MS 20
+#define LIMITER_RELEASE_MS 50
+#define LIMITER_LOOKAHEAD_MS 5
+
+AudioDsp::AudioDsp() : middle(2) {
+    memset(groups, 0, sizeof(groups));
+}
+
+void AudioDsp::setGainDb(float db) {
+    std::lock_guard<std::mutex> lock(settings_mutex);
+    pending.gain_db = db;
+    publish();
+}
+
+void AudioDsp::setBand(int index, BandType type, float freq, float gainDb, float q) {
+    if (index < 0 || index >= MAX_BANDS) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(settings_mutex);
+    Band& band = pending.bands[index];
+    band.type = type;
+    band.freq = freq;
+    band.gain_db = gainDb;
+    band.q = q;
+    publish();
+}
+
+void AudioDsp::setLimiter(bool enabled, float thresholdDb) {
+    std::lock_guard<std::mutex> lock(settings_mutex);
+    pending.limiter = enabled;
+    pending.threshold_db = std::min(thresholdDb, 0.0f);
+    publish();
+}
+
+// 在 settings_mutex 内调用
+void AudioDsp::publish() {
+    buffers[back] = pending;
+    back = middle.exchange(back | SETTINGS_DIRTY, std::memory_order_acq_rel) & 3;
+}
+
+void AudioDsp::pollSettings() {
+    if (middle.load(std::memory_order_acquire) & SETTINGS_DIRTY) {
+        front = middle.exchange(front, std::memory_order_acq_rel) & 3;
+        force_apply = true;
+    }
+    if (force_apply && sample_rate > 0) {
+        apply(buffers[front]);
+        force_apply = false;
+    }
+}
+
+// RBJ Audio EQ Cookbook 的峰值与搁架滤波器，按 a0 归一化
+static void designBiquad(int type, float freq, float gainDb, float q, int sampleRate,
+                         float* b0, float* b1, float* b2, float* a1, float* a2) {
+    if (type == AudioDsp::BAND_OFF) {
+        *b0 = 1.0f;
+        *b1 = *b2 = *a1 = *a2 = 0.0f;
+        return;
+    }
+    double A = pow(10.0, gainDb / 40.0);
+    double w0 = 2 * M_PI * std::min(std::max((double)freq, 10.0), sampleRate * 0.49) / sampleRate;
+    double cs = cos(w0);
+    double alpha = sin(w0) / (2 * std::max((double)q, 0.05));
+    double sa = 2 * sqrt(A) * alpha;
+    double nb0, nb1, nb2, na0, na1, na2;
+    if (type == AudioDsp::BAND_LOW_SHELF) {
+        nb0 = A * ((A + 1) - (A - 1) * cs + sa);
+        nb1 = 2 * A * ((A - 1) - (A + 1) * cs);
+        nb2 = A * ((A + 1) - (A - 1) * cs - sa);
+        na0 = (A + 1) + (A - 1) * cs + sa;
+        na1 = -2 * ((A - 1) + (A + 1) * cs);
+        na2 = (A + 1) + (A - 1) * cs - sa;
+    } else if (type == AudioDsp::BAND_HIGH_SHELF) {
+        nb0 = A * ((A + 1) + (A - 1) * cs + sa);
+        nb1 = -2 * A * ((A - 1) + (A + 1) * cs);
+        nb2 = A * ((A + 1) + (A - 1) * cs - sa);
+        na0 = (A + 1) - (A - 1) * cs + sa;
+        na1 = 2 * ((A - 1) - (A + 1) * cs);
+        na2 = (A + 1) - (A - 1) * cs - sa;
+    } else {
+        nb0 = 1 + alpha * A;
+        nb1 = -2 * cs;
+        nb2 = 1 - alpha * A;
+        na0 = 1 + alpha / A;
+        na1 = -2 * cs;
+        na2 = 1 - alpha / A;
+    }
+    *b0 = (float)(nb0 / na0);
+    *b1 = (float)(nb1 / na0);
+    *b2 = (float)(nb2 / na0);
+    *a1 = (float)(na1 / na0);
+    *a2 = (float)(na2 / na0);
+}
+
+void AudioDsp::apply(const Settings& settings) {
+    gain_target = powf(10.0f, settings.gain_db / 20.0f);
+
+    int active = 0;
+    for (int i = 0; i < MAX_BANDS; i++) {
+        if (settings.bands[i].type != BAND_OFF) {
+            active = i + 1;
+        }
+    }
+    int count = (active + LANES - 1) / LANES;
+    for (int g = 0; g < count; g++) {
+        BiquadGroup& group = groups[g];
+        // 新启用的组从零状态开始，已在运行的组只换系数
+        if (g >= group_count) {
+            memset(&group, 0, sizeof(group));
+        }
+        for (int k = 0; k < LANES; k++) {
+            const Band& band = settings.bands[g * LANES + k];
+            designBiquad(band.type, band.freq, band.gain_db, band.q, sample_rate,
+                         &group.b0[k], &group.b1[k], &group.b2[k], &group.a1[k], &group.a2[k]);
+        }
+    }
+    group_count = count;
+
+    if (settings.limiter && !limiter) {
+        for (int ch = 0; ch < CHANNELS; ch++) {
+            std::fill(delay[ch].begin(), delay[ch].end(), 0.0f);
+        }
+        peak_head = 0;
+        peak_size = 0;
+        limiter_gain = 1.0f;
+        attack_end = -1;
+    }
+    limiter = settings.limiter && lookahead > 0;
+    threshold = powf(10.0f, settings.threshold_db / 20.0f);
+}
+
+void AudioDsp::configure(int sampleRate) {
+#if defined(__SSE2__)
+    // 滤波器在静音时衰减到非规格化数，x86 上会慢几十倍，本线程上按零处理（FTZ | DAZ）
+    _mm_setcsr(_mm_getcsr() | 0x8040);
+#endif
+    sample_rate = sampleRate;
+    gain_coeff = 1.0f - expf(-1000.0f / (GAIN_SMOOTH_MS * (float)sampleRate));
+    release_coeff = 1.0f - expf(-1000.0f / (LIMITER_RELEASE_MS * (float)sampleRate));
+    lookahead = sampleRate * LIMITER_LOOKAHEAD_MS / 1000;
+    for (int ch = 0; ch < CHANNELS; ch++) {
+        delay[ch].assign(lookahead, 0.0f);
+    }
+    peak_value.assign(lookahead + 1, 0.0f);
+    peak_index.assign(lookahead + 1, 0);
+    peak_head = 0;
+    peak_size = 0;
+    delay_pos = 0;
+    frame_index = 0;
+    limiter_gain = 1.0f;
+    attack_end = -1;
+    limiter = false;
+    gain = gain_target;
+    memset(groups, 0, sizeof(groups));
+    group_count = 0;
+    force_apply = true;
+}
+
+// 一组 4 段流水线处理一个声道：每一步把上一步各段的输出右移一个通道作为下一段的输入，
+// 第 0 通道移入新采样，第 3 通道输出的是 3 步之前那个采样经过 4 段后的结果
+void AudioDsp::runGroup(BiquadGroup& group, int channel, float* x, int frames) {
+#if defined(__SSE2__)
+    const __m128 b0 = _mm_loadu_ps(group.b0), b1 = _mm_loadu_ps(group.b1), b2 = _mm_loadu_ps(group.b2);
+    const __m128 a1 = _mm_loadu_ps(group.a1), a2 = _mm_loadu_ps(group.a2);
+    __m128 z1 = _mm_loadu_ps(group.z1[channel]);
+    __m128 z2 = _mm_loadu_ps(group.z2[channel]);
+    __m128 y = _mm_loadu_ps(group.y[channel]);
+    for (int i = 0; i < frames; i++) {
+        __m128 in = _mm_or_ps(_mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(y), 4)), _mm_set_ss(x[i]));
+        y = _mm_add_ps(_mm_mul_ps(b0, in), z1);
+        z1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(b1, in), _mm_mul_ps(a1, y)), z2);
+        z2 = _mm_sub_ps(_mm_mul_ps(b2, in), _mm_mul_ps(a2, y));
+        x[i] = _mm_cvtss_f32(_mm_shuffle_ps(y, y, _MM_SHUFFLE(3, 3, 3, 3)));
+    }
+    _mm_storeu_ps(group.z1[channel], z1);
+    _mm_storeu_ps(group.z2[channel], z2);
+    _mm_storeu_ps(group.y[channel], y);
+#elif defined(__ARM_NEON)
+    const float32x4_t b0 = vld1q_f32(group.b0), b1 = vld1q_f32(group.b1), b2 = vld1q_f32(group.b2);
+    const float32x4_t a1 = vld1q_f32(group.a1), a2 = vld1q_f32(group.a2);
+    float32x4_t z1 = vld1q_f32(group.z1[channel]);
+    float32x4_t z2 = vld1q_f32(group.z2[channel]);
+    float32x4_t y = vld1q_f32(group.y[channel]);
+    for (int i = 0; i < frames; i++) {
+        float32x4_t in = vextq_f32(vdupq_n_f32(x[i]), y, 3);
+        y = vaddq_f32(vmulq_f32(b0, in), z1);
+        z1 = vaddq_f32(vsubq_f32(vmulq_f32(b1, in), vmulq_f32(a1, y)), z2);
+        z2 = vsubq_f32(vmulq_f32(b2, in), vmulq_f32(a2, y));
+        x[i] = vgetq_lane_f32(y, 3);
+    }
+    vst1q_f32(group.z1[channel], z1);
+    vst1q_f32(group.z2[channel], z2);
+    vst1q_f32(group.y[channel], y);
+#else
+    float* z1 = group.z1[channel];
+    float* z2 = group.z2[channel];
+    float* y = group.y[channel];
+    for (int i = 0; i < frames; i++) {
+        float in[LANES] = {x[i], y[0], y[1], y[2]};
+        for (int k = 0; k < LANES; k++) {
+            y[k] = group.b0[k] * in[k] + z1[k];
+            z1[k] = group.b1[k] * in[k] - group.a1[k] * y[k] + z2[k];
+            z2[k] = group.b2[k] * in[k] - group.a2[k] * y[k];
+        }
+        x[i] = y[LANES - 1];
+    }
+#endif
+}
+
+// 前视限幅：输出延迟 lookahead 帧，增益取延迟线中所有帧（立体声联动）的峰值所需的增益，
+// 峰值进入窗口后在其输出前逐帧压低，离开后按释放时间常数恢复
+void AudioDsp::limit(int frames) {
+    const int capacity = lookahead + 1;
+    for (int i = 0; i < frames; i++) {
+        float left = buf[0][i];
+        float right = buf[1][i];
+        float peak = std::max(fabsf(left), fabsf(right));
+        // 单调递减队列：先移出窗口外的，再从尾部移除不大于新峰值的项
+        if (peak_size > 0 && peak_index[peak_head] < frame_index - lookahead) {
+            peak_head = (peak_head + 1) % capacity;
+            peak_size--;
+        }
+        while (peak_size > 0 && peak_value[(peak_head + peak_size - 1) % capacity] <= peak) {
+            peak_size--;
+        }
+        int tail = (peak_head + peak_size) % capacity;
+        peak_value[tail] = peak;
+        peak_index[tail] = frame_index;
+        peak_size++;
+
+        float window = peak_value[peak_head];
+        float desired = window > threshold ? threshold / window : 1.0f;
+        if (desired < limiter_gain) {
+            // 在峰值输出之前的几帧内线性压低，输出到峰值时正好达到所需增益；
+            // 上一段压低尚未结束时不放缓，保证先到的峰值同样被压住
+            int64_t peak_out = peak_index[peak_head] + lookahead;
+            float step = (limiter_gain - desired) / (float)(peak_out - frame_index + 1);
+            if (frame_index <= attack_end) {
+                step = std::max(step, attack_step);
+            }
+            attack_step = step;
+            attack_end = std::max(attack_end, peak_out);
+            limiter_gain = std::max(limiter_gain - step, desired);
+        } else {
+            limiter_gain += (desired - limiter_gain) * release_coeff;
+        }
+        buf[0][i] = delay[0][delay_pos] * limiter_gain;
+        buf[1][i] = delay[1][delay_pos] * limiter_gain;
+        delay[0][delay_pos] = left;
+        delay[1][delay_pos] = right;
+        delay_pos = (delay_pos + 1) % lookahead;
+        frame_index++;
+    }
+}
+
+void AudioDsp::process(int16_t* pcm, int frames) {
+    pollSettings();
+    if (sample_rate == 0 || (gain == 1.0f && gain_target == 1.0f && group_count == 0 && !limiter)) {
+        return;
+    }
+    for (int offset = 0; offset < frames; offset += CHUNK_FRAMES) {
+        int n = std::min(CHUNK_FRAMES, frames - offset);
+        int16_t* chunk = pcm + offset * CHANNELS;
+        for (int i = 0; i < n; i++) {
+            buf[0][i] = chunk[i * CHANNELS] * (1.0f / 32768.0f);
+            buf[1][i] = chunk[i * CHANNELS + 1] * (1.0f / 32768.0f);
+        }
+        if (gain != gain_target) {
+            for (int i = 0; i < n; i++) {
+                gain += (gain_target - gain) * gain_coeff;
+                buf[0][i] *= gain;
+                buf[1][i] *= gain;
+            }
+            if (fabsf(gain - gain_target) < 1e-5f) {
+                gain = gain_target;
+            }
+        } else if (gain != 1.0f) {
+            for (int i = 0; i < n; i++) {
+                buf[0][i] *= gain;
+                buf[1][i] *= gain;
+            }
+        }
+        for (int g = 0; g < group_count; g++) {
+            runGroup(groups[g], 0, buf[0], n);
+            runGroup(groups[g], 1, buf[1], n);
+        }
+        if (limiter) {
+            limit(n);
+        }
+        for (int i = 0; i < n; i++) {
+            for (int ch = 0; ch < CHANNELS; ch++) {
+                float v = std::min(std::max(buf[ch][i] * 32768.0f, -32768.0f), 32767.0f);
+                chunk[i * CHANNELS + ch] = (int16_t)lrintf(v);
+            }
+        }
+    }
+}
+
+double AudioDsp::benchmark(int bands, bool limiter, int blocks) {
+    AudioDsp dsp;
+    dsp.configure(48000);
+    dsp.setGainDb(3.0f);
+    bands = std::min(std::max(bands, 0), MAX_BANDS);
+    for (int b = 0; b < bands; b++) {
+        dsp.setBand(b, BAND_PEAK, 60.0f * powf(2.0f, b * 1.2f), b % 2 ? 4.0f : -4.0f, 1.0f);
+    }
+    dsp.setLimiter(limiter, -1.0f);
+
+    std::vector<int16_t> source(CHUNK_FRAMES * CHANNELS);
+    for (int i = 0; i < CHUNK_FRAMES; i++) {
+        source[i * CHANNELS] = (int16_t)(30000 * sin(2 * M_PI * 440 * i / 48000.0));
+        source[i * CHANNELS + 1] = (int16_t)(30000 * sin(2 * M_PI * 660 * i / 48000.0));
+    }
+    std::vector<int16_t> block(source);
+    dsp.process(block.data(), CHUNK_FRAMES);   // 取走设置并预热
+
+    int64_t total_ns = 0;
+    for (int b = 0; b < blocks; b++) {
+        memcpy(block.data(), source.data(), source.size() * sizeof(int16_t));
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        dsp.process(block.data(), CHUNK_FRAMES);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        total_ns += (int64_t)(end.tv_sec - start.tv_sec) * 1000000000 + (end.tv_nsec - start.tv_nsec);
+    }
+    double per_block = blocks > 0 ? (double)total_ns / blocks : 0;
+    LOGI("DSP 测试：%d 段均衡，限幅%s，%.0f ns/块（%d 帧）", bands, limiter ? "开" : "关", per_block, CHUNK_FRAMES);
+    return per_block;
+}
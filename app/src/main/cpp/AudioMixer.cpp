@@ -0,0 +1,285 @@
+#include "AudioMixer.h"
+#include "AAudioRender.h"
+#include "Log.h"
+#include "PlayerStats.h"
+#include "Trace.h"
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#define LOG_TAG "AudioMixer"
+
+namespace AudioMixer {
+
+namespace {
+
+const int CHANNELS = 2;
+const int CHUNK_FRAMES = 1024;          // 回调按块处理，临时缓冲区大小固定
+const int RAMP_MS = 10;                 // 增益从0到1的渐变时长
+const int REMOVE_TIMEOUT_MS = 500;
+
+// 槽位状态。控制端 FREE -> ACTIVE -> REMOVING，回调渐变到静音后置为 REMOVED，控制端再回收为 FREE
+enum SlotState {
+    SLOT_FREE,
+    SLOT_ACTIVE,
+    SLOT_REMOVING,
+    SLOT_REMOVED,
+};
+
+struct Source {
+    std::atomic<int> state{SLOT_FREE};
+    PcmRing* ring = nullptr;
+    Listener listener = nullptr;
+    void* opaque = nullptr;
+    std::atomic<float> target_gain{0.0f};
+    std::atomic<bool> paused{false};
+    std::atomic<bool> discard{false};
+    float gain = 0.0f;                  // 当前增益，只在回调线程上访问
+};
+
+std::mutex mixer_mutex;                 // 控制端互斥：打开输出流、分配与回收槽位
+AAudioRender render;
+bool started = false;
+std::atomic<int32_t> output_rate(0);
+Source sources[MAX_SOURCES];
+int16_t scratch[CHUNK_FRAMES * CHANNELS];
+float ramp_step = 0.0f;                 // 每帧的增益变化量
+int64_t frames_written = 0;             // 输出流启动以来写给设备的帧数，只在回调线程上访问
+std::atomic<bool> in_callback(false);   // 回调正在执行
+std::atomic<int64_t> callbacks_done(0); // 已结束的回调次数
+
+// Q15 定点增益，结果向下取整
+void scaleQ15(int16_t* pcm, int samples, int16_t gain) {
+    int i = 0;
+#if defined(__SSE2__)
+    const __m128i g = _mm_set1_epi16(gain);
+    for (; i + 8 <= samples; i += 8) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(pcm + i));
+        // 32 位乘积右移 15 位：高 16 位左移一位，拼上低 16 位的最高位
+        __m128i hi = _mm_mulhi_epi16(x, g);
+        __m128i lo = _mm_mullo_epi16(x, g);
+        _mm_storeu_si128((__m128i*)(pcm + i), _mm_or_si128(_mm_slli_epi16(hi, 1), _mm_srli_epi16(lo, 15)));
+    }
+#elif defined(__ARM_NEON)
+    for (; i + 8 <= samples; i += 8) {
+        vst1q_s16(pcm + i, vqdmulhq_n_s16(vld1q_s16(pcm + i), gain));
+    }
+#endif
+    for (; i < samples; i++) {
+        pcm[i] = (int16_t)((pcm[i] * gain) >> 15);
+    }
+}
+
+// 饱和相加到 out
+void mixAdd(int16_t* out, const int16_t* in, int samples) {
+    int i = 0;
+#if defined(__SSE2__)
+    for (; i + 8 <= samples; i += 8) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(out + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(in + i));
+        _mm_storeu_si128((__m128i*)(out + i), _mm_adds_epi16(a, b));
+    }
+#elif defined(__ARM_NEON)
+    for (; i + 8 <= samples; i += 8) {
+        vst1q_s16(out + i, vqaddq_s16(vld1q_s16(out + i), vld1q_s16(in + i)));
+    }
+#endif
+    for (; i < samples; i++) {
+        out[i] = (int16_t)std::min(32767, std::max(-32768, out[i] + in[i]));
+    }
+}
+
+// 渐变部分逐帧计算，到达目标后整段按定点增益缩放，增益为1时不处理
+void applyGain(int16_t* pcm, int frames, float* gain, float target) {
+    int i = 0;
+    for (; i < frames && *gain != target; i++) {
+        float g = *gain;
+        g = target > g ? std::min(g + ramp_step, target) : std::max(g - ramp_step, target);
+        *gain = g;
+        pcm[i * CHANNELS] = (int16_t)(pcm[i * CHANNELS] * g);
+        pcm[i * CHANNELS + 1] = (int16_t)(pcm[i * CHANNELS + 1] * g);
+    }
+    if (i < frames && target < 1.0f) {
+        scaleQ15(pcm + i * CHANNELS, (frames - i) * CHANNELS, (int16_t)(target * 32768));
+    }
+}
+
+int mixCallback(AAudioStream* /*stream*/, void* /*userData*/, void* audioData, int32_t numFrames) {
+    // 先标记再读取槽位状态，与 removeSource 先改状态再检查标记配对（均为顺序一致），两边至少有一方看到对方
+    in_callback.store(true);
+    ScopedStageTimer timer(Stage::AudioCallback);
+    TRACE_SCOPE("aaudio_callback");
+    int16_t* out = static_cast<int16_t*>(audioData);
+    memset(out, 0, (size_t)numFrames * CHANNELS * sizeof(int16_t));
+    for (Source& s : sources) {
+        int state = s.state.load(std::memory_order_acquire);
+        if (state != SLOT_ACTIVE && state != SLOT_REMOVING) {
+            continue;
+        }
+        // 环形缓冲区只能由消费端清空
+        if (s.discard.exchange(false, std::memory_order_acquire)) {
+            s.ring->clear();
+        }
+        float target = (state == SLOT_REMOVING || s.paused) ? 0.0f : s.target_gain.load(std::memory_order_relaxed);
+        bool underrun = false;
+        for (int offset = 0; offset < numFrames; offset += CHUNK_FRAMES) {
+            // 静音且不再渐变时不读取，暂停的来源保留未播放的数据
+            if (s.gain == 0.0f && target == 0.0f) {
+                break;
+            }
+            int frames = std::min(CHUNK_FRAMES, numFrames - offset);
+            int got = (int)(s.ring->read(scratch, (size_t)frames * CHANNELS) / CHANNELS);
+            underrun |= got < frames;
+            applyGain(scratch, got, &s.gain, target);
+            mixAdd(out + offset * CHANNELS, scratch, got * CHANNELS);
+        }
+        if (underrun && target > 0.0f) {
+            PlayerStats::increment(Counter::AudioUnderruns);
+        }
+        if (state == SLOT_REMOVING && s.gain == 0.0f) {
+            s.state.store(SLOT_REMOVED, std::memory_order_release);
+            continue;
+        }
+        if (s.listener) {
+            s.listener(s.opaque, (int64_t)(s.ring->totalRead() / CHANNELS), frames_written + numFrames);
+        }
+    }
+    frames_written += numFrames;
+    in_callback.store(false);
+    callbacks_done.fetch_add(1);
+    return 0;
+}
+
+bool startLocked() {
+    frames_written = 0;
+    render.configure(0, CHANNELS, AAUDIO_FORMAT_PCM_I16);
+    render.setCallback(mixCallback, nullptr);
+    if (render.start() != 0) {
+        LOGE("混音输出流启动失败");
+        return false;
+    }
+    ramp_step = 1000.0f / ((float)RAMP_MS * render.getSampleRate());
+    output_rate = render.getSampleRate();
+    started = true;
+    return true;
+}
+
+// 等到回调不在执行，或开始等待时正在执行的那一次已经结束。之后的回调都能看到等待前写入的槽位状态
+void waitCallbackIdle() {
+    int64_t done = callbacks_done.load();
+    while (in_callback.load() && callbacks_done.load() == done) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+Source* activeSource(int id) {
+    if (id < 0 || id >= MAX_SOURCES || sources[id].state.load(std::memory_order_acquire) != SLOT_ACTIVE) {
+        return nullptr;
+    }
+    return &sources[id];
+}
+
+}
+
+int addSource(PcmRing* ring, float gain, Listener listener, void* opaque) {
+    std::lock_guard<std::mutex> lock(mixer_mutex);
+    if (!started && !startLocked()) {
+        return -1;
+    }
+    for (int id = 0; id < MAX_SOURCES; id++) {
+        Source& s = sources[id];
+        if (s.state.load(std::memory_order_acquire) != SLOT_FREE) {
+            continue;
+        }
+        s.ring = ring;
+        s.listener = listener;
+        s.opaque = opaque;
+        s.gain = 0.0f;
+        s.target_gain = std::min(std::max(gain, 0.0f), 1.0f);
+        s.paused = false;
+        s.discard = false;
+        // release：回调看到 ACTIVE 时，上面的字段已写好
+        s.state.store(SLOT_ACTIVE, std::memory_order_release);
+        LOGI("添加来源 %d", id);
+        return id;
+    }
+    LOGW("来源已满（%d）", MAX_SOURCES);
+    return -1;
+}
+
+void removeSource(int id) {
+    std::lock_guard<std::mutex> lock(mixer_mutex);
+    Source* s = activeSource(id);
+    if (!s) {
+        return;
+    }
+    s->state.store(SLOT_REMOVING, std::memory_order_release);
+    // 等回调渐变到静音
+    int waited = 0;
+    while (s->state.load(std::memory_order_acquire) != SLOT_REMOVED && waited < REMOVE_TIMEOUT_MS) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        waited += 2;
+    }
+    if (s->state.load(std::memory_order_acquire) != SLOT_REMOVED) {
+        // 超时（如输出流不再回调）：直接置为 REMOVED 让之后的回调跳过，再等可能正在访问它的那次回调结束
+        s->state.store(SLOT_REMOVED);
+        waitCallbackIdle();
+    }
+    s->ring = nullptr;
+    s->listener = nullptr;
+    s->opaque = nullptr;
+    s->state.store(SLOT_FREE, std::memory_order_release);
+    LOGI("移除来源 %d", id);
+
+    // 最后一路来源移除后关闭输出流，不再占用（独占模式下的）设备，下一次 addSource 时重新打开。
+    // 关闭会等待进行中的回调返回
+    for (const Source& other : sources) {
+        if (other.state.load(std::memory_order_acquire) != SLOT_FREE) {
+            return;
+        }
+    }
+    render.stop();
+    started = false;
+    output_rate = 0;
+    LOGI("没有来源，关闭输出流");
+}
+
+void setGain(int id, float gain) {
+    Source* s = activeSource(id);
+    if (s) {
+        s->target_gain = std::min(std::max(gain, 0.0f), 1.0f);
+    }
+}
+
+void setPaused(int id, bool paused) {
+    Source* s = activeSource(id);
+    if (s) {
+        s->paused = paused;
+    }
+}
+
+void discard(int id) {
+    Source* s = activeSource(id);
+    if (s) {
+        s->discard.store(true, std::memory_order_release);
+    }
+}
+
+int32_t sampleRate() {
+    return output_rate;
+}
+
+PresentationSource* presentation() {
+    return &render;
+}
+
+}
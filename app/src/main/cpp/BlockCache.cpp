@@ -0,0 +1,424 @@
+#include "BlockCache.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <set>
+#include <string>
+#include <vector>
+#include "RangeFetcher.h"
+#include "Log.h"
+extern "C" {
+#include <libavutil/mem.h>
+}
+
+#define LOG_TAG "BlockCache"
+
+namespace {
+
+const uint32_t INDEX_MAGIC = 0x31434B42;   // "BKC1"
+const uint32_t INDEX_VERSION = 1;
+const int BLOCK_SIZE = 256 * 1024;
+const int IO_BUFFER_SIZE = 64 * 1024;
+// 打开时与文件头并行下载的文件尾长度，覆盖非 faststart MP4 放在末尾的 moov
+const int64_t TAIL_PREFETCH_BYTES = 1024 * 1024;
+
+// 索引文件头，后接每块一位的位图
+struct IndexHeader {
+    uint32_t magic;
+    uint32_t version;
+    int32_t block_size;
+    uint32_t reserved;
+    int64_t file_size;
+};
+
+std::mutex cache_mutex;
+std::string cache_dir;
+int64_t cache_capacity = 0;
+std::set<uint64_t> open_entries;    // 正在使用的条目，不会被淘汰，也不允许重复打开
+int fetch_connections = 4;
+int ahead_blocks = 8;
+
+// bitmap 由读取线程和下载线程共享，受 mtx 保护；数据文件用 pread/pwrite 按偏移读写，不需要加锁
+struct CachedFile {
+    std::string url;
+    uint64_t key = 0;
+    std::string data_path;
+    std::string index_path;
+    int data_fd = -1;
+    int index_fd = -1;
+    int64_t size = 0;
+    int64_t pos = 0;
+    std::mutex mtx;
+    std::condition_variable cond;
+    std::vector<uint8_t> bitmap;
+    int64_t error_index = -1;          // 最近一次下载失败的块及错误码
+    int error_code = 0;
+    bool stale = false;                // 源资源已变化，关闭时删除条目
+    const AVIOInterruptCB* interrupt = nullptr; // 所属 AVFormatContext 的中断回调，只在读取线程上调用
+    std::unique_ptr<RangeFetcher> fetcher;
+    std::vector<uint8_t> block;        // 当前块的内容，只由读取线程访问
+    int64_t block_index = -1;
+    int block_len = 0;
+    int64_t hits = 0;
+    int64_t misses = 0;
+};
+
+uint64_t fnv1a(const std::string& s) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : s) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+std::string entryPath(uint64_t key, const char* ext) {
+    char name[40];
+    snprintf(name, sizeof(name), "/%016llx.%s", (unsigned long long)key, ext);
+    return cache_dir + name;
+}
+
+int64_t blockCount(int64_t size) {
+    return (size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+}
+
+bool isCached(const CachedFile* file, int64_t index) {
+    return file->bitmap[index / 8] & (1 << (index % 8));
+}
+
+// 清空条目并按新的资源大小重写索引
+bool resetEntry(CachedFile* file, int64_t size) {
+    file->size = size;
+    file->bitmap.assign((size_t)((blockCount(size) + 7) / 8), 0);
+    IndexHeader header = {INDEX_MAGIC, INDEX_VERSION, BLOCK_SIZE, 0, size};
+    return ftruncate(file->data_fd, 0) == 0 && ftruncate(file->index_fd, 0) == 0
+           && pwrite(file->index_fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header)
+           && pwrite(file->index_fd, file->bitmap.data(), file->bitmap.size(), sizeof(header))
+              == (ssize_t)file->bitmap.size();
+}
+
+// 下载线程回调：写入数据文件后置位
+void storeBlock(CachedFile* file, int64_t index, const uint8_t* data, int len) {
+    // 先写数据再置位，中途退出时不会留下有位无数据的块
+    bool stored = len > 0 && pwrite(file->data_fd, data, len, index * BLOCK_SIZE) == len;
+    std::lock_guard<std::mutex> lock(file->mtx);
+    if (stored) {
+        file->bitmap[index / 8] |= 1 << (index % 8);
+        pwrite(file->index_fd, &file->bitmap[index / 8], 1, sizeof(IndexHeader) + index / 8);
+        file->misses++;
+    } else {
+        file->error_index = index;
+        file->error_code = len < 0 ? len : AVERROR(EIO);
+        if (len == AVERROR_INVALIDDATA) {
+            file->stale = true;
+        }
+    }
+    file->cond.notify_all();
+}
+
+// 把 index 块载入 file->block。缺失时请求下载并等待，同时把之后的预读窗口交给下载线程
+int loadBlock(CachedFile* file, int64_t index) {
+    int len = (int)std::min<int64_t>(BLOCK_SIZE, file->size - index * BLOCK_SIZE);
+    if (len <= 0) {
+        return AVERROR_EOF;
+    }
+    file->block_index = -1;
+    std::vector<int64_t> window;
+    {
+        std::unique_lock<std::mutex> lock(file->mtx);
+        if (isCached(file, index)) {
+            file->hits++;
+        } else {
+            // 之前预读这一块失败留下的错误已经过时，这次重新下载
+            if (file->error_index == index) {
+                file->error_index = -1;
+            }
+            file->fetcher->fetchNow(index);
+            while (!isCached(file, index)) {
+                if (file->error_index == index) {
+                    file->error_index = -1;
+                    return file->error_code;
+                }
+                const AVIOInterruptCB* cb = file->interrupt;
+                if (cb->callback && cb->callback(cb->opaque)) {
+                    return AVERROR_EXIT;
+                }
+                file->cond.wait_for(lock, std::chrono::milliseconds(50));
+            }
+        }
+        int64_t count = blockCount(file->size);
+        for (int64_t i = index + 1; i <= index + ahead_blocks && i < count; i++) {
+            if (!isCached(file, i)) {
+                window.push_back(i);
+            }
+        }
+    }
+    file->fetcher->prefetch(window);
+    if (pread(file->data_fd, file->block.data(), len, index * BLOCK_SIZE) != len) {
+        return AVERROR(EIO);
+    }
+    file->block_index = index;
+    file->block_len = len;
+    return 0;
+}
+
+int cacheRead(void* opaque, uint8_t* buf, int buf_size) {
+    CachedFile* file = static_cast<CachedFile*>(opaque);
+    if (file->pos >= file->size) {
+        return AVERROR_EOF;
+    }
+    int64_t index = file->pos / BLOCK_SIZE;
+    if (file->block_index != index) {
+        int ret = loadBlock(file, index);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+    int in_block = (int)(file->pos - index * BLOCK_SIZE);
+    if (in_block >= file->block_len) {
+        return AVERROR_EOF;
+    }
+    int len = std::min(buf_size, file->block_len - in_block);
+    memcpy(buf, file->block.data() + in_block, len);
+    file->pos += len;
+    return len;
+}
+
+int64_t cacheSeek(void* opaque, int64_t offset, int whence) {
+    CachedFile* file = static_cast<CachedFile*>(opaque);
+    int64_t target;
+    switch (whence & ~AVSEEK_FORCE) {
+        case AVSEEK_SIZE: return file->size;
+        case SEEK_SET: target = offset; break;
+        case SEEK_CUR: target = file->pos + offset; break;
+        case SEEK_END: target = file->size + offset; break;
+        default: return AVERROR(EINVAL);
+    }
+    if (target < 0) {
+        return AVERROR(EINVAL);
+    }
+    // 只移动读取位置，需要时才下载
+    file->pos = target;
+    return target;
+}
+
+// 读取已有索引，不存在或格式不符时返回 false
+bool loadIndex(CachedFile* file) {
+    IndexHeader header;
+    if (pread(file->index_fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header)
+        || header.magic != INDEX_MAGIC || header.version != INDEX_VERSION
+        || header.block_size != BLOCK_SIZE || header.file_size <= 0) {
+        return false;
+    }
+    file->size = header.file_size;
+    file->bitmap.resize((size_t)((blockCount(file->size) + 7) / 8));
+    return pread(file->index_fd, file->bitmap.data(), file->bitmap.size(), sizeof(header))
+           == (ssize_t)file->bitmap.size();
+}
+
+void closeFile(CachedFile* file) {
+    // 先停下载线程，之后不再有写入
+    file->fetcher.reset();
+    if (file->data_fd >= 0) {
+        close(file->data_fd);
+    }
+    if (file->index_fd >= 0) {
+        close(file->index_fd);
+    }
+    if (file->stale) {
+        unlink(file->data_path.c_str());
+        unlink(file->index_path.c_str());
+    }
+    delete file;
+}
+
+// 新条目用探测大小时建立的连接直接读第一块，这个连接已经在传输文件头
+void storeFirstBlock(CachedFile* file, AVIOContext* upstream) {
+    int len = (int)std::min<int64_t>(BLOCK_SIZE, file->size);
+    std::vector<uint8_t> data(len);
+    if (avio_read(upstream, data.data(), len) == len) {
+        storeBlock(file, 0, data.data(), len);
+    }
+}
+
+// 按索引文件的修改时间淘汰最久未使用的条目，直到总占用不超过容量
+void trimLocked() {
+    if (cache_dir.empty() || cache_capacity <= 0) {
+        return;
+    }
+    DIR* dir = opendir(cache_dir.c_str());
+    if (!dir) {
+        return;
+    }
+    struct Entry {
+        uint64_t key;
+        time_t used;
+        int64_t bytes;
+    };
+    std::vector<Entry> entries;
+    int64_t total = 0;
+    while (struct dirent* ent = readdir(dir)) {
+        unsigned long long key;
+        char ext[8];
+        if (sscanf(ent->d_name, "%16llx.%7s", &key, ext) != 2 || strcmp(ext, "idx") != 0) {
+            continue;
+        }
+        struct stat index_st, data_st;
+        if (stat(entryPath(key, "idx").c_str(), &index_st) != 0) {
+            continue;
+        }
+        // 数据文件是稀疏文件，按实际分配的块计算占用
+        int64_t bytes = index_st.st_size;
+        if (stat(entryPath(key, "data").c_str(), &data_st) == 0) {
+            bytes += (int64_t)data_st.st_blocks * 512;
+        }
+        entries.push_back({key, index_st.st_mtime, bytes});
+        total += bytes;
+    }
+    closedir(dir);
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.used < b.used; });
+    for (const Entry& entry : entries) {
+        if (total <= cache_capacity) {
+            break;
+        }
+        if (open_entries.count(entry.key)) {
+            continue;
+        }
+        unlink(entryPath(entry.key, "data").c_str());
+        unlink(entryPath(entry.key, "idx").c_str());
+        total -= entry.bytes;
+        LOGD("淘汰缓存条目 %016llx，%lld 字节", (unsigned long long)entry.key, (long long)entry.bytes);
+    }
+}
+
+}
+
+void BlockCache::setDirectory(const char* dir, int64_t capacity) {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    cache_dir = dir ? dir : "";
+    cache_capacity = capacity;
+    if (!cache_dir.empty()) {
+        mkdir(cache_dir.c_str(), 0700);
+        trimLocked();
+    }
+}
+
+void BlockCache::setFetchOptions(int connections, int aheadBlocks) {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    fetch_connections = std::max(connections, 1);
+    ahead_blocks = std::max(aheadBlocks, 0);
+}
+
+AVIOContext* BlockCache::open(const char* url, const AVIOInterruptCB* interrupt) {
+    if (strncmp(url, "http://", 7) != 0 && strncmp(url, "https://", 8) != 0) {
+        return nullptr;
+    }
+    CachedFile* file = new CachedFile();
+    file->url = url;
+    file->key = fnv1a(file->url);
+    file->interrupt = interrupt;
+    int connections;
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        if (cache_dir.empty() || !open_entries.insert(file->key).second) {
+            delete file;
+            return nullptr;
+        }
+        file->data_path = entryPath(file->key, "data");
+        file->index_path = entryPath(file->key, "idx");
+        connections = fetch_connections;
+    }
+    // 文件操作和网络请求不持锁，条目已登记为使用中，不会被并发打开或淘汰
+    auto fail = [file]() -> AVIOContext* {
+        {
+            std::lock_guard<std::mutex> lock(cache_mutex);
+            open_entries.erase(file->key);
+        }
+        closeFile(file);
+        return nullptr;
+    };
+    file->data_fd = ::open(file->data_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    file->index_fd = ::open(file->index_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (file->data_fd < 0 || file->index_fd < 0) {
+        return fail();
+    }
+    AVIOContext* upstream = nullptr;
+    if (loadIndex(file)) {
+        // 刷新修改时间作为最近使用时间
+        futimens(file->index_fd, nullptr);
+    } else {
+        // 新条目需要知道资源大小，并且源站支持范围请求，否则不缓存，由调用方改用 FFmpeg http 顺序读取。
+        // 在调用线程上打开，可被所属上下文的中断回调打断
+        int ret = avio_open2(&upstream, url, AVIO_FLAG_READ, interrupt, nullptr);
+        int64_t size = ret < 0 ? -1 : avio_size(upstream);
+        if (ret >= 0 && !(upstream->seekable & AVIO_SEEKABLE_NORMAL)) {
+            LOGI("源站不支持范围请求，不缓存：%s", url);
+            size = -1;
+        }
+        if (size <= 0 || !resetEntry(file, size)) {
+            avio_closep(&upstream);
+            file->stale = true;
+            return fail();
+        }
+    }
+    file->block.resize(BLOCK_SIZE);
+    file->fetcher.reset(new RangeFetcher(file->url, file->size, BLOCK_SIZE, connections,
+            [file](int64_t index, const uint8_t* data, int len) { storeBlock(file, index, data, len); }));
+
+    // 文件尾与文件头并行下载：尾部交给下载线程，头部用已建立的连接读取
+    std::vector<int64_t> tail;
+    {
+        std::lock_guard<std::mutex> lock(file->mtx);
+        int64_t count = blockCount(file->size);
+        for (int64_t i = std::max<int64_t>(1, (file->size - TAIL_PREFETCH_BYTES) / BLOCK_SIZE); i < count; i++) {
+            if (!isCached(file, i)) {
+                tail.push_back(i);
+            }
+        }
+    }
+    file->fetcher->fetchPinned(tail);
+    if (upstream) {
+        storeFirstBlock(file, upstream);
+        avio_closep(&upstream);
+    }
+
+    uint8_t* buffer = static_cast<uint8_t*>(av_malloc(IO_BUFFER_SIZE));
+    AVIOContext* pb = buffer ? avio_alloc_context(buffer, IO_BUFFER_SIZE, 0, file, cacheRead, nullptr, cacheSeek)
+                             : nullptr;
+    if (!pb) {
+        av_free(buffer);
+        return fail();
+    }
+    LOGI("块缓存打开：%s，%lld 字节", url, (long long)file->size);
+    return pb;
+}
+
+bool BlockCache::owns(const AVIOContext* pb) {
+    return pb && pb->read_packet == cacheRead;
+}
+
+void BlockCache::close(AVIOContext** pb) {
+    if (!owns(*pb)) {
+        return;
+    }
+    CachedFile* file = static_cast<CachedFile*>((*pb)->opaque);
+    LOGI("块缓存关闭：%s，命中 %lld 块，下载 %lld 块", file->url.c_str(),
+         (long long)file->hits, (long long)file->misses);
+    uint64_t key = file->key;
+    closeFile(file);
+    av_freep(&(*pb)->buffer);
+    avio_context_free(pb);
+
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    open_entries.erase(key);
+    trimLocked();
+}
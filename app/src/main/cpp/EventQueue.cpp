@@ -0,0 +1,93 @@
+#include "EventQueue.h"
+#include "Log.h"
+
+#define LOG_TAG "EventQueue"
+
+JavaVM* EventQueue::java_vm = nullptr;
+
+EventQueue::~EventQueue() {
+    // 进程退出时 JVM 可能已不可用，只停止线程，不再访问 Java 对象
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        running = false;
+    }
+    cond.notify_all();
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+void EventQueue::setJavaVM(JavaVM* vm) {
+    java_vm = vm;
+}
+
+void EventQueue::attach(JNIEnv* env, jobject obj) {
+    detach(env);
+    jclass clazz = env->GetObjectClass(obj);
+    jmethodID method = env->GetMethodID(clazz, "onNativeEvent", "(III)V");
+    env->DeleteLocalRef(clazz);
+    if (!method || !java_vm) {
+        env->ExceptionClear();
+        LOGE("无法注册事件监听：%s", java_vm ? "找不到 onNativeEvent" : "JavaVM 未初始化");
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mtx);
+    listener = env->NewGlobalRef(obj);
+    on_event = method;
+    running = true;
+    thread = std::thread(&EventQueue::deliverLoop, this);
+}
+
+void EventQueue::detach(JNIEnv* env) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        running = false;
+        std::queue<Event>().swap(events);
+    }
+    cond.notify_all();
+    if (thread.joinable()) {
+        thread.join();
+    }
+    if (listener) {
+        env->DeleteGlobalRef(listener);
+        listener = nullptr;
+    }
+}
+
+void EventQueue::post(int what, int arg1, int arg2) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!running) {
+            return;
+        }
+        events.push({what, arg1, arg2});
+    }
+    cond.notify_one();
+}
+
+void EventQueue::deliverLoop() {
+    JNIEnv* env = nullptr;
+    if (java_vm->AttachCurrentThread(&env, nullptr) != JNI_OK) {
+        LOGE("投递线程无法挂接 JVM");
+        return;
+    }
+    std::unique_lock<std::mutex> lock(mtx);
+    while (true) {
+        cond.wait(lock, [this] { return !running || !events.empty(); });
+        if (!running) {
+            break;
+        }
+        Event event = events.front();
+        events.pop();
+        // 回调 Java 时不持锁，Java 代码里可以再调用 native 方法
+        lock.unlock();
+        env->CallVoidMethod(listener, on_event, event.what, event.arg1, event.arg2);
+        if (env->ExceptionCheck()) {
+            env->ExceptionDescribe();
+            env->ExceptionClear();
+        }
+        lock.lock();
+    }
+    lock.unlock();
+    java_vm->DetachCurrentThread();
+}
@@ -0,0 +1,434 @@
+#include "FileIO.h"
+#include <atomic>
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <vector>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "BlockCache.h"
+#include "Log.h"
+extern "C" {
+#include <libavutil/mem.h>
+#include <libavutil/time.h>
+}
+
+#define LOG_TAG "FileIO"
+
+// AVIOContext 的缓冲区大小，每次 read_packet 最多拷贝这么多
+#define IO_BUFFER_SIZE (256 * 1024)
+// 自动选择时不小于此大小的文件使用预读后端
+#define AUTO_READAHEAD_MIN_SIZE (256LL * 1024 * 1024)
+// mmap 后端每前进一个窗口对下一个窗口 WILLNEED
+#define MMAP_WILLNEED_WINDOW (4 * 1024 * 1024)
+// 预读后端的块大小与预读深度（块数）
+#define READAHEAD_BLOCK_SIZE (1024 * 1024)
+#define READAHEAD_DEPTH 8
+
+namespace {
+
+std::atomic<int> configured_backend(FileIO::BACKEND_AUTO);
+
+// 本地路径返回去掉 file: 前缀后的路径，其余返回 nullptr
+const char* localPath(const char* url) {
+    if (strncmp(url, "file:", 5) == 0) {
+        return url + 5;
+    }
+    return strstr(url, "://") ? nullptr : url;
+}
+
+int64_t seekTarget(int64_t pos, int64_t size, int64_t offset, int whence) {
+    switch (whence) {
+        case SEEK_SET: return offset;
+        case SEEK_CUR: return pos + offset;
+        case SEEK_END: return size + offset;
+        default: return -1;
+    }
+}
+
+// ---------------- mmap ----------------
+
+struct MmapFile {
+    uint8_t* base = nullptr;
+    int64_t size = 0;
+    int64_t pos = 0;
+    int64_t advised_end = 0;    // 已 WILLNEED 到的位置
+};
+
+void adviseAhead(MmapFile* file) {
+    if (file->pos + MMAP_WILLNEED_WINDOW / 2 < file->advised_end) {
+        return;
+    }
+    // madvise 要求页对齐
+    int64_t page = sysconf(_SC_PAGESIZE);
+    int64_t start = file->pos / page * page;
+    int64_t end = std::min(file->size, file->pos + MMAP_WILLNEED_WINDOW);
+    if (end > start) {
+        madvise(file->base + start, end - start, MADV_WILLNEED);
+    }
+    file->advised_end = end;
+}
+
+int mmapRead(void* opaque, uint8_t* buf, int buf_size) {
+    MmapFile* file = static_cast<MmapFile*>(opaque);
+    int64_t left = file->size - file->pos;
+    if (left <= 0) {
+        return AVERROR_EOF;
+    }
+    int len = (int)std::min<int64_t>(left, buf_size);
+    adviseAhead(file);
+    memcpy(buf, file->base + file->pos, len);
+    file->pos += len;
+    return len;
+}
+
+int64_t mmapSeek(void* opaque, int64_t offset, int whence) {
+    MmapFile* file = static_cast<MmapFile*>(opaque);
+    if (whence & AVSEEK_SIZE) {
+        return file->size;
+    }
+    int64_t target = seekTarget(file->pos, file->size, offset, whence & ~AVSEEK_FORCE);
+    if (target < 0) {
+        return AVERROR(EINVAL);
+    }
+    file->pos = target;
+    // 跳转后从新位置重新 WILLNEED
+    file->advised_end = 0;
+    return target;
+}
+
+MmapFile* openMmap(int fd, int64_t size) {
+    if (size <= 0 || (uint64_t)size > SIZE_MAX) {
+        return nullptr;
+    }
+    void* base = mmap(nullptr, (size_t)size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (base == MAP_FAILED) {
+        // 32位进程地址空间不足时映射大文件会失败，由调用方退回预读后端
+        LOGW("mmap 失败：%s", strerror(errno));
+        return nullptr;
+    }
+    madvise(base, (size_t)size, MADV_SEQUENTIAL);
+    MmapFile* file = new MmapFile();
+    file->base = static_cast<uint8_t*>(base);
+    file->size = size;
+    return file;
+}
+
+void closeMmap(MmapFile* file) {
+    munmap(file->base, (size_t)file->size);
+    delete file;
+}
+
+// ---------------- 预读 ----------------
+
+// 读取位置所在块及其后 READAHEAD_DEPTH-1 块构成预读窗口，第 i 块放在 slots[i % READAHEAD_DEPTH]。
+// 窗口内的块与槽一一对应，消费者只读取已就绪的当前块，后台线程只改写窗口外的槽，拷贝无需持锁
+struct ReadAheadFile {
+    struct Slot {
+        int64_t index = -1;     // 存放的块号，-1 为空
+        bool ready = false;
+        int len = 0;            // 有效字节数，读取失败时为负的 AVERROR
+        uint8_t* data = nullptr;
+    };
+
+    int fd = -1;
+    int64_t size = 0;
+    int64_t pos = 0;            // 只由消费者线程读写
+    std::mutex mtx;
+    std::condition_variable cond;
+    int64_t window_start = 0;   // 当前块号，受 mtx 保护
+    bool running = true;
+    Slot slots[READAHEAD_DEPTH];
+    std::thread worker;
+
+    void fetchLoop();
+};
+
+void ReadAheadFile::fetchLoop() {
+    int64_t block_count = (size + READAHEAD_BLOCK_SIZE - 1) / READAHEAD_BLOCK_SIZE;
+    std::unique_lock<std::mutex> lock(mtx);
+    while (running) {
+        // 窗口内第一个尚未读取的块，离读取位置越近越先读
+        Slot* slot = nullptr;
+        int64_t index = window_start;
+        for (; index < window_start + READAHEAD_DEPTH && index < block_count; index++) {
+            Slot& s = slots[index % READAHEAD_DEPTH];
+            if (s.index != index) {
+                slot = &s;
+                break;
+            }
+        }
+        if (!slot) {
+            cond.wait(lock);
+            continue;
+        }
+        slot->index = index;
+        slot->ready = false;
+        lock.unlock();
+
+        int64_t offset = index * READAHEAD_BLOCK_SIZE;
+        int want = (int)std::min<int64_t>(READAHEAD_BLOCK_SIZE, size - offset);
+        int len = 0;
+        int err = 0;
+        while (len < want) {
+            ssize_t n = pread(fd, slot->data + len, want - len, offset + len);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                err = n < 0 ? errno : 0;
+                break;
+            }
+            len += (int)n;
+        }
+        if (len == 0) {
+            len = err ? AVERROR(err) : AVERROR_EOF;
+        }
+
+        lock.lock();
+        slot->len = len;
+        slot->ready = true;
+        cond.notify_all();
+    }
+}
+
+int readAheadRead(void* opaque, uint8_t* buf, int buf_size) {
+    ReadAheadFile* file = static_cast<ReadAheadFile*>(opaque);
+    if (file->pos >= file->size) {
+        return AVERROR_EOF;
+    }
+    int64_t index = file->pos / READAHEAD_BLOCK_SIZE;
+    ReadAheadFile::Slot& slot = file->slots[index % READAHEAD_DEPTH];
+    {
+        std::unique_lock<std::mutex> lock(file->mtx);
+        if (file->window_start != index) {
+            file->window_start = index;
+            file->cond.notify_all();
+        }
+        while (slot.index != index || !slot.ready) {
+            file->cond.wait(lock);
+        }
+    }
+    if (slot.len < 0) {
+        return slot.len;
+    }
+    int in_block = (int)(file->pos - index * READAHEAD_BLOCK_SIZE);
+    if (in_block >= slot.len) {
+        return AVERROR_EOF;
+    }
+    int len = std::min(buf_size, slot.len - in_block);
+    memcpy(buf, slot.data + in_block, len);
+    file->pos += len;
+    return len;
+}
+
+int64_t readAheadSeek(void* opaque, int64_t offset, int whence) {
+    ReadAheadFile* file = static_cast<ReadAheadFile*>(opaque);
+    if (whence & AVSEEK_SIZE) {
+        return file->size;
+    }
+    int64_t target = seekTarget(file->pos, file->size, offset, whence & ~AVSEEK_FORCE);
+    if (target < 0) {
+        return AVERROR(EINVAL);
+    }
+    // 窗口在下一次读取时移动，跳转不阻塞
+    file->pos = target;
+    return target;
+}
+
+ReadAheadFile* openReadAhead(int fd, int64_t size) {
+    ReadAheadFile* file = new ReadAheadFile();
+    for (auto& slot : file->slots) {
+        slot.data = static_cast<uint8_t*>(av_malloc(READAHEAD_BLOCK_SIZE));
+        if (!slot.data) {
+            for (auto& s : file->slots) {
+                av_free(s.data);
+            }
+            delete file;
+            return nullptr;
+        }
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    file->fd = fd;
+    file->size = size;
+    file->worker = std::thread(&ReadAheadFile::fetchLoop, file);
+    return file;
+}
+
+void closeReadAhead(ReadAheadFile* file) {
+    {
+        std::lock_guard<std::mutex> lock(file->mtx);
+        file->running = false;
+    }
+    file->cond.notify_all();
+    file->worker.join();
+    for (auto& slot : file->slots) {
+        av_free(slot.data);
+    }
+    close(file->fd);
+    delete file;
+}
+
+// ---------------- AVIOContext ----------------
+
+AVIOContext* createContext(void* opaque, int (*read)(void*, uint8_t*, int),
+                           int64_t (*seek)(void*, int64_t, int)) {
+    uint8_t* buffer = static_cast<uint8_t*>(av_malloc(IO_BUFFER_SIZE));
+    if (!buffer) {
+        return nullptr;
+    }
+    AVIOContext* pb = avio_alloc_context(buffer, IO_BUFFER_SIZE, 0, opaque, read, nullptr, seek);
+    if (!pb) {
+        av_free(buffer);
+    }
+    return pb;
+}
+
+// 按后端为本地文件创建 pb，无法使用自定义后端时返回 nullptr 走 FFmpeg 自带协议
+AVIOContext* openContext(const char* path, FileIO::Backend backend) {
+    if (backend == FileIO::BACKEND_STOCK) {
+        return nullptr;
+    }
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return nullptr;
+    }
+    if (backend == FileIO::BACKEND_AUTO) {
+        backend = st.st_size >= AUTO_READAHEAD_MIN_SIZE ? FileIO::BACKEND_READAHEAD : FileIO::BACKEND_MMAP;
+    }
+
+    AVIOContext* pb = nullptr;
+    if (backend == FileIO::BACKEND_MMAP) {
+        // 映射建立后文件描述符不再需要
+        MmapFile* file = openMmap(fd, st.st_size);
+        if (file) {
+            close(fd);
+            pb = createContext(file, mmapRead, mmapSeek);
+            if (!pb) {
+                closeMmap(file);
+                return nullptr;
+            }
+            LOGD("mmap 打开：%s，%lld 字节", path, (long long)st.st_size);
+            return pb;
+        }
+    }
+    ReadAheadFile* file = openReadAhead(fd, st.st_size);
+    if (!file) {
+        close(fd);
+        return nullptr;
+    }
+    pb = createContext(file, readAheadRead, readAheadSeek);
+    if (!pb) {
+        closeReadAhead(file);
+        return nullptr;
+    }
+    LOGD("预读打开：%s，%lld 字节", path, (long long)st.st_size);
+    return pb;
+}
+
+void freeContext(AVIOContext** pb) {
+    if (!*pb) {
+        return;
+    }
+    if (BlockCache::owns(*pb)) {
+        BlockCache::close(pb);
+        return;
+    }
+    if ((*pb)->read_packet == mmapRead) {
+        closeMmap(static_cast<MmapFile*>((*pb)->opaque));
+    } else if ((*pb)->read_packet == readAheadRead) {
+        closeReadAhead(static_cast<ReadAheadFile*>((*pb)->opaque));
+    }
+    av_freep(&(*pb)->buffer);
+    avio_context_free(pb);
+}
+
+double cpuSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+}
+
+namespace FileIO {
+
+void setBackend(Backend backend) {
+    configured_backend = backend;
+}
+
+int openInput(AVFormatContext** fmt_ctx, const char* url, AVDictionary** options) {
+    return openInput(fmt_ctx, url, options, (Backend)configured_backend.load());
+}
+
+int openInput(AVFormatContext** fmt_ctx, const char* url, AVDictionary** options, Backend backend) {
+    if (!*fmt_ctx && !(*fmt_ctx = avformat_alloc_context())) {
+        return AVERROR(ENOMEM);
+    }
+    // 本地文件按后端读取，远程地址经过磁盘块缓存
+    const char* path = localPath(url);
+    AVIOContext* pb = path ? openContext(path, backend)
+                           : BlockCache::open(url, &(*fmt_ctx)->interrupt_callback);
+    if (!pb) {
+        return avformat_open_input(fmt_ctx, url, nullptr, options);
+    }
+    (*fmt_ctx)->pb = pb;
+    int ret = avformat_open_input(fmt_ctx, url, nullptr, options);
+    if (ret < 0) {
+        // 自定义 pb 不随 avformat_open_input 失败释放
+        freeContext(&pb);
+    }
+    return ret;
+}
+
+void closeInput(AVFormatContext** fmt_ctx) {
+    if (!*fmt_ctx) {
+        return;
+    }
+    AVIOContext* pb = ((*fmt_ctx)->flags & AVFMT_FLAG_CUSTOM_IO) ? (*fmt_ctx)->pb : nullptr;
+    avformat_close_input(fmt_ctx);
+    freeContext(&pb);
+}
+
+int benchmark(const char* url, Backend backend, BenchmarkResult* result) {
+    memset(result, 0, sizeof(*result));
+    double cpu_start = cpuSeconds();
+    int64_t wall_start = av_gettime_relative();
+
+    AVFormatContext* ctx = nullptr;
+    int ret = openInput(&ctx, url, nullptr, backend);
+    if (ret < 0) {
+        return ret;
+    }
+    AVPacket* pkt = av_packet_alloc();
+    if (!pkt) {
+        closeInput(&ctx);
+        return AVERROR(ENOMEM);
+    }
+    while ((ret = av_read_frame(ctx, pkt)) >= 0) {
+        result->packets++;
+        result->bytes += pkt->size;
+        av_packet_unref(pkt);
+    }
+    av_packet_free(&pkt);
+    closeInput(&ctx);
+
+    result->wallSeconds = (av_gettime_relative() - wall_start) / 1e6;
+    result->cpuSeconds = cpuSeconds() - cpu_start;
+    LOGI("读取测试（后端 %d）：%lld 个数据包，%.1f 包/秒，CPU %.3f 秒", backend,
+         (long long)result->packets, result->packets / std::max(result->wallSeconds, 1e-6), result->cpuSeconds);
+    return ret == AVERROR_EOF ? 0 : ret;
+}
+
+}
@@ -0,0 +1,235 @@
+#include "FrameConverter.h"
+#include "Log.h"
+#include "Trace.h"
+
+extern "C" {
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+}
+
+#define LOG_TAG "FrameConverter"
+
+
+const char* convertPathName(ConvertPath path) {
+    switch (path) {
+        case ConvertPath::Passthrough:
+            return "passthrough";
+        case ConvertPath::FastKernel:
+            return "fast-kernel";
+        case ConvertPath::Swscale:
+            return "swscale";
+    }
+    return "unknown";
+}
+
+// 是否有手写内核可以完成 src -> dst 的转换
+static bool hasFastKernel(AVPixelFormat src, AVPixelFormat dst) {
+    return dst == AV_PIX_FMT_YUV420P && (src == AV_PIX_FMT_NV12 || src == AV_PIX_FMT_NV21);
+}
+
+// NV12/NV21 的交织色度平面拆分为 YUV420P 的 U、V 两个平面
+static void deinterleaveChroma(const uint8_t* uv, int uvLinesize, bool swapUV,
+                               uint8_t* u, int uLinesize, uint8_t* v, int vLinesize,
+                               int chromaWidth, int chromaHeight) {
+    if (swapUV) {
+        uint8_t* tmp = u;
+        u = v;
+        v = tmp;
+        int tmpLinesize = uLinesize;
+        uLinesize = vLinesize;
+        vLinesize = tmpLinesize;
+    }
+    for (int y = 0; y < chromaHeight; y++) {
+        const uint8_t* src = uv + y * uvLinesize;
+        uint8_t* dstU = u + y * uLinesize;
+        uint8_t* dstV = v + y * vLinesize;
+        for (int x = 0; x < chromaWidth; x++) {
+            dstU[x] = src[2 * x];
+            dstV[x] = src[2 * x + 1];
+        }
+    }
+}
+
+AVPixelFormat negotiatePixelFormat(AVPixelFormat srcFmt, const AVPixelFormat* sinkFormats, ConvertPath* path) {
+    AVPixelFormat best = AV_PIX_FMT_NONE;
+    ConvertPath bestPath = ConvertPath::Swscale;
+    for (const AVPixelFormat* fmt = sinkFormats; *fmt != AV_PIX_FMT_NONE; fmt++) {
+        ConvertPath candidate;
+        if (*fmt == srcFmt) {
+            candidate = ConvertPath::Passthrough;
+        } else if (hasFastKernel(srcFmt, *fmt)) {
+            candidate = ConvertPath::FastKernel;
+        } else {
+            candidate = ConvertPath::Swscale;
+        }
+        // 代价更低才替换，保证代价相同时保留输出端更偏好的格式
+        if (best == AV_PIX_FMT_NONE || candidate < bestPath) {
+            best = *fmt;
+            bestPath = candidate;
+        }
+    }
+    if (path) {
+        *path = bestPath;
+    }
+    return best;
+}
+
+
+FrameConverter::FrameConverter() {
+    this->frame_pool = nullptr;
+    this->sink_formats = nullptr;
+    this->tag = "";
+    this->src_fmt = AV_PIX_FMT_NONE;
+    this->dst_fmt = AV_PIX_FMT_NONE;
+    this->width = 0;
+    this->height = 0;
+    this->out_width = 0;
+    this->out_height = 0;
+    this->dst_width = 0;
+    this->dst_height = 0;
+    this->convert_path = ConvertPath::Swscale;
+    this->sws_ctx = nullptr;
+    this->dst_frame = nullptr;
+}
+
+FrameConverter::~FrameConverter() {
+    release();
+}
+
+int FrameConverter::init(AVPixelFormat srcFmt, int w, int h, const AVPixelFormat* sinkFormats, const char* sessionTag) {
+    release();
+    this->sink_formats = sinkFormats;
+    this->tag = sessionTag ? sessionTag : "";
+    this->src_fmt = srcFmt;
+    this->width = w;
+    this->height = h;
+    this->dst_width = out_width > 0 ? out_width : w;
+    this->dst_height = out_height > 0 ? out_height : h;
+    this->dst_fmt = negotiatePixelFormat(srcFmt, sinkFormats, &convert_path);
+    if (dst_fmt == AV_PIX_FMT_NONE) {
+        LOGE("[%s] 输出端未提供可用的像素格式", tag);
+        return -1;
+    }
+    if (dst_width != w || dst_height != h) {
+        // 需要缩放时各格式代价相同，都交给 swscale，取输出端最偏好的格式
+        convert_path = ConvertPath::Swscale;
+        dst_fmt = sinkFormats[0];
+    }
+    LOGI("[%s] 像素格式协商：%s %dx%d -> %s %dx%d，路径：%s", tag,
+         av_get_pix_fmt_name(src_fmt), w, h, av_get_pix_fmt_name(dst_fmt), dst_width, dst_height,
+         convertPathName(convert_path));
+
+    if (convert_path == ConvertPath::Passthrough) {
+        return 0;
+    }
+
+    dst_frame = allocOutput();
+    if (!dst_frame) {
+        LOGE("[%s] 无法分配转换缓冲区", tag);
+        return -1;
+    }
+
+    if (convert_path == ConvertPath::Swscale) {
+        sws_ctx = sws_getContext(w, h, src_fmt, dst_width, dst_height, dst_fmt,
+                                 SWS_BILINEAR, nullptr, nullptr, nullptr);
+        if (!sws_ctx) {
+            LOGE("[%s] 无法创建 SwsContext", tag);
+            release();
+            return -1;
+        }
+    }
+    return 0;
+}
+
+AVFrame* FrameConverter::allocOutput() {
+    // 打包格式（RGBA 等）按行紧密排列，便于输出端整块上传；平面格式使用默认对齐
+    bool packed = av_pix_fmt_count_planes(dst_fmt) == 1;
+    if (frame_pool) {
+        return frame_pool->allocFrame(dst_fmt, dst_width, dst_height, packed);
+    }
+    AVFrame* frame = av_frame_alloc();
+    if (!frame) {
+        return nullptr;
+    }
+    frame->format = dst_fmt;
+    frame->width = dst_width;
+    frame->height = dst_height;
+    if (av_frame_get_buffer(frame, packed ? 1 : 0) < 0) {
+        av_frame_free(&frame);
+    }
+    return frame;
+}
+
+// 准备可写的输出帧：上一帧仍被下游持有时另取一块缓冲，不覆盖被持有的内容
+int FrameConverter::prepareOutput() {
+    // buf[1] 是 FastKernel 路径对解码帧亮度平面的引用，每帧重新建立
+    av_buffer_unref(&dst_frame->buf[1]);
+    if (av_buffer_is_writable(dst_frame->buf[0])) {
+        return 0;
+    }
+    AVFrame* next = allocOutput();
+    if (!next) {
+        return -1;
+    }
+    av_frame_free(&dst_frame);
+    dst_frame = next;
+    return 0;
+}
+
+void FrameConverter::setOutputSize(int w, int h) {
+    this->out_width = w;
+    this->out_height = h;
+}
+
+const AVFrame* FrameConverter::convert(const AVFrame* src) {
+    if (src->format != src_fmt || src->width != width || src->height != height
+        || dst_width != (out_width > 0 ? out_width : src->width)
+        || dst_height != (out_height > 0 ? out_height : src->height)) {
+        // 码流中途改变了分辨率或格式，或输出尺寸被调整，重新协商
+        if (init(static_cast<AVPixelFormat>(src->format), src->width, src->height, sink_formats, tag) < 0) {
+            return nullptr;
+        }
+    }
+    switch (convert_path) {
+        case ConvertPath::Passthrough:
+            return src;
+        case ConvertPath::FastKernel: {
+            TRACE_SCOPE("deinterleave_chroma");
+            if (prepareOutput() < 0) {
+                return nullptr;
+            }
+            // 亮度平面布局相同，不拷贝，直接引用解码帧的数据，并持有其缓冲的引用
+            AVBufferRef* luma = av_frame_get_plane_buffer(const_cast<AVFrame*>(src), 0);
+            if (luma) {
+                dst_frame->buf[1] = av_buffer_ref(luma);
+            }
+            dst_frame->data[0] = src->data[0];
+            dst_frame->linesize[0] = src->linesize[0];
+            deinterleaveChroma(src->data[1], src->linesize[1], src_fmt == AV_PIX_FMT_NV21,
+                               dst_frame->data[1], dst_frame->linesize[1],
+                               dst_frame->data[2], dst_frame->linesize[2],
+                               (width + 1) / 2, (height + 1) / 2);
+            break;
+        }
+        case ConvertPath::Swscale:
+            if (prepareOutput() < 0) {
+                return nullptr;
+            }
+            TRACE_SCOPE("sws_scale");
+            sws_scale(sws_ctx, src->data, src->linesize, 0, height,
+                      dst_frame->data, dst_frame->linesize);
+            break;
+    }
+    dst_frame->pts = src->pts;
+    return dst_frame;
+}
+
+void FrameConverter::release() {
+    if (sws_ctx) {
+        sws_freeContext(sws_ctx);
+        sws_ctx = nullptr;
+    }
+    if (dst_frame) {
+        av_frame_free(&dst_frame);
+    }
+}
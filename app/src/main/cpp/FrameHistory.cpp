@@ -0,0 +1,113 @@
+#include "FrameHistory.h"
+#include "Log.h"
+extern "C" {
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+}
+
+#define LOG_TAG "FrameHistory"
+
+FrameHistory::FrameHistory(FramePool* pool) : frame_pool(pool), budget(DEFAULT_BUDGET) {
+}
+
+FrameHistory::~FrameHistory() {
+    clear();
+    sws_freeContext(sws_ctx);
+}
+
+void FrameHistory::setBudget(size_t bytes) {
+    budget = bytes;
+}
+
+void FrameHistory::push(const AVFrame* frame, int64_t pts) {
+    if (!entries.empty() && pts != AV_NOPTS_VALUE && pts <= entries.back().pts) {
+        clear();
+    }
+    size_t limit = budget;
+    int full_bytes = av_image_get_buffer_size((AVPixelFormat)frame->format, frame->width, frame->height, 1);
+    if (limit == 0 || full_bytes <= 0) {
+        clear();
+        return;
+    }
+    AVFrame* copy = nullptr;
+    if (limit / full_bytes >= (size_t)MIN_FULL_FRAMES) {
+        copy = av_frame_clone(frame);
+    } else {
+        copy = downscale(frame);
+    }
+    if (!copy) {
+        return;
+    }
+    int bytes = av_image_get_buffer_size((AVPixelFormat)copy->format, copy->width, copy->height, 1);
+    entries.push_back({copy, pts, (size_t)bytes});
+    total_bytes += bytes;
+    // 至少保留最新的一帧
+    while (entries.size() > 1 && total_bytes > limit) {
+        popOldest();
+    }
+    cursor = (int)entries.size() - 1;
+}
+
+void FrameHistory::clear() {
+    for (Entry& entry : entries) {
+        av_frame_free(&entry.frame);
+    }
+    entries.clear();
+    total_bytes = 0;
+    cursor = -1;
+}
+
+const AVFrame* FrameHistory::back() {
+    if (cursor <= 0) {
+        return nullptr;
+    }
+    return entries[--cursor].frame;
+}
+
+const AVFrame* FrameHistory::forward() {
+    if (atNewest()) {
+        return nullptr;
+    }
+    return entries[++cursor].frame;
+}
+
+int64_t FrameHistory::currentPts() const {
+    return cursor >= 0 ? entries[cursor].pts : AV_NOPTS_VALUE;
+}
+
+int64_t FrameHistory::oldestPts() const {
+    return entries.empty() ? AV_NOPTS_VALUE : entries.front().pts;
+}
+
+// 缩小一半存放，宽高保持偶数以满足 yuv420p/nv12 的色度对齐
+AVFrame* FrameHistory::downscale(const AVFrame* frame) {
+    AVPixelFormat fmt = (AVPixelFormat)frame->format;
+    int width = (frame->width / 2) & ~1;
+    int height = (frame->height / 2) & ~1;
+    if (width <= 0 || height <= 0) {
+        return av_frame_clone(frame);
+    }
+    sws_ctx = sws_getCachedContext(sws_ctx, frame->width, frame->height, fmt,
+                                   width, height, fmt, SWS_FAST_BILINEAR, nullptr, nullptr, nullptr);
+    if (!sws_ctx) {
+        LOGE("无法缩小 %s 帧", av_get_pix_fmt_name(fmt));
+        return nullptr;
+    }
+    AVFrame* copy = frame_pool->allocFrame(fmt, width, height, av_pix_fmt_count_planes(fmt) == 1);
+    if (!copy) {
+        return nullptr;
+    }
+    sws_scale(sws_ctx, frame->data, frame->linesize, 0, frame->height, copy->data, copy->linesize);
+    av_frame_copy_props(copy, frame);
+    return copy;
+}
+
+void FrameHistory::popOldest() {
+    Entry& entry = entries.front();
+    total_bytes -= entry.bytes;
+    av_frame_free(&entry.frame);
+    entries.pop_front();
+    if (cursor > 0) {
+        cursor--;
+    }
+}
@@ -0,0 +1,243 @@
+#include "FramePool.h"
+#include <stdlib.h>
+#include "Log.h"
+
+extern "C" {
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+}
+
+#define LOG_TAG "FramePool"
+
+// 每块缓冲前预留一个对齐单位，记录缓冲大小，释放时据此归还到对应的桶
+static const size_t HEADER_SIZE = FramePool::BUFFER_ALIGN;
+// 解码器可能越过图像末尾读取少量字节，与 FFmpeg 默认分配器一样多留一些余量
+static const size_t TAIL_PADDING = 16 + FramePool::BUFFER_ALIGN - 1;
+
+static uint8_t* headerOf(uint8_t* data) {
+    return data - HEADER_SIZE;
+}
+
+static size_t sizeOf(uint8_t* data) {
+    return *reinterpret_cast<size_t*>(headerOf(data));
+}
+
+
+FramePool::FramePool(size_t memoryLimit) {
+    state = new State();
+    state->limit = memoryLimit;
+}
+
+FramePool::~FramePool() {
+    {
+        std::lock_guard<std::mutex> lock(state->mtx);
+        state->closed = true;
+    }
+    trim();
+    unref(state);
+}
+
+void FramePool::unref(State* s) {
+    if (s->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        delete s;
+    }
+}
+
+// 回收空闲缓冲，直到再分配 needed 字节不会超过上限，调用方需持有锁
+void FramePool::evictIdle(State* s, size_t needed) {
+    for (auto it = s->free_buffers.begin(); it != s->free_buffers.end() && s->idle > 0;) {
+        if (s->allocated + needed <= s->limit) {
+            return;
+        }
+        std::vector<uint8_t*>& bucket = it->second;
+        while (!bucket.empty() && s->allocated + needed > s->limit) {
+            uint8_t* data = bucket.back();
+            bucket.pop_back();
+            size_t size = sizeOf(data);
+            s->allocated -= size;
+            s->idle -= size;
+            free(headerOf(data));
+        }
+        it = bucket.empty() ? s->free_buffers.erase(it) : std::next(it);
+    }
+}
+
+void FramePool::releaseBuffer(void* opaque, uint8_t* data) {
+    State* s = static_cast<State*>(opaque);
+    {
+        std::lock_guard<std::mutex> lock(s->mtx);
+        size_t size = sizeOf(data);
+        if (s->closed || s->allocated > s->limit) {
+            // 池已关闭或上限被调低，不再缓存
+            s->allocated -= size;
+            free(headerOf(data));
+        } else {
+            s->free_buffers[size].push_back(data);
+            s->idle += size;
+        }
+    }
+    unref(s);
+}
+
+AVBufferRef* FramePool::getBuffer(size_t size) {
+    uint8_t* data = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(state->mtx);
+        auto it = state->free_buffers.find(size);
+        if (it != state->free_buffers.end() && !it->second.empty()) {
+            data = it->second.back();
+            it->second.pop_back();
+            state->idle -= size;
+        } else {
+            // 分辨率变化后旧尺寸的空闲缓冲不再有用，先回收再判断上限
+            evictIdle(state, size);
+            if (state->allocated + size > state->limit) {
+                return nullptr;
+            }
+            void* block = nullptr;
+            if (posix_memalign(&block, BUFFER_ALIGN, HEADER_SIZE + size) != 0) {
+                return nullptr;
+            }
+            *static_cast<size_t*>(block) = size;
+            data = static_cast<uint8_t*>(block) + HEADER_SIZE;
+            state->allocated += size;
+        }
+    }
+    state->refs.fetch_add(1, std::memory_order_relaxed);
+    AVBufferRef* buf = av_buffer_create(data, size, releaseBuffer, state, 0);
+    if (!buf) {
+        releaseBuffer(state, data);
+    }
+    return buf;
+}
+
+// 计算每个平面的行宽，packed 时紧密排列，否则行宽按 BUFFER_ALIGN 对齐
+static int fillLinesizes(int linesizes[4], AVPixelFormat fmt, int width, bool packed) {
+    if (packed) {
+        return av_image_fill_linesizes(linesizes, fmt, width);
+    }
+    // 与 FFmpeg 的做法相同：逐步放大宽度对齐，直到亮度行宽满足对齐要求
+    int ret = 0;
+    for (int align = 1; align <= FramePool::BUFFER_ALIGN; align += align) {
+        ret = av_image_fill_linesizes(linesizes, fmt, FFALIGN(width, align));
+        if (ret < 0 || !(linesizes[0] & (FramePool::BUFFER_ALIGN - 1))) {
+            break;
+        }
+    }
+    return ret;
+}
+
+// 按行宽分配一整块缓冲并填充 frame 的平面指针，成功返回0
+static int fillFrame(FramePool* pool, AVFrame* frame, AVPixelFormat fmt, int height, const int linesizes[4]) {
+    uint8_t* data[4] = {nullptr};
+    ptrdiff_t linesizes1[4];
+    for (int i = 0; i < 4; i++) {
+        linesizes1[i] = linesizes[i];
+    }
+    size_t sizes[4] = {0};
+    if (av_image_fill_plane_sizes(sizes, fmt, height, linesizes1) < 0) {
+        return -1;
+    }
+    size_t total = 0;
+    for (int i = 0; i < 4; i++) {
+        total += FFALIGN(sizes[i], FramePool::BUFFER_ALIGN);
+    }
+    AVBufferRef* buf = pool->getBuffer(total + TAIL_PADDING);
+    if (!buf) {
+        return AVERROR(ENOMEM);
+    }
+    size_t offset = 0;
+    for (int i = 0; i < 4 && sizes[i] > 0; i++) {
+        data[i] = buf->data + offset;
+        offset += FFALIGN(sizes[i], FramePool::BUFFER_ALIGN);
+    }
+    frame->buf[0] = buf;
+    for (int i = 0; i < 4; i++) {
+        frame->data[i] = data[i];
+        frame->linesize[i] = linesizes[i];
+    }
+    frame->extended_data = frame->data;
+    return 0;
+}
+
+AVFrame* FramePool::allocFrame(AVPixelFormat fmt, int width, int height, bool packed) {
+    AVFrame* frame = av_frame_alloc();
+    if (!frame) {
+        return nullptr;
+    }
+    frame->format = fmt;
+    frame->width = width;
+    frame->height = height;
+    int linesizes[4] = {0};
+    if (fillLinesizes(linesizes, fmt, width, packed) < 0 || fillFrame(this, frame, fmt, height, linesizes) < 0) {
+        // 超过上限时退回 FFmpeg 自己分配
+        if (av_frame_get_buffer(frame, packed ? 1 : 0) < 0) {
+            av_frame_free(&frame);
+            return nullptr;
+        }
+    }
+    return frame;
+}
+
+int FramePool::getBuffer2(AVCodecContext* ctx, AVFrame* frame, int flags) {
+    FramePool* pool = static_cast<FramePool*>(ctx->opaque);
+    AVPixelFormat fmt = static_cast<AVPixelFormat>(frame->format);
+    const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(fmt);
+    // 只接管普通的软件解码视频帧，音频、硬件帧和调色板格式交给默认实现
+    if (!pool || ctx->codec_type != AVMEDIA_TYPE_VIDEO || !desc
+        || !(ctx->codec->capabilities & AV_CODEC_CAP_DR1)
+        || (desc->flags & (AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_PAL))) {
+        return avcodec_default_get_buffer2(ctx, frame, flags);
+    }
+
+    // 解码器要求的宽高对齐（宏块边界）与行宽对齐
+    int width = frame->width;
+    int height = frame->height;
+    int linesize_align[AV_NUM_DATA_POINTERS];
+    avcodec_align_dimensions2(ctx, &width, &height, linesize_align);
+
+    int linesizes[4] = {0};
+    if (fillLinesizes(linesizes, fmt, width, false) < 0) {
+        return avcodec_default_get_buffer2(ctx, frame, flags);
+    }
+    for (int i = 0; i < 4; i++) {
+        if (linesize_align[i] > 0 && linesizes[i] % linesize_align[i]) {
+            return avcodec_default_get_buffer2(ctx, frame, flags);
+        }
+    }
+    if (fillFrame(pool, frame, fmt, height, linesizes) < 0) {
+        return avcodec_default_get_buffer2(ctx, frame, flags);
+    }
+    return 0;
+}
+
+void FramePool::attach(AVCodecContext* ctx) {
+    ctx->opaque = this;
+    // 池内部加锁，帧多线程解码时可并发调用。FFmpeg 4.4 起 get_buffer2 默认要求线程安全，
+    // 不再设置已废弃的 thread_safe_callbacks
+    ctx->get_buffer2 = getBuffer2;
+}
+
+void FramePool::setMemoryLimit(size_t bytes) {
+    std::lock_guard<std::mutex> lock(state->mtx);
+    state->limit = bytes;
+    evictIdle(state, 0);
+    LOGI("内存上限：%zu 字节，已分配：%zu 字节", bytes, state->allocated);
+}
+
+void FramePool::trim() {
+    std::lock_guard<std::mutex> lock(state->mtx);
+    for (auto& bucket : state->free_buffers) {
+        for (uint8_t* data : bucket.second) {
+            state->allocated -= bucket.first;
+            free(headerOf(data));
+        }
+    }
+    state->free_buffers.clear();
+    state->idle = 0;
+}
+
+size_t FramePool::allocatedBytes() const {
+    std::lock_guard<std::mutex> lock(state->mtx);
+    return state->allocated;
+}
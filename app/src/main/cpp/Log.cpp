@@ -0,0 +1,226 @@
+#include "Log.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <vector>
+#ifdef __ANDROID__
+#include <android/log.h>
+#endif
+
+
+namespace {
+
+const int RING_CAPACITY = 512;     // 必须是2的幂
+const int TAG_LENGTH = 24;
+const int MESSAGE_LENGTH = 228;
+const int MAX_TAG_LEVELS = 16;
+
+// 环形缓冲区的一个槽位，seq 用于生产者与消费者之间的交接（Vyukov 有界队列）
+struct LogEntry {
+    std::atomic<uint32_t> seq;
+    int level;
+    char tag[TAG_LENGTH];
+    char message[MESSAGE_LENGTH];
+};
+
+struct TagLevel {
+    std::atomic<const char*> tag;
+    std::atomic<int> level;
+};
+
+LogEntry ring[RING_CAPACITY];
+std::atomic<uint32_t> enqueue_pos(0);
+uint32_t dequeue_pos = 0;           // 只有后台线程访问
+std::atomic<uint32_t> flushed_pos(0);
+std::atomic<uint64_t> dropped(0);
+
+std::atomic<int> global_level(LOG_LEVEL_VERBOSE);
+TagLevel tag_levels[MAX_TAG_LEVELS];
+std::atomic<int> tag_level_count(0);
+std::mutex tag_level_mutex;        // 只保护设置，读取不加锁
+
+std::once_flag start_flag;
+
+int64_t nowMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+void write(int level, const char* tag, const char* message) {
+#ifdef __ANDROID__
+    __android_log_write(level, tag, message);
+#else
+    static const char levelChars[] = "??VDIWEF";
+    char c = (level >= 0 && level < (int)sizeof(levelChars) - 1) ? levelChars[level] : '?';
+    fprintf(stdout, "%c/%s: %s\n", c, tag, message);
+#endif
+}
+
+// 取出一条日志，没有可读日志时返回 false
+bool drainOne() {
+    LogEntry& entry = ring[dequeue_pos & (RING_CAPACITY - 1)];
+    if (entry.seq.load(std::memory_order_acquire) != dequeue_pos + 1) {
+        return false;
+    }
+    write(entry.level, entry.tag, entry.message);
+    entry.seq.store(dequeue_pos + RING_CAPACITY, std::memory_order_release);
+    dequeue_pos++;
+    return true;
+}
+
+void drainLoop() {
+    uint64_t reported = 0;
+    while (true) {
+        bool any = false;
+        while (drainOne()) {
+            any = true;
+        }
+        flushed_pos.store(dequeue_pos, std::memory_order_release);
+        uint64_t lost = dropped.load(std::memory_order_relaxed);
+        if (lost != reported) {
+            char message[64];
+            snprintf(message, sizeof(message), "日志缓冲区已满，丢弃 %llu 条", (unsigned long long)(lost - reported));
+            write(LOG_LEVEL_WARN, "Logger", message);
+            reported = lost;
+        }
+#ifndef __ANDROID__
+        if (any) {
+            fflush(stdout);
+        }
+#endif
+        if (!any) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    }
+}
+
+void startDrainThread() {
+    for (uint32_t i = 0; i < RING_CAPACITY; i++) {
+        ring[i].seq.store(i, std::memory_order_relaxed);
+    }
+    std::thread(drainLoop).detach();
+}
+
+} // namespace
+
+
+void Logger::setLevel(const char* tag, int level) {
+    if (!tag) {
+        global_level.store(level, std::memory_order_relaxed);
+        return;
+    }
+    std::lock_guard<std::mutex> lock(tag_level_mutex);
+    int count = tag_level_count.load(std::memory_order_relaxed);
+    for (int i = 0; i < count; i++) {
+        const char* existing = tag_levels[i].tag.load(std::memory_order_relaxed);
+        if (strcmp(existing, tag) == 0) {
+            tag_levels[i].level.store(level, std::memory_order_relaxed);
+            return;
+        }
+    }
+    if (count == MAX_TAG_LEVELS) {
+        return;
+    }
+    // 子系统名的生命周期需覆盖整个进程，这里保留一份拷贝
+    tag_levels[count].tag.store(strdup(tag), std::memory_order_relaxed);
+    tag_levels[count].level.store(level, std::memory_order_relaxed);
+    tag_level_count.store(count + 1, std::memory_order_release);
+}
+
+bool Logger::isEnabled(int level, const char* tag) {
+    int count = tag_level_count.load(std::memory_order_acquire);
+    for (int i = 0; i < count; i++) {
+        if (strcmp(tag_levels[i].tag.load(std::memory_order_relaxed), tag) == 0) {
+            return level >= tag_levels[i].level.load(std::memory_order_relaxed);
+        }
+    }
+    return level >= global_level.load(std::memory_order_relaxed);
+}
+
+bool Logger::allow(std::atomic<int64_t>* last, int64_t intervalMs) {
+    int64_t now = nowMs();
+    int64_t prev = last->load(std::memory_order_relaxed);
+    if (prev != 0 && now - prev < intervalMs) {
+        return false;
+    }
+    // 多个线程同时到达时只放行一个
+    return last->compare_exchange_strong(prev, now, std::memory_order_relaxed);
+}
+
+void Logger::print(int level, const char* tag, const char* fmt, ...) {
+    std::call_once(start_flag, startDrainThread);
+
+    uint32_t pos = enqueue_pos.load(std::memory_order_relaxed);
+    LogEntry* entry;
+    while (true) {
+        entry = &ring[pos & (RING_CAPACITY - 1)];
+        uint32_t seq = entry->seq.load(std::memory_order_acquire);
+        int32_t diff = (int32_t)(seq - pos);
+        if (diff == 0) {
+            if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // 缓冲区已满，丢弃，不阻塞调用线程
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        } else {
+            pos = enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    entry->level = level;
+    strncpy(entry->tag, tag, TAG_LENGTH - 1);
+    entry->tag[TAG_LENGTH - 1] = '\0';
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(entry->message, MESSAGE_LENGTH, fmt, args);
+    va_end(args);
+    entry->seq.store(pos + 1, std::memory_order_release);
+}
+
+void Logger::printLong(int level, const char* tag, const char* text) {
+    if (level < LOG_MIN_LEVEL || !isEnabled(level, tag)) {
+        return;
+    }
+    size_t length = strlen(text);
+    if (length < (size_t)MESSAGE_LENGTH) {
+        print(level, tag, "%s", text);
+        return;
+    }
+    // 留出 "[序号/总数] " 前缀的位置
+    const size_t chunk = MESSAGE_LENGTH - 16;
+    std::vector<std::pair<size_t, size_t>> pieces;
+    size_t offset = 0;
+    while (offset < length) {
+        size_t end = std::min(offset + chunk, length);
+        while (end < length && end > offset + 1 && ((unsigned char)text[end] & 0xC0) == 0x80) {
+            end--;
+        }
+        pieces.emplace_back(offset, end - offset);
+        offset = end;
+    }
+    for (size_t i = 0; i < pieces.size(); i++) {
+        print(level, tag, "[%zu/%zu] %.*s", i + 1, pieces.size(), (int)pieces[i].second, text + pieces[i].first);
+    }
+}
+
+void Logger::flush() {
+    uint32_t target = enqueue_pos.load(std::memory_order_acquire);
+    if (target == 0) {
+        return; // 尚未输出过日志，后台线程可能还没启动
+    }
+    while ((int32_t)(flushed_pos.load(std::memory_order_acquire) - target) < 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+uint64_t Logger::droppedCount() {
+    return dropped.load(std::memory_order_relaxed);
+}
@@ -1,23 +1,12 @@
 #include "OpenGLRenderer.h"
+#include "Log.h"
+#include "PlayerStats.h"
+#include "Trace.h"
 #include <stdlib.h>
 #include <string.h>
 
 
 #define LOG_TAG "OpenGLRenderer"
-#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
-#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
-
-
-//
-static EGLDisplay eglDisplay = EGL_NO_DISPLAY;
-static EGLSurface eglSurface = EGL_NO_SURFACE;
-static EGLContext eglContext = EGL_NO_CONTEXT;
-static GLuint programObject = 0;
-static GLuint textureId = 0;
-static GLint attrPosition = -1;
-static GLint attrTexCoord = -1;
-static GLint uniTexture = -1;
-static GLuint vbo = 0;
 
 
 static const GLfloat vertices[] = {
@@ -29,6 +18,18 @@ static const GLfloat vertices[] = {
 };
 
 
+// 顶点着色器，RGBA 与 YUV 两个程序共用
+static const char* vShaderStr =
+        "attribute vec4 aPosition;    \n"
+        "attribute vec2 aTexCoord;    \n"
+        "varying vec2 vTexCoord;      \n"
+        "void main()                \n"
+        "{                          \n"
+        "   gl_Position = aPosition;\n"
+        "   vTexCoord = aTexCoord;  \n"
+        "}                          \n";
+
+
 // 纹理
 static GLuint loadShader(GLenum shaderType, const char* source) {
     GLuint shader = glCreateShader(shaderType);
@@ -48,7 +49,8 @@ static GLuint loadShader(GLenum shaderType, const char* source) {
     return shader;
 }
 
-static bool initEGL(ANativeWindow* window) {
+// 创建 EGL 上下文，只在第一次 attach 时调用。display 为进程共享的默认 display
+bool OpenGLRenderer::initContext() {
     eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
     if (eglDisplay == EGL_NO_DISPLAY) {
         LOGE("无法获取 EGLDisplay");
@@ -56,6 +58,7 @@ static bool initEGL(ANativeWindow* window) {
     }
     if (eglInitialize(eglDisplay, nullptr, nullptr) != EGL_TRUE) {
         LOGE("无法初始化 EGL");
+        eglDisplay = EGL_NO_DISPLAY;
         return false;
     }
     const EGLint configAttribs[] = {
@@ -68,44 +71,100 @@ static bool initEGL(ANativeWindow* window) {
             EGL_DEPTH_SIZE,      8,
             EGL_NONE
     };
-    EGLConfig config;
     EGLint numConfigs;
-    if (eglChooseConfig(eglDisplay, configAttribs, &config, 1, &numConfigs) != EGL_TRUE) {
+    if (eglChooseConfig(eglDisplay, configAttribs, &eglConfig, 1, &numConfigs) != EGL_TRUE || numConfigs < 1) {
         LOGE("无法选择 EGLConfig");
         return false;
     }
-    eglSurface = eglCreateWindowSurface(eglDisplay, config, window, nullptr);
-    if (eglSurface == EGL_NO_SURFACE) {
-        LOGE("无法创建 EGLSurface");
-        return false;
-    }
     const EGLint contextAttribs[] = {
             EGL_CONTEXT_CLIENT_VERSION, 2,
             EGL_NONE
     };
-    eglContext = eglCreateContext(eglDisplay, config, EGL_NO_CONTEXT, contextAttribs);
+    eglContext = eglCreateContext(eglDisplay, eglConfig, EGL_NO_CONTEXT, contextAttribs);
     if (eglContext == EGL_NO_CONTEXT) {
         LOGE("无法创建 EGLContext");
         return false;
     }
-    if (eglMakeCurrent(eglDisplay, eglSurface, eglSurface, eglContext) != EGL_TRUE) {
-        LOGE("无法设置当前 EGLContext");
+    return true;
+}
+
+static GLuint linkProgram(const char* fShaderStr) {
+    // 编译顶点着色器与片段着色器源码
+    GLuint vertexShader = loadShader(GL_VERTEX_SHADER, vShaderStr);
+    GLuint fragmentShader = loadShader(GL_FRAGMENT_SHADER, fShaderStr);
+    if (!vertexShader || !fragmentShader) {
+        return 0;
+    }
+
+    GLuint program = glCreateProgram(); // 创建程序对象
+    if (program == 0) {
+        return 0;
+    }
+    glAttachShader(program, vertexShader); // 添加顶点着色器与片段着色器
+    glAttachShader(program, fragmentShader);
+    glLinkProgram(program); // 链接程序对象
+    // 着色器已链接进程序，标记删除，随程序一起释放
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+
+    GLint linked;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        char info[512] = {0};
+        glGetProgramInfoLog(program, sizeof(info), nullptr, info);
+        LOGE("Could not link program: %s", info);
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+// YUV420P 程序：三个单通道纹理分别存放 Y、U、V 平面，在着色器中按 BT.601 转为 RGB。
+// 纹理宽度取平面的 linesize 以免逐行重排，uCrop 给出有效宽度占纹理宽度的比例（x 为亮度，y 为色度）
+bool OpenGLRenderer::initYUVProgram() {
+    const char* fShaderStr =
+            "precision mediump float;                                                  \n"
+            "varying vec2 vTexCoord;                                                   \n"
+            "uniform sampler2D sTextureY;                                              \n"
+            "uniform sampler2D sTextureU;                                              \n"
+            "uniform sampler2D sTextureV;                                              \n"
+            "uniform vec2 uCrop;                                                       \n"
+            "void main()                                                               \n"
+            "{                                                                         \n"
+            "  vec2 lumaCoord = vec2(vTexCoord.x * uCrop.x, vTexCoord.y);              \n"
+            "  vec2 chromaCoord = vec2(vTexCoord.x * uCrop.y, vTexCoord.y);            \n"
+            "  float y = 1.164 * (texture2D(sTextureY, lumaCoord).r - 0.0625);         \n"
+            "  float u = texture2D(sTextureU, chromaCoord).r - 0.5;                    \n"
+            "  float v = texture2D(sTextureV, chromaCoord).r - 0.5;                    \n"
+            "  gl_FragColor = vec4(y + 1.596 * v, y - 0.392 * u - 0.813 * v, y + 2.017 * u, 1.0); \n"
+            "}                                                                         \n";
+
+    yuvProgramObject = linkProgram(fShaderStr);
+    if (yuvProgramObject == 0) {
         return false;
     }
+    yuvAttrPosition = glGetAttribLocation(yuvProgramObject, "aPosition");
+    yuvAttrTexCoord = glGetAttribLocation(yuvProgramObject, "aTexCoord");
+    yuvUniTextures[0] = glGetUniformLocation(yuvProgramObject, "sTextureY");
+    yuvUniTextures[1] = glGetUniformLocation(yuvProgramObject, "sTextureU");
+    yuvUniTextures[2] = glGetUniformLocation(yuvProgramObject, "sTextureV");
+    yuvUniCrop = glGetUniformLocation(yuvProgramObject, "uCrop");
+
+    glGenTextures(3, yuvTextureIds);
+    for (int i = 0; i < 3; i++) {
+        glBindTexture(GL_TEXTURE_2D, yuvTextureIds[i]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        yuvTextureWidths[i] = 0;
+        yuvTextureHeights[i] = 0;
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
     return true;
 }
 
-static bool initGL(int width, int height) {
-    // 顶点着色器
-    const char* vShaderStr =
-            "attribute vec4 aPosition;    \n"
-            "attribute vec2 aTexCoord;    \n"
-            "varying vec2 vTexCoord;      \n"
-            "void main()                \n"
-            "{                          \n"
-            "   gl_Position = aPosition;\n"
-            "   vTexCoord = aTexCoord;  \n"
-            "}                          \n";
+bool OpenGLRenderer::initRGBAProgram() {
     // 片段着色器
     const char* fShaderStr =
             "precision mediump float;                           \n"
@@ -116,71 +175,121 @@ static bool initGL(int width, int height) {
             "  gl_FragColor = texture2D(sTexture, vTexCoord);    \n"
             "}                                                  \n";
 
-    // 编译顶点着色器与片段着色器源码
-    GLuint vertexShader = loadShader(GL_VERTEX_SHADER, vShaderStr);
-    GLuint fragmentShader = loadShader(GL_FRAGMENT_SHADER, fShaderStr);
-    if (!vertexShader || !fragmentShader) {
-        return false;
-    }
-
-    programObject = glCreateProgram(); // 创建程序对象
+    programObject = linkProgram(fShaderStr);
     if (programObject == 0) {
         return false;
     }
-    glAttachShader(programObject, vertexShader); // 添加顶点着色器与片段着色器
-    glAttachShader(programObject, fragmentShader);
-    glLinkProgram(programObject); // 链接程序对象
-
-    GLint linked;
-    glGetProgramiv(programObject, GL_LINK_STATUS, &linked);
-    if (!linked) {
-        char info[512] = {0};
-        glGetProgramInfoLog(programObject, sizeof(info), nullptr, info);
-        LOGE("Could not link program: %s", info);
-        glDeleteProgram(programObject);
-        return false;
-    }
 
     // 获取attribute与uniform 位置
     attrPosition = glGetAttribLocation(programObject, "aPosition");
     attrTexCoord = glGetAttribLocation(programObject, "aTexCoord");
     uniTexture = glGetUniformLocation(programObject, "sTexture");
 
-    // 创建纹理对象
+    // 创建纹理对象，存储在第一帧按帧尺寸分配
     glGenTextures(1, &textureId);
     glBindTexture(GL_TEXTURE_2D, textureId);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    // 预分配纹理内存（GL_RGBA 格式）
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glBindTexture(GL_TEXTURE_2D, 0);
+    rgbaTextureWidth = 0;
+    rgbaTextureHeight = 0;
+    return true;
+}
 
+// 编译着色器并创建纹理与 VBO，上下文第一次 current 时调用
+bool OpenGLRenderer::initPrograms() {
+    if (!initRGBAProgram() || !initYUVProgram()) {
+        return false;
+    }
     // 创建VBO存放顶点数据
     glGenBuffers(1, &vbo);
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-    glViewport(0, 0, width, height);
     return true;
 }
 
-// 初始化 OpenGL
-bool initOpenGL(ANativeWindow* window, int width, int height) {
-    if (!initEGL(window)) {
+OpenGLRenderer::~OpenGLRenderer() {
+    // 进程退出时 EGL 可能已不可用，GL 资源随进程回收，这里只归还窗口引用
+    if (surfaceWindow) {
+        ANativeWindow_release(surfaceWindow);
+    }
+}
+
+bool OpenGLRenderer::attach(ANativeWindow* window) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (eglContext == EGL_NO_CONTEXT && !initContext()) {
         return false;
     }
-    if (!initGL(width, height)) {
+    // 换了窗口才重建 EGLSurface
+    if (window != surfaceWindow) {
+        destroySurfaceLocked();
+    }
+    if (eglSurface == EGL_NO_SURFACE) {
+        eglSurface = eglCreateWindowSurface(eglDisplay, eglConfig, window, nullptr);
+        if (eglSurface == EGL_NO_SURFACE) {
+            LOGE("无法创建 EGLSurface");
+            return false;
+        }
+        surfaceWindow = window;
+        ANativeWindow_acquire(surfaceWindow);
+    }
+    if (eglMakeCurrent(eglDisplay, eglSurface, eglSurface, eglContext) != EGL_TRUE) {
+        LOGE("无法设置当前 EGLContext");
         return false;
     }
+    if (!programsReady) {
+        programsReady = initPrograms();
+        if (!programsReady) {
+            return false;
+        }
+        LOGI("OpenGL 上下文与着色器已创建");
+    }
     return true;
 }
 
+void OpenGLRenderer::detach() {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (eglDisplay != EGL_NO_DISPLAY) {
+        eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    }
+}
+
+void OpenGLRenderer::releaseSurface() {
+    std::lock_guard<std::mutex> lock(mtx);
+    destroySurfaceLocked();
+}
+
+// 仍是某个线程的 current surface 时，EGL 会推迟到它不再 current 时才真正销毁
+void OpenGLRenderer::destroySurfaceLocked() {
+    if (eglSurface != EGL_NO_SURFACE) {
+        eglDestroySurface(eglDisplay, eglSurface);
+        eglSurface = EGL_NO_SURFACE;
+    }
+    if (surfaceWindow) {
+        ANativeWindow_release(surfaceWindow);
+        surfaceWindow = nullptr;
+    }
+}
+
 // 渲染一帧视频帧
-void renderFrame(uint8_t* rgbaData, int width, int height) {
-    glBindTexture(GL_TEXTURE_2D, textureId);     // 更新纹理数据
-    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0,
-                    width, height,
-                    GL_RGBA, GL_UNSIGNED_BYTE, rgbaData);
+void OpenGLRenderer::renderFrame(uint8_t* rgbaData, int width, int height) {
+    {
+        ScopedStageTimer timer(Stage::Upload);
+        TRACE_SCOPE("glTexSubImage2D");
+        glBindTexture(GL_TEXTURE_2D, textureId);     // 更新纹理数据
+        if (rgbaTextureWidth != width || rgbaTextureHeight != height) {
+            // 输出尺寸随窗口调整，纹理跟着重新分配
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgbaData);
+            rgbaTextureWidth = width;
+            rgbaTextureHeight = height;
+        } else {
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0,
+                            width, height,
+                            GL_RGBA, GL_UNSIGNED_BYTE, rgbaData);
+        }
+    }
 
     glClear(GL_COLOR_BUFFER_BIT);     // 清除画面，开始绘制
     glUseProgram(programObject);
@@ -198,34 +307,58 @@ void renderFrame(uint8_t* rgbaData, int width, int height) {
 
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);     // 绘制四边形
 
+    ScopedStageTimer timer(Stage::Swap);
+    TRACE_SCOPE("eglSwapBuffers");
     eglSwapBuffers(eglDisplay, eglSurface);     // 刷新屏幕
 }
 
-// 释放 OpenGL 相关资源
-void cleanupOpenGL() {
-    if (vbo) {
-        glDeleteBuffers(1, &vbo);
-        vbo = 0;
-    }
-    if (textureId) {
-        glDeleteTextures(1, &textureId);
-        textureId = 0;
+void OpenGLRenderer::resizeViewport(int width, int height) {
+    glViewport(0, 0, width, height);
+}
+
+// 渲染一帧 YUV420P 视频帧，三个平面直接上传为单通道纹理
+void OpenGLRenderer::renderFrameYUV420P(uint8_t* const planes[3], const int linesizes[3], int width, int height) {
+    const int planeHeights[3] = {height, (height + 1) / 2, (height + 1) / 2};
+    {
+        ScopedStageTimer timer(Stage::Upload);
+        TRACE_SCOPE("glTexSubImage2D");
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (int i = 0; i < 3; i++) {
+            glActiveTexture(GL_TEXTURE0 + i);
+            glBindTexture(GL_TEXTURE_2D, yuvTextureIds[i]);
+            if (yuvTextureWidths[i] != linesizes[i] || yuvTextureHeights[i] != planeHeights[i]) {
+                // 平面尺寸变化时才重新分配纹理，其余帧只更新内容
+                glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, linesizes[i], planeHeights[i], 0,
+                             GL_LUMINANCE, GL_UNSIGNED_BYTE, planes[i]);
+                yuvTextureWidths[i] = linesizes[i];
+                yuvTextureHeights[i] = planeHeights[i];
+            } else {
+                glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, linesizes[i], planeHeights[i],
+                                GL_LUMINANCE, GL_UNSIGNED_BYTE, planes[i]);
+            }
+        }
     }
-    if (programObject) {
-        glDeleteProgram(programObject);
-        programObject = 0;
+
+    glClear(GL_COLOR_BUFFER_BIT);
+    glUseProgram(yuvProgramObject);
+
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glEnableVertexAttribArray(yuvAttrPosition);
+    glVertexAttribPointer(yuvAttrPosition, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (const void*)0);
+    glEnableVertexAttribArray(yuvAttrTexCoord);
+    glVertexAttribPointer(yuvAttrTexCoord, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (const void*)(3 * sizeof(GLfloat)));
+
+    for (int i = 0; i < 3; i++) {
+        glUniform1i(yuvUniTextures[i], i);
     }
-    if (eglDisplay != EGL_NO_DISPLAY) {
-        eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
-        if (eglContext != EGL_NO_CONTEXT) {
-            eglDestroyContext(eglDisplay, eglContext);
-            eglContext = EGL_NO_CONTEXT;
-        }
-        if (eglSurface != EGL_NO_SURFACE) {
-            eglDestroySurface(eglDisplay, eglSurface);
-            eglSurface = EGL_NO_SURFACE;
-        }
-        eglTerminate(eglDisplay);
-        eglDisplay = EGL_NO_DISPLAY;
+    glUniform2f(yuvUniCrop, width / (float)linesizes[0], ((width + 1) / 2) / (float)linesizes[1]);
+
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+    {
+        ScopedStageTimer timer(Stage::Swap);
+        TRACE_SCOPE("eglSwapBuffers");
+        eglSwapBuffers(eglDisplay, eglSurface);
     }
+    glActiveTexture(GL_TEXTURE0);
 }
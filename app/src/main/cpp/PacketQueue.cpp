@@ -2,11 +2,11 @@
 #include <cstring>
 
 
-PacketQueue::PacketQueue() : finished(false) {}
+PacketQueue::PacketQueue() : finished(false), serial(0) {}
 
 PacketQueue::~PacketQueue() {
     while (!queue.empty()) {
-        AVPacket* pkt = queue.front();
+        AVPacket* pkt = queue.front().pkt;
         queue.pop();
         av_packet_free(&pkt);
     }
@@ -17,18 +17,21 @@ void PacketQueue::push(AVPacket* pkt) {
 
     AVPacket* new_pkt = av_packet_alloc();
     av_packet_ref(new_pkt, pkt);
-    queue.push(new_pkt);
+    queue.push({new_pkt, serial});
     cond.notify_one();
 }
 
-bool PacketQueue::pop(AVPacket* pkt) {
+bool PacketQueue::pop(AVPacket* pkt, int* serial) {
     std::unique_lock<std::mutex> lock(mtx);
     // 如果队列为空且还未结束，则等待
     while (queue.empty() && !finished) {
         cond.wait(lock);
     }
     if (!queue.empty()) {
-        AVPacket* front_pkt = queue.front();
+        AVPacket* front_pkt = queue.front().pkt;
+        if (serial) {
+            *serial = queue.front().serial;
+        }
         queue.pop();
         // 交换数据到外部传入的pkt
         av_packet_move_ref(pkt, front_pkt);
@@ -49,27 +52,26 @@ bool PacketQueue::isFinished() {
     return finished;
 }
 
-
-// PCM音频队列方法
-void SafeQueue::push(uint8_t* data, size_t size) {
-    std::unique_lock<std::mutex> lock(mutex_);
-    std::unique_ptr<uint8_t[]> ptr(new uint8_t[size]);
-    std::copy(data, data + size, ptr.get());
-    queue_.push(std::move(ptr));
-    cond_.notify_one();
+int PacketQueue::nextSerial() {
+    std::unique_lock<std::mutex> lock(mtx);
+    return ++serial;
 }
 
-std::unique_ptr<uint8_t[]> SafeQueue::pop() {
-    std::unique_lock<std::mutex> lock(mutex_);
-    cond_.wait(lock, [this]() { return !queue_.empty(); });
-    std::unique_ptr<uint8_t[]> data = std::move(queue_.front());
-    queue_.pop();
-    return data;
+int PacketQueue::currentSerial() {
+    std::unique_lock<std::mutex> lock(mtx);
+    return serial;
 }
 
-bool SafeQueue::empty() const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return queue_.empty();
+void PacketQueue::flush() {
+    std::unique_lock<std::mutex> lock(mtx);
+    while (!queue.empty()) {
+        AVPacket* pkt = queue.front().pkt;
+        queue.pop();
+        av_packet_free(&pkt);
+    }
 }
 
-
+int PacketQueue::size() {
+    std::unique_lock<std::mutex> lock(mtx);
+    return (int)queue.size();
+}
@@ -0,0 +1,67 @@
+#include "PcmRing.h"
+#include <string.h>
+#include <algorithm>
+
+void PcmRing::reset(size_t capacity) {
+    buffer.assign(capacity, 0);
+    read_pos.store(0, std::memory_order_relaxed);
+    write_pos.store(0, std::memory_order_relaxed);
+}
+
+size_t PcmRing::readable() const {
+    return write_pos.load(std::memory_order_acquire) - read_pos.load(std::memory_order_relaxed);
+}
+
+size_t PcmRing::writable() const {
+    return buffer.size() - (write_pos.load(std::memory_order_relaxed) - read_pos.load(std::memory_order_acquire));
+}
+
+int16_t* PcmRing::writePointer(size_t* contiguous) {
+    if (buffer.empty()) {
+        *contiguous = 0;
+        return nullptr;
+    }
+    size_t index = write_pos.load(std::memory_order_relaxed) % buffer.size();
+    *contiguous = std::min(writable(), buffer.size() - index);
+    return buffer.data() + index;
+}
+
+void PcmRing::commitWrite(size_t samples) {
+    // release：消费者看到新的写位置时，数据已经写好
+    write_pos.store(write_pos.load(std::memory_order_relaxed) + samples, std::memory_order_release);
+}
+
+size_t PcmRing::write(const int16_t* data, size_t samples) {
+    size_t written = 0;
+    while (written < samples) {
+        size_t contiguous;
+        int16_t* dst = writePointer(&contiguous);
+        size_t n = std::min(contiguous, samples - written);
+        if (n == 0) {
+            break;
+        }
+        memcpy(dst, data + written, n * sizeof(int16_t));
+        commitWrite(n);
+        written += n;
+    }
+    return written;
+}
+
+size_t PcmRing::read(int16_t* out, size_t samples) {
+    size_t pos = read_pos.load(std::memory_order_relaxed);
+    size_t n = std::min(samples, readable());
+    if (n == 0) {
+        return 0;
+    }
+    size_t index = pos % buffer.size();
+    size_t first = std::min(n, buffer.size() - index);
+    memcpy(out, buffer.data() + index, first * sizeof(int16_t));
+    memcpy(out + first, buffer.data(), (n - first) * sizeof(int16_t));
+    // release：生产者看到新的读位置时，这部分空间已读完
+    read_pos.store(pos + n, std::memory_order_release);
+    return n;
+}
+
+void PcmRing::clear() {
+    read_pos.store(write_pos.load(std::memory_order_acquire), std::memory_order_release);
+}
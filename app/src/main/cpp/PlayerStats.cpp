@@ -0,0 +1,209 @@
+#include "PlayerStats.h"
+#include <stdio.h>
+#include <time.h>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include "Log.h"
+
+#define LOG_TAG "PlayerStats"
+
+namespace {
+
+// 按 2 的幂划分的耗时桶：第 i 个桶覆盖 [2^(i-1), 2^i) 微秒，最后一个桶收纳所有更长的耗时
+const int BUCKET_COUNT = 24;
+
+struct Histogram {
+    std::atomic<uint64_t> buckets[BUCKET_COUNT];
+    std::atomic<uint64_t> total_us;
+    std::atomic<int64_t> max_us;
+};
+
+const char* const stageNames[] = {
+        "demux", "queue_wait", "decode", "convert", "upload", "swap", "audio_callback", "frame_step",
+};
+const char* const counterNames[] = {
+        "packets_read", "frames_decoded", "frames_rendered", "frames_dropped", "frames_late", "audio_underruns",
+};
+const char* const gaugeNames[] = {
+        "video_queue_depth", "audio_queue_depth", "av_drift_us", "audio_latency_us",
+};
+const char* const startupNames[] = {
+        "open_input_us", "find_stream_info_us", "open_audio_decoder_us", "open_video_decoder_us",
+        "start_threads_us", "first_frame_decoded_us", "first_frame_rendered_us",
+};
+
+Histogram histograms[(int)Stage::Count];
+std::atomic<uint64_t> counters[(int)Counter::Count];
+std::atomic<int64_t> gauges[(int)Gauge::Count];
+std::atomic<int64_t> startup[(int)StartupPhase::Count];
+std::atomic<int64_t> startup_begin_us(0);
+
+std::mutex dump_mutex;
+std::condition_variable dump_cond;
+int dump_interval_ms = 0;
+bool dump_thread_running = false;
+
+int bucketOf(int64_t us) {
+    if (us <= 0) {
+        return 0;
+    }
+    int bucket = 64 - __builtin_clzll((uint64_t)us);
+    return bucket < BUCKET_COUNT ? bucket : BUCKET_COUNT - 1;
+}
+
+// 估算分位数，返回所在桶的上界（微秒）
+int64_t percentile(const uint64_t* buckets, uint64_t count, double p) {
+    if (count == 0) {
+        return 0;
+    }
+    uint64_t target = (uint64_t)(count * p);
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKET_COUNT; i++) {
+        seen += buckets[i];
+        if (seen > target) {
+            return i == 0 ? 0 : (1LL << i);
+        }
+    }
+    return 1LL << (BUCKET_COUNT - 1);
+}
+
+void dumpLoop() {
+    std::unique_lock<std::mutex> lock(dump_mutex);
+    while (dump_interval_ms > 0) {
+        dump_cond.wait_for(lock, std::chrono::milliseconds(dump_interval_ms));
+        if (dump_interval_ms <= 0) {
+            break;
+        }
+        // 快照远超单条日志的长度上限，分段输出
+        Logger::printLong(LOG_LEVEL_INFO, LOG_TAG, PlayerStats::snapshotJson().c_str());
+    }
+    dump_thread_running = false;
+}
+
+} // namespace
+
+
+int64_t PlayerStats::nowUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+void PlayerStats::record(Stage stage, int64_t us) {
+    Histogram& h = histograms[(int)stage];
+    h.buckets[bucketOf(us)].fetch_add(1, std::memory_order_relaxed);
+    h.total_us.fetch_add(us > 0 ? us : 0, std::memory_order_relaxed);
+    int64_t prev = h.max_us.load(std::memory_order_relaxed);
+    while (us > prev && !h.max_us.compare_exchange_weak(prev, us, std::memory_order_relaxed)) {
+    }
+}
+
+void PlayerStats::increment(Counter counter, uint64_t n) {
+    counters[(int)counter].fetch_add(n, std::memory_order_relaxed);
+}
+
+void PlayerStats::setGauge(Gauge gauge, int64_t value) {
+    gauges[(int)gauge].store(value, std::memory_order_relaxed);
+}
+
+void PlayerStats::reset() {
+    for (Histogram& h : histograms) {
+        for (std::atomic<uint64_t>& b : h.buckets) {
+            b.store(0, std::memory_order_relaxed);
+        }
+        h.total_us.store(0, std::memory_order_relaxed);
+        h.max_us.store(0, std::memory_order_relaxed);
+    }
+    for (std::atomic<uint64_t>& c : counters) {
+        c.store(0, std::memory_order_relaxed);
+    }
+    for (std::atomic<int64_t>& g : gauges) {
+        g.store(0, std::memory_order_relaxed);
+    }
+}
+
+void PlayerStats::beginStartup() {
+    for (std::atomic<int64_t>& phase : startup) {
+        phase.store(-1, std::memory_order_relaxed);
+    }
+    startup_begin_us.store(nowUs(), std::memory_order_release);
+}
+
+void PlayerStats::recordStartup(StartupPhase phase, int64_t us) {
+    startup[(int)phase].store(us, std::memory_order_relaxed);
+}
+
+bool PlayerStats::markStartup(StartupPhase phase) {
+    std::atomic<int64_t>& slot = startup[(int)phase];
+    if (slot.load(std::memory_order_relaxed) >= 0) {
+        return false;
+    }
+    int64_t expected = -1;
+    int64_t elapsed = nowUs() - startup_begin_us.load(std::memory_order_acquire);
+    return slot.compare_exchange_strong(expected, elapsed, std::memory_order_relaxed);
+}
+
+std::string PlayerStats::startupJson() {
+    std::string json = "{";
+    char buf[64];
+    for (int i = 0; i < (int)StartupPhase::Count; i++) {
+        snprintf(buf, sizeof(buf), "%s\"%s\":%lld", i ? "," : "", startupNames[i],
+                 (long long)startup[i].load(std::memory_order_relaxed));
+        json += buf;
+    }
+    json += "}";
+    return json;
+}
+
+std::string PlayerStats::snapshotJson() {
+    std::string json = "{\"stages\":{";
+    char buf[256];
+    for (int i = 0; i < (int)Stage::Count; i++) {
+        Histogram& h = histograms[i];
+        uint64_t buckets[BUCKET_COUNT];
+        uint64_t count = 0;
+        for (int b = 0; b < BUCKET_COUNT; b++) {
+            buckets[b] = h.buckets[b].load(std::memory_order_relaxed);
+            count += buckets[b];
+        }
+        uint64_t total = h.total_us.load(std::memory_order_relaxed);
+        snprintf(buf, sizeof(buf),
+                 "%s\"%s\":{\"count\":%llu,\"avg_us\":%lld,\"max_us\":%lld,\"p50_us\":%lld,\"p90_us\":%lld,\"p99_us\":%lld}",
+                 i ? "," : "", stageNames[i], (unsigned long long)count,
+                 (long long)(count ? total / count : 0),
+                 (long long)h.max_us.load(std::memory_order_relaxed),
+                 (long long)percentile(buckets, count, 0.5),
+                 (long long)percentile(buckets, count, 0.9),
+                 (long long)percentile(buckets, count, 0.99));
+        json += buf;
+    }
+    json += "},\"counters\":{";
+    for (int i = 0; i < (int)Counter::Count; i++) {
+        snprintf(buf, sizeof(buf), "%s\"%s\":%llu", i ? "," : "", counterNames[i],
+                 (unsigned long long)counters[i].load(std::memory_order_relaxed));
+        json += buf;
+    }
+    json += "},\"gauges\":{";
+    for (int i = 0; i < (int)Gauge::Count; i++) {
+        snprintf(buf, sizeof(buf), "%s\"%s\":%lld", i ? "," : "", gaugeNames[i],
+                 (long long)gauges[i].load(std::memory_order_relaxed));
+        json += buf;
+    }
+    json += "},\"startup\":";
+    json += startupJson();
+    json += "}";
+    return json;
+}
+
+void PlayerStats::setDumpInterval(int intervalMs) {
+    std::lock_guard<std::mutex> lock(dump_mutex);
+    dump_interval_ms = intervalMs;
+    dump_cond.notify_all();
+    if (intervalMs > 0 && !dump_thread_running) {
+        dump_thread_running = true;
+        std::thread(dumpLoop).detach();
+    }
+}
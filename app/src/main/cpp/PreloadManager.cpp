@@ -0,0 +1,302 @@
+#include "PreloadManager.h"
+#include <algorithm>
+#include "FrameConverter.h"
+#include "FramePool.h"
+#include "StreamInfoCache.h"
+#include "TrackSelector.h"
+#include "FileIO.h"
+#include "Log.h"
+extern "C" {
+#include <libavutil/time.h>
+}
+
+#define LOG_TAG "PreloadManager"
+
+PreloadedMedia::~PreloadedMedia() {
+    for (AVPacket* pkt : packets) {
+        av_packet_free(&pkt);
+    }
+    av_frame_free(&first_frame);
+    avcodec_free_context(&video_ctx);
+    avcodec_free_context(&audio_ctx);
+    FileIO::closeInput(&fmt_ctx);
+}
+
+PreloadManager::PreloadManager(FramePool* pool, const AVPixelFormat* sinkFormats)
+        : frame_pool(pool), sink_formats(sinkFormats) {
+    worker = std::thread(&PreloadManager::workerLoop, this);
+}
+
+PreloadManager::~PreloadManager() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        running = false;
+        for (auto& entry : entries) {
+            entry->cancelled = true;
+        }
+    }
+    cond.notify_all();
+    worker.join();
+}
+
+void PreloadManager::preload(const std::vector<std::string>& urls) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        // 倒序移到表头，列表中第一个地址位于最前，优先加载且最后被淘汰
+        for (auto url = urls.rbegin(); url != urls.rend(); ++url) {
+            auto it = std::find_if(entries.begin(), entries.end(),
+                                   [&](const std::shared_ptr<Entry>& e) { return e->url == *url; });
+            if (it != entries.end()) {
+                entries.splice(entries.begin(), entries, it);
+            } else {
+                auto entry = std::make_shared<Entry>();
+                entry->url = *url;
+                entries.push_front(entry);
+            }
+        }
+        item_budget = memory_budget / std::max<size_t>(urls.size(), 1);
+        evictLocked();
+    }
+    cond.notify_all();
+}
+
+std::unique_ptr<PreloadedMedia> PreloadManager::take(const std::string& url, bool waitPending) {
+    std::unique_lock<std::mutex> lock(mtx);
+    while (true) {
+        auto it = std::find_if(entries.begin(), entries.end(),
+                               [&](const std::shared_ptr<Entry>& e) { return e->url == url; });
+        if (it == entries.end()) {
+            return nullptr;
+        }
+        std::shared_ptr<Entry> entry = *it;
+        if (entry->state == State::Loading || (waitPending && entry->state == State::Pending)) {
+            // 已经开始加载，等待比重新打开更快
+            cond.wait(lock);
+            continue;
+        }
+        entries.erase(it);
+        if (entry->state == State::Pending) {
+            return nullptr;
+        }
+        used_bytes -= entry->media->bytes;
+        LOGI("命中预加载：%s，缓存 %zu 个数据包", url.c_str(), entry->media->packets.size());
+        return std::move(entry->media);
+    }
+}
+
+void PreloadManager::setMemoryBudget(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mtx);
+    memory_budget = bytes;
+    evictLocked();
+}
+
+void PreloadManager::setOptions(double seconds, bool decodeFirstFrame) {
+    std::lock_guard<std::mutex> lock(mtx);
+    preload_seconds = seconds;
+    decode_first_frame = decodeFirstFrame;
+}
+
+void PreloadManager::clear() {
+    std::lock_guard<std::mutex> lock(mtx);
+    for (auto& entry : entries) {
+        entry->cancelled = true;
+    }
+    entries.clear();
+    used_bytes = 0;
+}
+
+// 淘汰最久未使用的已加载条目，直到占用回到预算以内
+void PreloadManager::evictLocked() {
+    for (auto it = entries.end(); used_bytes > memory_budget && it != entries.begin();) {
+        --it;
+        if ((*it)->state != State::Ready) {
+            continue;
+        }
+        LOGD("淘汰预加载：%s", (*it)->url.c_str());
+        used_bytes -= (*it)->media->bytes;
+        it = entries.erase(it);
+    }
+}
+
+int PreloadManager::interruptCallback(void* opaque) {
+    return static_cast<Entry*>(opaque)->cancelled ? 1 : 0;
+}
+
+void PreloadManager::workerLoop() {
+    std::unique_lock<std::mutex> lock(mtx);
+    while (running) {
+        auto it = std::find_if(entries.begin(), entries.end(),
+                               [](const std::shared_ptr<Entry>& e) { return e->state == State::Pending; });
+        if (it == entries.end()) {
+            cond.wait(lock);
+            continue;
+        }
+        std::shared_ptr<Entry> entry = *it;
+        entry->state = State::Loading;
+        double seconds = preload_seconds;
+        bool first_frame = decode_first_frame;
+        size_t budget = item_budget;
+        lock.unlock();
+        int64_t load_start = av_gettime_relative();
+        int ret = load(entry.get(), seconds, first_frame, budget);
+        lock.lock();
+
+        if (ret < 0 || entry->cancelled) {
+            // 失败或加载期间被淘汰、清空
+            entries.remove(entry);
+            if (ret < 0 && !entry->cancelled) {
+                LOGW("预加载失败：%s，%d", entry->url.c_str(), ret);
+            }
+        } else {
+            entry->state = State::Ready;
+            used_bytes += entry->media->bytes;
+            LOGI("预加载完成：%s，%zu 字节，耗时 %lld ms", entry->url.c_str(), entry->media->bytes,
+                 (long long)((av_gettime_relative() - load_start) / 1000));
+            evictLocked();
+        }
+        cond.notify_all();
+    }
+}
+
+static AVCodecContext* openDecoder(AVStream* st, FramePool* pool) {
+    AVCodec* codec = avcodec_find_decoder(st->codecpar->codec_id);
+    if (!codec) {
+        return nullptr;
+    }
+    AVCodecContext* ctx = avcodec_alloc_context3(codec);
+    if (!ctx) {
+        return nullptr;
+    }
+    if (avcodec_parameters_to_context(ctx, st->codecpar) < 0) {
+        avcodec_free_context(&ctx);
+        return nullptr;
+    }
+    if (pool && st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
+        pool->attach(ctx);
+    }
+    if (avcodec_open2(ctx, codec, nullptr) < 0) {
+        avcodec_free_context(&ctx);
+        return nullptr;
+    }
+    return ctx;
+}
+
+int PreloadManager::load(Entry* entry, double seconds, bool withFirstFrame, size_t budget) {
+    std::unique_ptr<PreloadedMedia> media(new PreloadedMedia());
+    media->url = entry->url;
+    media->fmt_ctx = avformat_alloc_context();
+    if (!media->fmt_ctx) {
+        return AVERROR(ENOMEM);
+    }
+    media->fmt_ctx->interrupt_callback.callback = interruptCallback;
+    media->fmt_ctx->interrupt_callback.opaque = entry;
+    int ret = FileIO::openInput(&media->fmt_ctx, entry->url.c_str(), nullptr);
+    if (ret < 0) {
+        return ret;
+    }
+    // 列表里的短视频总是从头播放，缓存中的播放位置不使用
+    double last_position;
+    if (!StreamInfoCache::load(entry->url.c_str(), media->fmt_ctx, &last_position)) {
+        if ((ret = avformat_find_stream_info(media->fmt_ctx, nullptr)) < 0) {
+            return ret;
+        }
+        StreamInfoCache::save(entry->url.c_str(), media->fmt_ctx);
+    }
+
+    media->video_stream_index = TrackSelector::choose(media->fmt_ctx, AVMEDIA_TYPE_VIDEO);
+    if (media->video_stream_index < 0) {
+        return media->video_stream_index;
+    }
+    media->audio_stream_index = TrackSelector::choose(media->fmt_ctx, AVMEDIA_TYPE_AUDIO);
+    AVStream* video_stream = media->fmt_ctx->streams[media->video_stream_index];
+    media->video_ctx = openDecoder(video_stream, frame_pool);
+    if (!media->video_ctx) {
+        return AVERROR_DECODER_NOT_FOUND;
+    }
+    if (media->audio_stream_index >= 0) {
+        media->audio_ctx = openDecoder(media->fmt_ctx->streams[media->audio_stream_index], nullptr);
+        if (!media->audio_ctx) {
+            media->audio_stream_index = -1;
+        }
+    }
+
+    // 读取开头 seconds 秒的数据包，超过单个条目的内存上限时提前结束；其余流在解封装层丢弃
+    TrackSelector::applyDiscard(media->fmt_ctx, media->video_stream_index, media->audio_stream_index);
+    int64_t start_pts = video_stream->start_time != AV_NOPTS_VALUE ? video_stream->start_time : 0;
+    int64_t end_pts = start_pts + av_rescale_q((int64_t)(seconds * AV_TIME_BASE), AV_TIME_BASE_Q, video_stream->time_base);
+    AVPacket* pkt = av_packet_alloc();
+    while (!entry->cancelled && media->bytes < budget) {
+        if (av_read_frame(media->fmt_ctx, pkt) < 0) {
+            break;
+        }
+        if (pkt->stream_index != media->video_stream_index && pkt->stream_index != media->audio_stream_index) {
+            av_packet_unref(pkt);
+            continue;
+        }
+        bool done = pkt->stream_index == media->video_stream_index
+                    && pkt->pts != AV_NOPTS_VALUE && pkt->pts >= end_pts;
+        media->bytes += pkt->size;
+        media->packets.push_back(av_packet_clone(pkt));
+        av_packet_unref(pkt);
+        if (done) {
+            break;
+        }
+    }
+    av_packet_free(&pkt);
+    if (entry->cancelled) {
+        return AVERROR_EXIT;
+    }
+
+    if (withFirstFrame && decodeFirstFrame(media.get()) < 0) {
+        LOGW("首帧预解码失败：%s", entry->url.c_str());
+    }
+    entry->media = std::move(media);
+    return 0;
+}
+
+// 解码第一帧并转换为渲染端格式，完成后清空解码器状态，播放时仍从第一个数据包开始送入
+int PreloadManager::decodeFirstFrame(PreloadedMedia* media) {
+    AVFrame* frame = av_frame_alloc();
+    if (!frame) {
+        return AVERROR(ENOMEM);
+    }
+    int ret = AVERROR(EAGAIN);
+    for (AVPacket* pkt : media->packets) {
+        if (pkt->stream_index != media->video_stream_index) {
+            continue;
+        }
+        if (avcodec_send_packet(media->video_ctx, pkt) < 0) {
+            continue;
+        }
+        ret = avcodec_receive_frame(media->video_ctx, frame);
+        if (ret != AVERROR(EAGAIN)) {
+            break;
+        }
+    }
+    // 解码器有延迟时（如帧级多线程）把剩余的帧冲出来
+    if (ret == AVERROR(EAGAIN) && avcodec_send_packet(media->video_ctx, nullptr) >= 0) {
+        ret = avcodec_receive_frame(media->video_ctx, frame);
+    }
+    avcodec_flush_buffers(media->video_ctx);
+    if (ret < 0) {
+        av_frame_free(&frame);
+        return ret;
+    }
+
+    FrameConverter converter;
+    converter.setFramePool(frame_pool);
+    ret = converter.init((AVPixelFormat)frame->format, frame->width, frame->height, sink_formats, "preload");
+    const AVFrame* out = ret < 0 ? nullptr : converter.convert(frame);
+    if (out) {
+        media->first_frame = av_frame_clone(out);
+    }
+    converter.release();
+    av_frame_free(&frame);
+    if (!media->first_frame) {
+        return AVERROR(ENOMEM);
+    }
+    for (int i = 0; i < AV_NUM_DATA_POINTERS && media->first_frame->buf[i]; i++) {
+        media->bytes += media->first_frame->buf[i]->size;
+    }
+    return 0;
+}
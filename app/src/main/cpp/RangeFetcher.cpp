@@ -0,0 +1,475 @@
+#include "RangeFetcher.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <algorithm>
+#include "Log.h"
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavformat/version.h>
+#include <libavutil/mem.h>
+#include <libavutil/dict.h>
+}
+
+#define LOG_TAG "RangeFetcher"
+
+namespace {
+
+const int MAX_RUN_BLOCKS = 4;
+const int MAX_REDIRECTS = 5;
+const size_t MAX_HEADER_BYTES = 16 * 1024;
+// request 的返回值：响应需要改用 FFmpeg 的 http 协议
+const int USE_FFMPEG_HTTP = 1;
+
+struct Endpoint {
+    std::string origin;     // tcp://host:port 或 tls://host:port
+    std::string host;       // Host 请求头
+    std::string path;       // 含查询参数
+};
+
+struct Response {
+    int status = 0;
+    int64_t content_length = -1;
+    int64_t range_start = -1;
+    int64_t total = -1;
+    std::string location;
+    bool keep_alive = true;
+    bool chunked = false;
+};
+
+// 只处理不带认证信息的 http/https 地址，其余交给 FFmpeg
+bool parseEndpoint(const std::string& url, Endpoint* endpoint) {
+    char proto[16], auth[256], host[256], path[4096];
+    int port;
+    av_url_split(proto, sizeof(proto), auth, sizeof(auth), host, sizeof(host), &port,
+                 path, sizeof(path), url.c_str());
+    bool tls = strcmp(proto, "https") == 0;
+    if ((!tls && strcmp(proto, "http") != 0) || !host[0] || auth[0]) {
+        return false;
+    }
+    int default_port = tls ? 443 : 80;
+    if (port < 0) {
+        port = default_port;
+    }
+    std::string name = strchr(host, ':') ? std::string("[") + host + "]" : std::string(host);
+    endpoint->origin = (tls ? "tls://" : "tcp://") + name + ":" + std::to_string(port);
+    endpoint->host = port == default_port ? name : name + ":" + std::to_string(port);
+    endpoint->path = path[0] ? path : "/";
+    return true;
+}
+
+// 按 base 解析 Location 中的相对地址
+std::string resolveLocation(const std::string& base, const std::string& location) {
+    if (location.find("://") != std::string::npos) {
+        return location;
+    }
+    size_t scheme_end = base.find("://");
+    if (scheme_end == std::string::npos) {
+        return location;
+    }
+    if (location.compare(0, 2, "//") == 0) {
+        return base.substr(0, scheme_end + 1) + location;
+    }
+    size_t authority_end = base.find('/', scheme_end + 3);
+    std::string origin = base.substr(0, authority_end);
+    if (!location.empty() && location[0] == '/') {
+        return origin + location;
+    }
+    std::string path = authority_end == std::string::npos ? "/" : base.substr(authority_end);
+    path = path.substr(0, path.find_first_of("?#"));
+    return origin + path.substr(0, path.rfind('/') + 1) + location;
+}
+
+bool parseResponse(const std::string& header, Response* response) {
+    int minor = 0;
+    if (sscanf(header.c_str(), "HTTP/1.%d %d", &minor, &response->status) != 2) {
+        return false;
+    }
+    // HTTP/1.0 默认不保持连接
+    response->keep_alive = minor >= 1;
+    size_t pos = header.find("\r\n");
+    while (pos != std::string::npos && pos + 2 < header.size()) {
+        size_t line = pos + 2;
+        size_t end = header.find("\r\n", line);
+        if (end == std::string::npos) {
+            end = header.size();
+        }
+        size_t colon = header.find(':', line);
+        if (colon != std::string::npos && colon < end) {
+            std::string name = header.substr(line, colon - line);
+            size_t start = colon + 1;
+            while (start < end && (header[start] == ' ' || header[start] == '\t')) {
+                start++;
+            }
+            std::string value = header.substr(start, end - start);
+            if (strcasecmp(name.c_str(), "Content-Length") == 0) {
+                response->content_length = strtoll(value.c_str(), nullptr, 10);
+            } else if (strcasecmp(name.c_str(), "Content-Range") == 0) {
+                long long first, last, total;
+                if (sscanf(value.c_str(), "bytes %lld-%lld/%lld", &first, &last, &total) == 3) {
+                    response->range_start = first;
+                    response->total = total;
+                }
+            } else if (strcasecmp(name.c_str(), "Location") == 0) {
+                response->location = value;
+            } else if (strcasecmp(name.c_str(), "Connection") == 0) {
+                if (strcasecmp(value.c_str(), "close") == 0) {
+                    response->keep_alive = false;
+                } else if (strcasecmp(value.c_str(), "keep-alive") == 0) {
+                    response->keep_alive = true;
+                }
+            } else if (strcasecmp(name.c_str(), "Transfer-Encoding") == 0) {
+                response->chunked = strcasecmp(value.c_str(), "identity") != 0;
+            }
+        }
+        pos = end;
+    }
+    return true;
+}
+
+// 与 FFmpeg http 协议相同的错误码
+int httpError(int status) {
+    switch (status) {
+        case 400: return AVERROR_HTTP_BAD_REQUEST;
+        case 401: return AVERROR_HTTP_UNAUTHORIZED;
+        case 403: return AVERROR_HTTP_FORBIDDEN;
+        case 404: return AVERROR_HTTP_NOT_FOUND;
+        // 请求的范围超出资源，资源已变小
+        case 416: return AVERROR_INVALIDDATA;
+        default: return status >= 500 ? AVERROR_HTTP_SERVER_ERROR : AVERROR_HTTP_OTHER_4XX;
+    }
+}
+
+}
+
+RangeFetcher::RangeFetcher(const std::string& url, int64_t size, int blockSize, int connections, Deliver deliver)
+        : url(url), location(url), size(size), block_size(blockSize), deliver(std::move(deliver)) {
+    interrupt.callback = interruptCallback;
+    interrupt.opaque = this;
+    for (int i = 0; i < std::max(connections, 1); i++) {
+        workers.push_back(new Worker());
+    }
+    for (Worker* worker : workers) {
+        worker->thread = std::thread(&RangeFetcher::workerLoop, this, worker);
+    }
+}
+
+RangeFetcher::~RangeFetcher() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    cond.notify_all();
+    for (Worker* worker : workers) {
+        worker->thread.join();
+        closeConnection(worker);
+        delete worker;
+    }
+}
+
+// 关闭时打断进行中的请求
+int RangeFetcher::interruptCallback(void* opaque) {
+    RangeFetcher* fetcher = static_cast<RangeFetcher*>(opaque);
+    std::lock_guard<std::mutex> lock(fetcher->mtx);
+    return fetcher->stopping ? 1 : 0;
+}
+
+bool RangeFetcher::queuedLocked(int64_t index) const {
+    return inflight.count(index)
+           || std::find(urgent.begin(), urgent.end(), index) != urgent.end()
+           || std::find(pinned.begin(), pinned.end(), index) != pinned.end();
+}
+
+void RangeFetcher::fetchNow(int64_t index) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (inflight.count(index)) {
+            return;
+        }
+        // 已在其他队列中的提到最前
+        urgent.erase(std::remove(urgent.begin(), urgent.end(), index), urgent.end());
+        pinned.erase(std::remove(pinned.begin(), pinned.end(), index), pinned.end());
+        ahead.erase(std::remove(ahead.begin(), ahead.end(), index), ahead.end());
+        urgent.push_front(index);
+    }
+    cond.notify_one();
+}
+
+void RangeFetcher::fetchPinned(const std::vector<int64_t>& indices) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (int64_t index : indices) {
+            if (!queuedLocked(index)) {
+                pinned.push_back(index);
+            }
+        }
+    }
+    cond.notify_all();
+}
+
+void RangeFetcher::prefetch(const std::vector<int64_t>& indices) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        ahead.clear();
+        for (int64_t index : indices) {
+            if (!queuedLocked(index)) {
+                ahead.push_back(index);
+            }
+        }
+    }
+    cond.notify_all();
+}
+
+// 按优先级取下一块，同一队列（或预读窗口）中紧随其后的块一起取走，合成一次请求。
+// 一次取的块数按排队总数在连接间平分，不超过 MAX_RUN_BLOCKS，其余连接仍有块可下
+bool RangeFetcher::takeLocked(int64_t* first, int* count) {
+    std::deque<int64_t>* queue = !urgent.empty() ? &urgent : !pinned.empty() ? &pinned : &ahead;
+    if (queue->empty()) {
+        return false;
+    }
+    size_t waiting = urgent.size() + pinned.size() + ahead.size();
+    int limit = (int)std::max<size_t>(1, std::min<size_t>(MAX_RUN_BLOCKS, waiting / workers.size()));
+    *first = queue->front();
+    queue->pop_front();
+    inflight.insert(*first);
+    *count = 1;
+    while (*count < limit) {
+        int64_t next = *first + *count;
+        std::deque<int64_t>* from = queue;
+        auto it = std::find(from->begin(), from->end(), next);
+        if (it == from->end()) {
+            from = &ahead;
+            it = std::find(from->begin(), from->end(), next);
+            if (it == from->end()) {
+                break;
+            }
+        }
+        from->erase(it);
+        inflight.insert(next);
+        (*count)++;
+    }
+    return true;
+}
+
+void RangeFetcher::closeConnection(Worker* worker) {
+    avio_closep(&worker->io);
+    worker->origin.clear();
+    worker->received.clear();
+}
+
+// 在 worker 的连接上发出请求并读取响应头。空闲的 keep-alive 连接可能已被源站关闭，
+// 沿用的连接上失败时换新连接重试一次
+int RangeFetcher::roundTrip(Worker* worker, const std::string& origin, const std::string& message,
+                           std::string* header) {
+    if (worker->io && worker->origin != origin) {
+        closeConnection(worker);
+    }
+    for (;;) {
+        bool reused = worker->io != nullptr;
+        if (!worker->io) {
+            int ret = avio_open2(&worker->io, origin.c_str(), AVIO_FLAG_READ_WRITE, &interrupt, nullptr);
+            if (ret < 0) {
+                return ret;
+            }
+            worker->origin = origin;
+        }
+        avio_write(worker->io, (const unsigned char*)message.data(), (int)message.size());
+        avio_flush(worker->io);
+        int ret = worker->io->error;
+        size_t end = std::string::npos;
+        while (ret >= 0 && (end = worker->received.find("\r\n\r\n")) == std::string::npos) {
+            if (worker->received.size() > MAX_HEADER_BYTES) {
+                ret = AVERROR_INVALIDDATA;
+                break;
+            }
+            unsigned char buf[4096];
+            int n = avio_read_partial(worker->io, buf, sizeof(buf));
+            if (n <= 0) {
+                ret = n < 0 ? n : AVERROR_EOF;
+                break;
+            }
+            worker->received.append((const char*)buf, n);
+        }
+        if (ret >= 0) {
+            *header = worker->received.substr(0, end + 2);
+            worker->received.erase(0, end + 4);
+            return 0;
+        }
+        closeConnection(worker);
+        if (!reused || ret == AVERROR_EXIT) {
+            return ret;
+        }
+    }
+}
+
+// 请求 [offset, end)。返回 0 时响应体紧随其后，*keepAlive 表示读完后连接能否继续使用；
+// 返回 USE_FFMPEG_HTTP 时改用 FFmpeg 的 http 协议
+int RangeFetcher::request(Worker* worker, int64_t offset, int64_t end, bool* keepAlive) {
+    std::string target;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        target = location;
+    }
+    for (int redirects = 0;; redirects++) {
+        Endpoint endpoint;
+        if (!parseEndpoint(target, &endpoint)) {
+            return USE_FFMPEG_HTTP;
+        }
+        char range[64];
+        snprintf(range, sizeof(range), "bytes=%lld-%lld", (long long)offset, (long long)end - 1);
+        std::string message = "GET " + endpoint.path + " HTTP/1.1\r\n"
+                              "Host: " + endpoint.host + "\r\n"
+                              "User-Agent: " LIBAVFORMAT_IDENT "\r\n"
+                              "Accept: */*\r\n"
+                              "Range: " + range + "\r\n"
+                              "Connection: keep-alive\r\n\r\n";
+        std::string header;
+        int ret = roundTrip(worker, endpoint.origin, message, &header);
+        if (ret < 0) {
+            return ret;
+        }
+        Response response;
+        if (!parseResponse(header, &response)) {
+            closeConnection(worker);
+            return AVERROR_INVALIDDATA;
+        }
+        if (response.status == 206 && !response.chunked) {
+            if (response.total > 0 && response.total != size) {
+                LOGW("源资源大小变化：%lld -> %lld", (long long)size, (long long)response.total);
+                closeConnection(worker);
+                return AVERROR_INVALIDDATA;
+            }
+            if (response.range_start != offset || response.content_length != end - offset) {
+                closeConnection(worker);
+                return AVERROR(EIO);
+            }
+            *keepAlive = response.keep_alive;
+            return 0;
+        }
+        // 其余响应不再读取响应体，连接直接关闭
+        closeConnection(worker);
+        if (response.status >= 300 && response.status < 400 && !response.location.empty()) {
+            if (redirects >= MAX_REDIRECTS) {
+                return AVERROR(ELOOP);
+            }
+            target = resolveLocation(target, response.location);
+            std::lock_guard<std::mutex> lock(mtx);
+            location = target;
+            continue;
+        }
+        // 分块编码或忽略 Range 返回整个资源的响应交给 FFmpeg http，它按 offset 读取
+        if (response.chunked || response.status == 200) {
+            return USE_FFMPEG_HTTP;
+        }
+        return httpError(response.status);
+    }
+}
+
+// 从连接读取 len 字节，先用掉读响应头时多读到的部分
+int RangeFetcher::receive(Worker* worker, uint8_t* buf, int len) {
+    int total = (int)std::min<size_t>(len, worker->received.size());
+    memcpy(buf, worker->received.data(), total);
+    worker->received.erase(0, total);
+    while (total < len) {
+        int n = avio_read_partial(worker->io, buf + total, len - total);
+        if (n <= 0) {
+            return n < 0 ? n : AVERROR_EOF;
+        }
+        total += n;
+    }
+    return total;
+}
+
+// FFmpeg 的 http 协议用 offset/end_offset 请求同样的范围，每次新建连接
+int RangeFetcher::openHttp(AVIOContext** http, int64_t offset, int64_t end) {
+    std::string target;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        target = location;
+    }
+    AVDictionary* options = nullptr;
+    av_dict_set_int(&options, "offset", offset, 0);
+    av_dict_set_int(&options, "end_offset", end, 0);
+    int ret = avio_open2(http, target.c_str(), AVIO_FLAG_READ, &interrupt, &options);
+    av_dict_free(&options);
+    if (ret < 0) {
+        return ret;
+    }
+    int64_t reported = avio_size(*http);
+    if (reported > 0 && reported != size) {
+        LOGW("源资源大小变化：%lld -> %lld", (long long)size, (long long)reported);
+        avio_closep(http);
+        return AVERROR_INVALIDDATA;
+    }
+    return 0;
+}
+
+// 用一次请求下载 [first, first + count) 块，逐块交付。*done 为已交付的块数
+int RangeFetcher::fetchRun(Worker* worker, int64_t first, int count, uint8_t* buffer, int* done) {
+    int64_t offset = first * block_size;
+    int64_t end = std::min<int64_t>(size, (first + count) * block_size);
+    AVIOContext* http = nullptr;
+    bool keep_alive = false;
+    int ret = ffmpeg_http ? USE_FFMPEG_HTTP : request(worker, offset, end, &keep_alive);
+    if (ret == USE_FFMPEG_HTTP) {
+        if (!ffmpeg_http.exchange(true)) {
+            LOGI("改用 FFmpeg http 协议下载：%s", url.c_str());
+        }
+        ret = openHttp(&http, offset, end);
+    }
+    *done = 0;
+    while (ret >= 0 && *done < count) {
+        int64_t index = first + *done;
+        int len = (int)std::min<int64_t>(block_size, size - index * block_size);
+        int n = http ? avio_read(http, buffer, len) : receive(worker, buffer, len);
+        if (n != len) {
+            ret = n < 0 ? n : AVERROR(EIO);
+            break;
+        }
+        deliver(index, buffer, len);
+        (*done)++;
+        std::lock_guard<std::mutex> lock(mtx);
+        inflight.erase(index);
+    }
+    avio_closep(&http);
+    // 响应体没读完或源站要求关闭时连接不能再用
+    if (ret < 0 || !keep_alive) {
+        closeConnection(worker);
+    }
+    return ret < 0 ? ret : 0;
+}
+
+void RangeFetcher::workerLoop(Worker* worker) {
+    uint8_t* buffer = static_cast<uint8_t*>(av_malloc(block_size));
+    std::unique_lock<std::mutex> lock(mtx);
+    while (!stopping) {
+        int64_t first;
+        int count;
+        if (!buffer || !takeLocked(&first, &count)) {
+            cond.wait(lock);
+            continue;
+        }
+        lock.unlock();
+        int done = 0;
+        int ret = fetchRun(worker, first, count, buffer, &done);
+        if (ret < 0 && ret != AVERROR_EXIT) {
+            deliver(first + done, buffer, ret);
+        }
+        lock.lock();
+        for (int64_t index = first + done; index < first + count; index++) {
+            inflight.erase(index);
+        }
+        // 出错块之后还没下载的块放回预读队列前面
+        if (ret < 0 && !stopping) {
+            for (int64_t index = first + count - 1; index > first + done; index--) {
+                if (!queuedLocked(index) && std::find(ahead.begin(), ahead.end(), index) == ahead.end()) {
+                    ahead.push_front(index);
+                }
+            }
+            cond.notify_all();
+        }
+    }
+    av_free(buffer);
+}
@@ -0,0 +1,347 @@
+#include "ReverseDecoder.h"
+#include <algorithm>
+#include <climits>
+#include "FileIO.h"
+#include "Log.h"
+#include "PlayerStats.h"
+#include "StreamInfoCache.h"
+#include "TrackSelector.h"
+extern "C" {
+#include <libavutil/imgutils.h>
+}
+
+#define LOG_TAG "ReverseDecoder"
+
+namespace {
+
+// 查找关键帧：落在目标之后（没有索引的格式或已到开头）时每次再往前退一秒，最多试这么多次
+const int SEEK_ATTEMPTS = 3;
+const int64_t SEEK_RETRY_STEP_US = 1000000;
+
+}
+
+ReverseDecoder::ReverseDecoder(FramePool* pool, const AVPixelFormat* sinkFormats)
+        : frame_pool(pool), sink_formats(sinkFormats), budget(DEFAULT_MEMORY_BUDGET) {}
+
+ReverseDecoder::~ReverseDecoder() {
+    stop();
+}
+
+void ReverseDecoder::setMemoryBudget(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mtx);
+    budget = bytes;
+}
+
+int ReverseDecoder::interruptCallback(void* opaque) {
+    return static_cast<ReverseDecoder*>(opaque)->running ? 0 : 1;
+}
+
+int ReverseDecoder::start(const std::string& mediaUrl, int streamIndex, double position, int width, int height) {
+    stop();
+    url = mediaUrl;
+    stream_index = streamIndex;
+    out_width = width;
+    out_height = height;
+    running = true;
+    // 第一个通道在调用线程上打开，取得时间基与帧率后再启动通道线程，其余通道在各自的线程上打开
+    int ret = openLane(&lanes[0]);
+    if (ret < 0) {
+        LOGE("倒放解码通道打开失败：%d", ret);
+        running = false;
+        closeLane(&lanes[0]);
+        return ret;
+    }
+    AVStream* st = lanes[0].fmt_ctx->streams[stream_index];
+    time_base = st->time_base;
+    AVRational rate = av_guess_frame_rate(lanes[0].fmt_ctx, st, nullptr);
+    if (rate.num <= 0 || rate.den <= 0) {
+        rate = {25, 1};
+    }
+    frame_duration = std::max<int64_t>(1, av_rescale_q(1, av_inv_q(rate), time_base));
+
+    // 每段的帧数上限：正在上屏的一段加上每个通道各一段，总大小不超过预算
+    ConvertPath path;
+    AVPixelFormat fmt = negotiatePixelFormat(lanes[0].codec_ctx->pix_fmt, sink_formats, &path);
+    int w = width > 0 ? width : lanes[0].codec_ctx->width;
+    int h = height > 0 ? height : lanes[0].codec_ctx->height;
+    int frame_bytes = av_image_get_buffer_size(fmt != AV_PIX_FMT_NONE ? fmt : AV_PIX_FMT_RGBA, w, h, 1);
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        size_t frames = budget / ((LANES + 1) * (size_t)std::max(frame_bytes, 1));
+        chunk_frames = (int)std::max(frames, (size_t)MIN_CHUNK_FRAMES);
+        plans.clear();
+        next_claim = 0;
+        present_seq = -1;
+        end_seq = INT_MAX;
+        int64_t hi = av_rescale_q((int64_t)(position * AV_TIME_BASE), AV_TIME_BASE_Q, time_base);
+        plans[0] = {hi, AV_NOPTS_VALUE};
+    }
+    lanes[0].thread = std::thread(&ReverseDecoder::laneLoop, this, &lanes[0], false);
+    for (int i = 1; i < LANES; i++) {
+        lanes[i].thread = std::thread(&ReverseDecoder::laneLoop, this, &lanes[i], true);
+    }
+    LOGI("倒放：从 %.3f 秒开始，输出 %dx%d，每段最多 %d 帧", position, w, h, chunk_frames);
+    return 0;
+}
+
+AVFrame* ReverseDecoder::nextFrame() {
+    std::unique_lock<std::mutex> lock(mtx);
+    while (presenting.empty()) {
+        // 当前段放完，换上下一段；交出这一段后通道可以开始解码更早的段
+        int next = present_seq + 1;
+        cond.wait(lock, [&] { return !running || ready.count(next) || next >= end_seq; });
+        auto it = ready.find(next);
+        if (it == ready.end()) {
+            return nullptr;
+        }
+        presenting = std::move(it->second);
+        ready.erase(it);
+        present_seq = next;
+        cond.notify_all();
+    }
+    AVFrame* frame = presenting.back();
+    presenting.pop_back();
+    return frame;
+}
+
+void ReverseDecoder::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        running = false;
+        cond.notify_all();
+    }
+    for (Lane& lane : lanes) {
+        if (lane.thread.joinable()) {
+            lane.thread.join();
+        }
+        closeLane(&lane);
+    }
+    releaseFrames();
+}
+
+void ReverseDecoder::releaseFrames() {
+    std::lock_guard<std::mutex> lock(mtx);
+    for (auto& entry : ready) {
+        for (AVFrame* frame : entry.second) {
+            av_frame_free(&frame);
+        }
+    }
+    ready.clear();
+    for (AVFrame* frame : presenting) {
+        av_frame_free(&frame);
+    }
+    presenting.clear();
+    plans.clear();
+}
+
+int ReverseDecoder::openLane(Lane* lane) {
+    lane->fmt_ctx = avformat_alloc_context();
+    if (!lane->fmt_ctx) {
+        return AVERROR(ENOMEM);
+    }
+    lane->fmt_ctx->interrupt_callback.callback = interruptCallback;
+    lane->fmt_ctx->interrupt_callback.opaque = this;
+    int ret = FileIO::openInput(&lane->fmt_ctx, url.c_str(), nullptr);
+    if (ret < 0) {
+        return ret;
+    }
+    double last_position;
+    if (!StreamInfoCache::load(url.c_str(), lane->fmt_ctx, &last_position)
+        && (ret = avformat_find_stream_info(lane->fmt_ctx, nullptr)) < 0) {
+        return ret;
+    }
+    if (stream_index < 0 || stream_index >= (int)lane->fmt_ctx->nb_streams
+        || lane->fmt_ctx->streams[stream_index]->codecpar->codec_type != AVMEDIA_TYPE_VIDEO) {
+        return AVERROR_STREAM_NOT_FOUND;
+    }
+    // 只读取这一路视频
+    TrackSelector::applyDiscard(lane->fmt_ctx, stream_index, -1);
+
+    AVCodecParameters* par = lane->fmt_ctx->streams[stream_index]->codecpar;
+    AVCodec* codec = avcodec_find_decoder(par->codec_id);
+    if (!codec) {
+        return AVERROR_DECODER_NOT_FOUND;
+    }
+    lane->codec_ctx = avcodec_alloc_context3(codec);
+    lane->pkt = av_packet_alloc();
+    lane->frame = av_frame_alloc();
+    if (!lane->codec_ctx || !lane->pkt || !lane->frame) {
+        return AVERROR(ENOMEM);
+    }
+    if ((ret = avcodec_parameters_to_context(lane->codec_ctx, par)) < 0) {
+        return ret;
+    }
+    frame_pool->attach(lane->codec_ctx);
+    if ((ret = avcodec_open2(lane->codec_ctx, codec, nullptr)) < 0) {
+        return ret;
+    }
+    lane->converter.setFramePool(frame_pool);
+    lane->converter.setOutputSize(out_width, out_height);
+    return lane->converter.init(lane->codec_ctx->pix_fmt, par->width, par->height, sink_formats, "reverse");
+}
+
+void ReverseDecoder::closeLane(Lane* lane) {
+    lane->converter.release();
+    av_packet_free(&lane->pkt);
+    av_frame_free(&lane->frame);
+    avcodec_free_context(&lane->codec_ctx);
+    FileIO::closeInput(&lane->fmt_ctx);
+}
+
+void ReverseDecoder::laneLoop(Lane* lane, bool open) {
+    if (open) {
+        int ret = openLane(lane);
+        if (ret < 0) {
+            // 其余通道照常认领各段，只是没有并行预取
+            LOGW("倒放预取通道打开失败：%d", ret);
+            return;
+        }
+    }
+    while (true) {
+        int seq;
+        Plan plan;
+        {
+            // 认领下一段：分界已公布，且不超过正在上屏的段之后 LANES 段，缓存的段数因此有上限
+            std::unique_lock<std::mutex> lock(mtx);
+            cond.wait(lock, [&] {
+                return !running || next_claim >= end_seq
+                       || (plans.count(next_claim) && next_claim <= present_seq + LANES);
+            });
+            if (!running || next_claim >= end_seq) {
+                return;
+            }
+            seq = next_claim++;
+            plan = plans[seq];
+            plans.erase(seq);
+        }
+        std::vector<AVFrame*> frames;
+        decodeChunk(lane, seq, plan, &frames);
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!running) {
+            for (AVFrame* frame : frames) {
+                av_frame_free(&frame);
+            }
+            return;
+        }
+        ready[seq] = std::move(frames);
+        cond.notify_all();
+    }
+}
+
+void ReverseDecoder::publish(int seq, const Plan* plan) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (plan) {
+        plans[seq] = *plan;
+    } else {
+        end_seq = std::min(end_seq, seq);
+    }
+    cond.notify_all();
+}
+
+// 回退到 target 之前的关键帧，返回其时间戳，读到的关键帧数据包留在 lane->pkt 中；失败返回 AV_NOPTS_VALUE
+int64_t ReverseDecoder::seekKeyframe(Lane* lane, int64_t target) {
+    if (av_seek_frame(lane->fmt_ctx, stream_index, target, AVSEEK_FLAG_BACKWARD) < 0) {
+        return AV_NOPTS_VALUE;
+    }
+    avcodec_flush_buffers(lane->codec_ctx);
+    // 按时间戳二分查找的格式（如 ts）不一定落在关键帧上，跳到下一个关键帧
+    while (running && av_read_frame(lane->fmt_ctx, lane->pkt) >= 0) {
+        if (lane->pkt->stream_index == stream_index && (lane->pkt->flags & AV_PKT_FLAG_KEY)) {
+            int64_t ts = lane->pkt->pts != AV_NOPTS_VALUE ? lane->pkt->pts : lane->pkt->dts;
+            if (ts != AV_NOPTS_VALUE) {
+                return ts;
+            }
+        }
+        av_packet_unref(lane->pkt);
+    }
+    return AV_NOPTS_VALUE;
+}
+
+void ReverseDecoder::decodeChunk(Lane* lane, int seq, const Plan& plan, std::vector<AVFrame*>* frames) {
+    int64_t target = plan.key != AV_NOPTS_VALUE ? plan.key : plan.hi - 1;
+    int64_t step = av_rescale_q(SEEK_RETRY_STEP_US, AV_TIME_BASE_Q, time_base);
+    int64_t key = AV_NOPTS_VALUE;
+    for (int attempt = 0; attempt < SEEK_ATTEMPTS && running; attempt++) {
+        int64_t found = seekKeyframe(lane, target - attempt * step);
+        if (found == AV_NOPTS_VALUE) {
+            break;
+        }
+        if (found < plan.hi) {
+            key = found;
+            break;
+        }
+        av_packet_unref(lane->pkt);
+    }
+    if (key == AV_NOPTS_VALUE) {
+        // 前面没有关键帧了，倒放到此结束
+        publish(seq + 1, nullptr);
+        return;
+    }
+
+    // 关键帧确定后立即公布更早的一段，另一个通道不必等本段解码完。
+    // GOP 超过单段上限时本段只保留末尾 chunk_frames 帧，更早的部分仍从这个关键帧解码
+    int64_t span = (int64_t)chunk_frames * frame_duration;
+    int64_t lo = key;
+    Plan earlier = {key, AV_NOPTS_VALUE};
+    if (plan.hi - key > span) {
+        lo = plan.hi - span;
+        earlier = {lo, key};
+    }
+    publish(seq + 1, &earlier);
+
+    bool done = false;
+    auto receive = [&]() {
+        while (!done && avcodec_receive_frame(lane->codec_ctx, lane->frame) >= 0) {
+            int64_t pts = lane->frame->best_effort_timestamp;
+            if (pts != AV_NOPTS_VALUE && pts >= plan.hi) {
+                // 帧按显示顺序输出，之后的都属于更晚的段
+                done = true;
+            } else if (pts != AV_NOPTS_VALUE && pts >= lo) {
+                const AVFrame* out = lane->converter.convert(lane->frame);
+                AVFrame* kept = out ? av_frame_clone(out) : nullptr;
+                if (kept) {
+                    kept->best_effort_timestamp = pts;
+                    frames->push_back(kept);
+                }
+                // 帧率估计偏低（可变帧率）时超出上限，丢弃最早的帧保持内存有界
+                if ((int)frames->size() > chunk_frames * 2) {
+                    av_frame_free(&frames->front());
+                    frames->erase(frames->begin());
+                    PlayerStats::increment(Counter::FramesDropped);
+                }
+            }
+            av_frame_unref(lane->frame);
+        }
+    };
+    // 第一个数据包是 seekKeyframe 读到的关键帧
+    bool have_packet = true;
+    while (!done && running) {
+        if (!have_packet) {
+            if (av_read_frame(lane->fmt_ctx, lane->pkt) < 0) {
+                // 读到结尾：冲出解码器中剩余的帧
+                avcodec_send_packet(lane->codec_ctx, nullptr);
+                receive();
+                break;
+            }
+            if (lane->pkt->stream_index != stream_index) {
+                av_packet_unref(lane->pkt);
+                continue;
+            }
+        }
+        have_packet = false;
+        int ret = avcodec_send_packet(lane->codec_ctx, lane->pkt);
+        if (ret == AVERROR(EAGAIN)) {
+            receive();
+            ret = avcodec_send_packet(lane->codec_ctx, lane->pkt);
+        }
+        av_packet_unref(lane->pkt);
+        if (ret < 0) {
+            LOGV("倒放发送数据包失败：%d", ret);
+        }
+        receive();
+    }
+    av_packet_unref(lane->pkt);
+    std::sort(frames->begin(), frames->end(), [](const AVFrame* a, const AVFrame* b) {
+        return a->best_effort_timestamp < b->best_effort_timestamp;
+    });
+}
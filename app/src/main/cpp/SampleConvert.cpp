@@ -0,0 +1,298 @@
+#include "SampleConvert.h"
+#include "Log.h"
+#include <math.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+extern "C" {
+#include <libavutil/channel_layout.h>
+#include <libavutil/common.h>
+#include <libavutil/samplefmt.h>
+#include <libswresample/swresample.h>
+}
+
+#define LOG_TAG "SampleConvert"
+
+namespace SampleConvert {
+
+namespace {
+
+// 与 swr 的 FLT -> S16 转换相同
+inline int16_t floatToS16(float v) {
+    return av_clip_int16(lrintf(v * (1 << 15)));
+}
+
+#if defined(__SSE2__)
+// 8 个浮点转为饱和的 int16。先钳位再转换：超出 int32 范围时 cvtps 返回 0x80000000，正数会变成负满幅
+inline __m128i floatToS16x8(__m128 a, __m128 b) {
+    const __m128 scale = _mm_set1_ps(32768.0f);
+    const __m128 lo = _mm_set1_ps(-32768.0f);
+    const __m128 hi = _mm_set1_ps(32767.0f);
+    a = _mm_min_ps(_mm_max_ps(_mm_mul_ps(a, scale), lo), hi);
+    b = _mm_min_ps(_mm_max_ps(_mm_mul_ps(b, scale), lo), hi);
+    // cvtps 按 MXCSR 的默认模式就近取偶舍入，与 lrintf 一致
+    return _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b));
+}
+#elif defined(__aarch64__)
+// vcvtnq 就近取偶舍入并饱和到 int32，vqmovn 再饱和到 int16
+inline int16x4_t floatToS16x4(float32x4_t v) {
+    return vqmovn_s32(vcvtnq_s32_f32(vmulq_n_f32(v, 32768.0f)));
+}
+#endif
+
+void fltpStereo(const float* l, const float* r, int16_t* out, int frames) {
+    int i = 0;
+#if defined(__SSE2__)
+    for (; i + 8 <= frames; i += 8) {
+        __m128i left = floatToS16x8(_mm_loadu_ps(l + i), _mm_loadu_ps(l + i + 4));
+        __m128i right = floatToS16x8(_mm_loadu_ps(r + i), _mm_loadu_ps(r + i + 4));
+        _mm_storeu_si128((__m128i*)(out + i * 2), _mm_unpacklo_epi16(left, right));
+        _mm_storeu_si128((__m128i*)(out + i * 2 + 8), _mm_unpackhi_epi16(left, right));
+    }
+#elif defined(__aarch64__)
+    for (; i + 8 <= frames; i += 8) {
+        int16x8x2_t lr;
+        lr.val[0] = vcombine_s16(floatToS16x4(vld1q_f32(l + i)), floatToS16x4(vld1q_f32(l + i + 4)));
+        lr.val[1] = vcombine_s16(floatToS16x4(vld1q_f32(r + i)), floatToS16x4(vld1q_f32(r + i + 4)));
+        vst2q_s16(out + i * 2, lr);
+    }
+#endif
+    for (; i < frames; i++) {
+        out[i * 2] = floatToS16(l[i]);
+        out[i * 2 + 1] = floatToS16(r[i]);
+    }
+}
+
+void s16pStereo(const int16_t* l, const int16_t* r, int16_t* out, int frames) {
+    int i = 0;
+#if defined(__SSE2__)
+    for (; i + 8 <= frames; i += 8) {
+        __m128i left = _mm_loadu_si128((const __m128i*)(l + i));
+        __m128i right = _mm_loadu_si128((const __m128i*)(r + i));
+        _mm_storeu_si128((__m128i*)(out + i * 2), _mm_unpacklo_epi16(left, right));
+        _mm_storeu_si128((__m128i*)(out + i * 2 + 8), _mm_unpackhi_epi16(left, right));
+    }
+#elif defined(__ARM_NEON)
+    for (; i + 8 <= frames; i += 8) {
+        int16x8x2_t lr;
+        lr.val[0] = vld1q_s16(l + i);
+        lr.val[1] = vld1q_s16(r + i);
+        vst2q_s16(out + i * 2, lr);
+    }
+#endif
+    for (; i < frames; i++) {
+        out[i * 2] = l[i];
+        out[i * 2 + 1] = r[i];
+    }
+}
+
+void fltpDownmix(const Plan& plan, const float* const* in, int16_t* out, int frames) {
+    int i = 0;
+#if defined(__SSE2__)
+    for (; i + 4 <= frames; i += 4) {
+        __m128 left = _mm_setzero_ps();
+        __m128 right = _mm_setzero_ps();
+        for (int k = 0; k < plan.taps; k++) {
+            __m128 g = _mm_set1_ps(plan.gain[k]);
+            left = _mm_add_ps(left, _mm_mul_ps(_mm_loadu_ps(in[plan.left[k]] + i), g));
+            right = _mm_add_ps(right, _mm_mul_ps(_mm_loadu_ps(in[plan.right[k]] + i), g));
+        }
+        // 打包为 L0..L3 R0..R3 后交织
+        __m128i packed = floatToS16x8(left, right);
+        _mm_storeu_si128((__m128i*)(out + i * 2), _mm_unpacklo_epi16(packed, _mm_srli_si128(packed, 8)));
+    }
+#elif defined(__aarch64__)
+    for (; i + 4 <= frames; i += 4) {
+        float32x4_t left = vdupq_n_f32(0.0f);
+        float32x4_t right = vdupq_n_f32(0.0f);
+        for (int k = 0; k < plan.taps; k++) {
+            left = vaddq_f32(left, vmulq_n_f32(vld1q_f32(in[plan.left[k]] + i), plan.gain[k]));
+            right = vaddq_f32(right, vmulq_n_f32(vld1q_f32(in[plan.right[k]] + i), plan.gain[k]));
+        }
+        int16x4x2_t lr;
+        lr.val[0] = floatToS16x4(left);
+        lr.val[1] = floatToS16x4(right);
+        vst2_s16(out + i * 2, lr);
+    }
+#endif
+    for (; i < frames; i++) {
+        float left = 0.0f;
+        float right = 0.0f;
+        for (int k = 0; k < plan.taps; k++) {
+            left += in[plan.left[k]][i] * plan.gain[k];
+            right += in[plan.right[k]][i] * plan.gain[k];
+        }
+        out[i * 2] = floatToS16(left);
+        out[i * 2 + 1] = floatToS16(right);
+    }
+}
+
+// 下混的一对输入声道，布局中不存在时跳过
+void addTap(Plan* plan, uint64_t layout, uint64_t left, uint64_t right, float gain) {
+    if ((layout & left) && (layout & right)) {
+        plan->left[plan->taps] = av_get_channel_layout_channel_index(layout, left);
+        plan->right[plan->taps] = av_get_channel_layout_channel_index(layout, right);
+        plan->gain[plan->taps] = gain;
+        plan->taps++;
+    }
+}
+
+int64_t nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+}
+
+uint64_t layoutOf(uint64_t channelLayout, int channels) {
+    if (channelLayout && av_get_channel_layout_nb_channels(channelLayout) == channels) {
+        return channelLayout;
+    }
+    return (uint64_t)av_get_default_channel_layout(channels);
+}
+
+Plan choose(int format, uint64_t channelLayout, int channels, int sampleRate, int outSampleRate) {
+    Plan plan;
+    plan.format = format;
+    plan.channel_layout = channelLayout;
+    plan.channels = channels;
+    plan.sample_rate = sampleRate;
+    plan.out_sample_rate = outSampleRate;
+    if (sampleRate != outSampleRate) {
+        return plan;
+    }
+    uint64_t layout = layoutOf(channelLayout, channels);
+    if (layout == AV_CH_LAYOUT_STEREO && format == AV_SAMPLE_FMT_FLTP) {
+        plan.kernel = KERNEL_FLTP_STEREO;
+    } else if (layout == AV_CH_LAYOUT_STEREO && format == AV_SAMPLE_FMT_S16P) {
+        plan.kernel = KERNEL_S16P_STEREO;
+    } else if (format == AV_SAMPLE_FMT_FLTP && (layout == AV_CH_LAYOUT_5POINT1 || layout == AV_CH_LAYOUT_5POINT1_BACK
+                                                || layout == AV_CH_LAYOUT_7POINT1)) {
+        // swr 默认矩阵：前置 1，中置与环绕（侧、后）-3dB，LFE 不混入；输出为整数时按系数和归一化
+        addTap(&plan, layout, AV_CH_FRONT_LEFT, AV_CH_FRONT_RIGHT, 1.0f);
+        addTap(&plan, layout, AV_CH_FRONT_CENTER, AV_CH_FRONT_CENTER, (float)M_SQRT1_2);
+        addTap(&plan, layout, AV_CH_SIDE_LEFT, AV_CH_SIDE_RIGHT, (float)M_SQRT1_2);
+        addTap(&plan, layout, AV_CH_BACK_LEFT, AV_CH_BACK_RIGHT, (float)M_SQRT1_2);
+        float sum = 0.0f;
+        for (int k = 0; k < plan.taps; k++) {
+            sum += plan.gain[k];
+        }
+        for (int k = 0; k < plan.taps; k++) {
+            plan.gain[k] /= sum;
+        }
+        plan.kernel = KERNEL_FLTP_DOWNMIX;
+    }
+    return plan;
+}
+
+void run(const Plan& plan, const uint8_t* const* in, int offset, int16_t* out, int frames) {
+    switch (plan.kernel) {
+        case KERNEL_FLTP_STEREO:
+            fltpStereo((const float*)in[0] + offset, (const float*)in[1] + offset, out, frames);
+            break;
+        case KERNEL_S16P_STEREO:
+            s16pStereo((const int16_t*)in[0] + offset, (const int16_t*)in[1] + offset, out, frames);
+            break;
+        case KERNEL_FLTP_DOWNMIX: {
+            const float* planes[8];
+            for (int ch = 0; ch < plan.channels && ch < 8; ch++) {
+                planes[ch] = (const float*)in[ch] + offset;
+            }
+            fltpDownmix(plan, planes, out, frames);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+int benchmark(BenchmarkCase benchCase, int frames, BenchmarkResult* result) {
+    memset(result, 0, sizeof(*result));
+    int format = AV_SAMPLE_FMT_FLTP;
+    uint64_t layout = AV_CH_LAYOUT_STEREO;
+    switch (benchCase) {
+        case BENCH_FLTP_STEREO: break;
+        case BENCH_S16P_STEREO: format = AV_SAMPLE_FMT_S16P; break;
+        case BENCH_DOWNMIX_5_1: layout = AV_CH_LAYOUT_5POINT1; break;
+        case BENCH_DOWNMIX_7_1: layout = AV_CH_LAYOUT_7POINT1; break;
+        default: return AVERROR(EINVAL);
+    }
+    const int rate = 48000;
+    int channels = av_get_channel_layout_nb_channels(layout);
+    Plan plan = choose(format, layout, channels, rate, rate);
+    if (plan.kernel == KERNEL_NONE || frames <= 0) {
+        return AVERROR(EINVAL);
+    }
+
+    // 合成信号：各声道频率不同的正弦，每隔一段插入超出满幅的峰值以覆盖饱和
+    int bytes_per_sample = av_get_bytes_per_sample((AVSampleFormat)format);
+    std::vector<std::vector<uint8_t>> data(channels, std::vector<uint8_t>((size_t)frames * bytes_per_sample));
+    for (int ch = 0; ch < channels; ch++) {
+        for (int i = 0; i < frames; i++) {
+            double v = 0.9 * sin(2 * M_PI * 220.0 * (ch + 1) * i / rate);
+            if (i % 997 == 0) {
+                v = v < 0 ? -1.2 : 1.2;
+            }
+            if (format == AV_SAMPLE_FMT_FLTP) {
+                ((float*)data[ch].data())[i] = (float)v;
+            } else {
+                ((int16_t*)data[ch].data())[i] = av_clip_int16((int)lrint(v * 32767));
+            }
+        }
+    }
+    std::vector<const uint8_t*> planes(channels);
+    for (int ch = 0; ch < channels; ch++) {
+        planes[ch] = data[ch].data();
+    }
+
+    SwrContext* swr = swr_alloc_set_opts(nullptr, AV_CH_LAYOUT_STEREO, AV_SAMPLE_FMT_S16, rate,
+                                         layout, (AVSampleFormat)format, rate, 0, nullptr);
+    if (!swr || swr_init(swr) < 0) {
+        swr_free(&swr);
+        return AVERROR(EINVAL);
+    }
+    std::vector<int16_t> fast((size_t)frames * 2);
+    std::vector<int16_t> ref((size_t)frames * 2);
+    std::vector<const uint8_t*> in(channels);
+    const int chunk = 1024;   // 与解码帧的大小相近
+
+    int64_t fast_start = nowNs();
+    for (int offset = 0; offset < frames; offset += chunk) {
+        run(plan, planes.data(), offset, fast.data() + (size_t)offset * 2, std::min(chunk, frames - offset));
+    }
+    int64_t swr_start = nowNs();
+    int ret = 0;
+    for (int offset = 0; offset < frames && ret >= 0; offset += chunk) {
+        int n = std::min(chunk, frames - offset);
+        for (int ch = 0; ch < channels; ch++) {
+            in[ch] = planes[ch] + (size_t)offset * bytes_per_sample;
+        }
+        uint8_t* out = (uint8_t*)(ref.data() + (size_t)offset * 2);
+        ret = swr_convert(swr, &out, n, in.data(), n);
+    }
+    int64_t swr_end = nowNs();
+    swr_free(&swr);
+    if (ret < 0) {
+        return ret;
+    }
+
+    for (size_t i = 0; i < fast.size(); i++) {
+        result->maxDiff = std::max(result->maxDiff, std::abs(fast[i] - ref[i]));
+    }
+    result->fastNsPerFrame = (double)(swr_start - fast_start) / frames;
+    result->swrNsPerFrame = (double)(swr_end - swr_start) / frames;
+    LOGI("转换测试（%d）：%.2f ns/帧，swr %.2f ns/帧，最大误差 %d", benchCase,
+         result->fastNsPerFrame, result->swrNsPerFrame, result->maxDiff);
+    return 0;
+}
+
+}
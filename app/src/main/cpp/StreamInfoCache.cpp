@@ -0,0 +1,319 @@
+#include "StreamInfoCache.h"
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Log.h"
+
+#define LOG_TAG "StreamInfoCache"
+
+namespace {
+
+const uint32_t CACHE_MAGIC = 0x31434953;   // "SIC1"
+const uint32_t CACHE_VERSION = 1;
+const uint32_t MAX_STREAMS = 64;
+const int32_t MAX_EXTRADATA = 1 << 20;
+
+// 条目头，position 位于固定偏移，更新播放位置时原地改写
+struct EntryHeader {
+    uint32_t magic;
+    uint32_t version;
+    int64_t file_size;
+    int64_t mtime;
+    double position;
+    int64_t duration;
+    int64_t start_time;
+    int64_t bit_rate;
+    uint32_t nb_streams;
+    uint32_t reserved;
+};
+
+// 每个流的编码参数，后接 extradata_size 字节的 extradata
+struct StreamRecord {
+    int32_t codec_type;
+    int32_t codec_id;
+    uint32_t codec_tag;
+    int32_t format;
+    int64_t bit_rate;
+    int32_t profile;
+    int32_t level;
+    int32_t width;
+    int32_t height;
+    int32_t sar_num;
+    int32_t sar_den;
+    int32_t field_order;
+    int32_t color_range;
+    int32_t color_primaries;
+    int32_t color_trc;
+    int32_t color_space;
+    int32_t video_delay;
+    uint64_t channel_layout;
+    int32_t channels;
+    int32_t sample_rate;
+    int32_t frame_size;
+    int32_t initial_padding;
+    int32_t avg_frame_rate_num;
+    int32_t avg_frame_rate_den;
+    int32_t r_frame_rate_num;
+    int32_t r_frame_rate_den;
+    int64_t duration;
+    int64_t start_time;
+    int32_t extradata_size;
+    int32_t reserved;
+};
+
+std::mutex cache_mutex;
+std::string cache_dir;
+
+uint64_t fnv1a(const std::string& s) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : s) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// 取文件大小与修改时间；远程地址无法 stat，大小取 AVIO 报告的资源大小，修改时间为 0
+void identity(const char* url, AVFormatContext* fmt_ctx, int64_t* size, int64_t* mtime) {
+    const char* path = url;
+    if (strncmp(path, "file:", 5) == 0) {
+        path += 5;
+    }
+    struct stat st;
+    if (!strstr(path, "://") && stat(path, &st) == 0) {
+        *size = st.st_size;
+        *mtime = st.st_mtime;
+        return;
+    }
+    *size = (fmt_ctx && fmt_ctx->pb) ? avio_size(fmt_ctx->pb) : -1;
+    *mtime = 0;
+}
+
+// 缓存文件路径，目录未设置时返回空串
+std::string entryPath(const char* url) {
+    if (cache_dir.empty()) {
+        return std::string();
+    }
+    char name[32];
+    snprintf(name, sizeof(name), "/%016llx.sic", (unsigned long long)fnv1a(url));
+    return cache_dir + name;
+}
+
+// 读取条目头并校验
+bool readHeader(FILE* file, EntryHeader* header) {
+    return fread(header, sizeof(*header), 1, file) == 1
+           && header->magic == CACHE_MAGIC && header->version == CACHE_VERSION
+           && header->nb_streams <= MAX_STREAMS;
+}
+
+void fillRecord(const AVStream* st, StreamRecord* r) {
+    const AVCodecParameters* par = st->codecpar;
+    memset(r, 0, sizeof(*r));
+    r->codec_type = par->codec_type;
+    r->codec_id = par->codec_id;
+    r->codec_tag = par->codec_tag;
+    r->format = par->format;
+    r->bit_rate = par->bit_rate;
+    r->profile = par->profile;
+    r->level = par->level;
+    r->width = par->width;
+    r->height = par->height;
+    r->sar_num = par->sample_aspect_ratio.num;
+    r->sar_den = par->sample_aspect_ratio.den;
+    r->field_order = par->field_order;
+    r->color_range = par->color_range;
+    r->color_primaries = par->color_primaries;
+    r->color_trc = par->color_trc;
+    r->color_space = par->color_space;
+    r->video_delay = par->video_delay;
+    r->channel_layout = par->channel_layout;
+    r->channels = par->channels;
+    r->sample_rate = par->sample_rate;
+    r->frame_size = par->frame_size;
+    r->initial_padding = par->initial_padding;
+    r->avg_frame_rate_num = st->avg_frame_rate.num;
+    r->avg_frame_rate_den = st->avg_frame_rate.den;
+    r->r_frame_rate_num = st->r_frame_rate.num;
+    r->r_frame_rate_den = st->r_frame_rate.den;
+    r->duration = st->duration;
+    r->start_time = st->start_time;
+    r->extradata_size = par->extradata ? par->extradata_size : 0;
+}
+
+// 用缓存补齐流参数：demuxer 已经从头部读到的值保持不变，只填充缺失的部分
+int applyRecord(AVStream* st, const StreamRecord& r, const std::vector<uint8_t>& extradata) {
+    AVCodecParameters* par = st->codecpar;
+    if (par->format < 0) par->format = r.format;
+    if (!par->bit_rate) par->bit_rate = r.bit_rate;
+    if (par->profile == FF_PROFILE_UNKNOWN) par->profile = r.profile;
+    if (par->level == FF_LEVEL_UNKNOWN) par->level = r.level;
+    if (!par->width || !par->height) {
+        par->width = r.width;
+        par->height = r.height;
+    }
+    if (!par->sample_aspect_ratio.num) par->sample_aspect_ratio = av_make_q(r.sar_num, r.sar_den);
+    if (par->field_order == AV_FIELD_UNKNOWN) par->field_order = (AVFieldOrder)r.field_order;
+    if (par->color_range == AVCOL_RANGE_UNSPECIFIED) par->color_range = (AVColorRange)r.color_range;
+    if (par->color_primaries == AVCOL_PRI_UNSPECIFIED) par->color_primaries = (AVColorPrimaries)r.color_primaries;
+    if (par->color_trc == AVCOL_TRC_UNSPECIFIED) par->color_trc = (AVColorTransferCharacteristic)r.color_trc;
+    if (par->color_space == AVCOL_SPC_UNSPECIFIED) par->color_space = (AVColorSpace)r.color_space;
+    if (!par->video_delay) par->video_delay = r.video_delay;
+    if (!par->channels) par->channels = r.channels;
+    if (!par->channel_layout) par->channel_layout = r.channel_layout;
+    if (!par->sample_rate) par->sample_rate = r.sample_rate;
+    if (!par->frame_size) par->frame_size = r.frame_size;
+    if (!par->initial_padding) par->initial_padding = r.initial_padding;
+    if (!st->avg_frame_rate.num) st->avg_frame_rate = av_make_q(r.avg_frame_rate_num, r.avg_frame_rate_den);
+    if (!st->r_frame_rate.num) st->r_frame_rate = av_make_q(r.r_frame_rate_num, r.r_frame_rate_den);
+    if (st->duration == AV_NOPTS_VALUE) st->duration = r.duration;
+    if (st->start_time == AV_NOPTS_VALUE) st->start_time = r.start_time;
+    if (!par->extradata && !extradata.empty()) {
+        par->extradata = (uint8_t*)av_mallocz(extradata.size() + AV_INPUT_BUFFER_PADDING_SIZE);
+        if (!par->extradata) {
+            return AVERROR(ENOMEM);
+        }
+        memcpy(par->extradata, extradata.data(), extradata.size());
+        par->extradata_size = (int)extradata.size();
+    }
+    return 0;
+}
+
+} // namespace
+
+
+void StreamInfoCache::setDirectory(const char* dir) {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    cache_dir = dir ? dir : "";
+    if (!cache_dir.empty()) {
+        mkdir(cache_dir.c_str(), 0700);
+    }
+}
+
+bool StreamInfoCache::load(const char* url, AVFormatContext* fmt_ctx, double* lastPosition) {
+    *lastPosition = 0;
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    std::string path = entryPath(url);
+    if (path.empty()) {
+        return false;
+    }
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    int64_t size, mtime;
+    identity(url, fmt_ctx, &size, &mtime);
+    EntryHeader header;
+    if (!readHeader(file, &header) || header.file_size != size || header.mtime != mtime
+        || header.nb_streams != fmt_ctx->nb_streams) {
+        LOGD("缓存失效：%s", url);
+        fclose(file);
+        return false;
+    }
+
+    // 先完整读出并与 demuxer 的流比对，全部一致后再写入 fmt_ctx
+    std::vector<StreamRecord> records(header.nb_streams);
+    std::vector<std::vector<uint8_t>> extradata(header.nb_streams);
+    bool valid = true;
+    for (uint32_t i = 0; i < header.nb_streams && valid; i++) {
+        StreamRecord& r = records[i];
+        const AVCodecParameters* par = fmt_ctx->streams[i]->codecpar;
+        valid = fread(&r, sizeof(r), 1, file) == 1
+                && r.codec_type == par->codec_type && r.codec_id == par->codec_id
+                && r.extradata_size >= 0 && r.extradata_size <= MAX_EXTRADATA;
+        if (valid && r.extradata_size > 0) {
+            extradata[i].resize(r.extradata_size);
+            valid = fread(extradata[i].data(), r.extradata_size, 1, file) == 1;
+        }
+    }
+    fclose(file);
+    if (!valid) {
+        LOGD("缓存与文件不一致：%s", url);
+        return false;
+    }
+    for (uint32_t i = 0; i < header.nb_streams; i++) {
+        if (applyRecord(fmt_ctx->streams[i], records[i], extradata[i]) < 0) {
+            return false;
+        }
+    }
+    if (fmt_ctx->duration == AV_NOPTS_VALUE) fmt_ctx->duration = header.duration;
+    if (fmt_ctx->start_time == AV_NOPTS_VALUE) fmt_ctx->start_time = header.start_time;
+    if (!fmt_ctx->bit_rate) fmt_ctx->bit_rate = header.bit_rate;
+    *lastPosition = header.position;
+    LOGI("命中流信息缓存：%s，上次位置 %.2f 秒", url, header.position);
+    return true;
+}
+
+void StreamInfoCache::save(const char* url, AVFormatContext* fmt_ctx) {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    std::string path = entryPath(url);
+    if (path.empty() || fmt_ctx->nb_streams > MAX_STREAMS) {
+        return;
+    }
+    EntryHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = CACHE_MAGIC;
+    header.version = CACHE_VERSION;
+    identity(url, fmt_ctx, &header.file_size, &header.mtime);
+    header.duration = fmt_ctx->duration;
+    header.start_time = fmt_ctx->start_time;
+    header.bit_rate = fmt_ctx->bit_rate;
+    header.nb_streams = fmt_ctx->nb_streams;
+
+    // 同一内容重新探测时沿用已记录的播放位置
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file) {
+        EntryHeader old;
+        if (readHeader(file, &old) && old.file_size == header.file_size && old.mtime == header.mtime) {
+            header.position = old.position;
+        }
+        fclose(file);
+    }
+
+    // 先写临时文件再 rename，读者不会看到写了一半的条目
+    std::string tmp_path = path + ".tmp";
+    file = fopen(tmp_path.c_str(), "wb");
+    if (!file) {
+        LOGW("无法写入缓存：%s", tmp_path.c_str());
+        return;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    for (unsigned int i = 0; i < fmt_ctx->nb_streams && ok; i++) {
+        StreamRecord r;
+        fillRecord(fmt_ctx->streams[i], &r);
+        if (r.extradata_size > MAX_EXTRADATA) {
+            r.extradata_size = 0;
+        }
+        ok = fwrite(&r, sizeof(r), 1, file) == 1;
+        if (ok && r.extradata_size > 0) {
+            ok = fwrite(fmt_ctx->streams[i]->codecpar->extradata, r.extradata_size, 1, file) == 1;
+        }
+    }
+    ok = fclose(file) == 0 && ok;
+    if (!ok || rename(tmp_path.c_str(), path.c_str()) != 0) {
+        LOGW("写入缓存失败：%s", path.c_str());
+        unlink(tmp_path.c_str());
+    }
+}
+
+void StreamInfoCache::savePosition(const char* url, double position) {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    std::string path = entryPath(url);
+    if (path.empty()) {
+        return;
+    }
+    FILE* file = fopen(path.c_str(), "r+b");
+    if (!file) {
+        return;
+    }
+    EntryHeader header;
+    if (readHeader(file, &header)) {
+        header.position = position;
+        fseek(file, 0, SEEK_SET);
+        fwrite(&header, sizeof(header), 1, file);
+    }
+    fclose(file);
+}
@@ -0,0 +1,196 @@
+#include "Trace.h"
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include "Log.h"
+
+#define LOG_TAG "Trace"
+
+std::atomic<bool> Trace::enabled(false);
+
+namespace {
+
+const uint32_t EVENTS_PER_THREAD = 8192;     // 必须是2的幂
+const int SPARE_BUFFERS = 8;
+
+struct TraceEvent {
+    int64_t ts_us;
+    int64_t id;
+    const char* name;
+    char phase;
+};
+
+// 每个线程独占一个环形缓冲区，只有所属线程写入，写满后覆盖最早的事件，保留最近的 EVENTS_PER_THREAD 个。
+// count 为累计写入数，dump 时其他线程按 count 读取已提交的事件
+struct ThreadBuffer {
+    std::atomic<int> tid;
+    std::atomic<uint32_t> generation;
+    std::atomic<uint32_t> count;
+    std::atomic<bool> alive;
+    TraceEvent events[EVENTS_PER_THREAD];
+};
+
+std::mutex registry_mutex;                 // 只在注册、start 和 dump 时使用
+std::vector<ThreadBuffer*> registry;
+// start 时预先分配并登记的缓冲区，线程第一次写事件时无锁取用。
+// 音频回调等实时线程的第一个事件因此不分配内存也不加锁
+std::atomic<ThreadBuffer*> spare_buffers[SPARE_BUFFERS];
+std::atomic<uint32_t> generation(1);
+int64_t start_time_us = 0;
+
+int64_t nowUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+// 线程退出时标记缓冲区，已记录的事件保留到下一次 start
+struct ThreadBufferHolder {
+    ThreadBuffer* buffer = nullptr;
+    ~ThreadBufferHolder() {
+        if (buffer) {
+            buffer->alive.store(false, std::memory_order_release);
+        }
+    }
+};
+
+thread_local ThreadBufferHolder tls_buffer;
+
+// 在 registry_mutex 内调用。新缓冲区的 generation 为0，写入第一个事件之前 dump 不会读取它
+ThreadBuffer* allocateBuffer() {
+    ThreadBuffer* buffer = new ThreadBuffer();
+    buffer->tid.store(0, std::memory_order_relaxed);
+    buffer->generation.store(0, std::memory_order_relaxed);
+    buffer->count.store(0, std::memory_order_relaxed);
+    buffer->alive.store(true, std::memory_order_relaxed);
+    registry.push_back(buffer);
+    return buffer;
+}
+
+ThreadBuffer* claimSpareBuffer() {
+    for (int i = 0; i < SPARE_BUFFERS; i++) {
+        ThreadBuffer* buffer = spare_buffers[i].exchange(nullptr, std::memory_order_acq_rel);
+        if (buffer) {
+            return buffer;
+        }
+    }
+    return nullptr;
+}
+
+ThreadBuffer* currentBuffer() {
+    ThreadBuffer* buffer = tls_buffer.buffer;
+    if (!buffer) {
+        buffer = claimSpareBuffer();
+        if (!buffer) {
+            // 预分配的用完时才在本线程分配
+            std::lock_guard<std::mutex> lock(registry_mutex);
+            buffer = allocateBuffer();
+        }
+        buffer->tid.store((int)syscall(SYS_gettid), std::memory_order_relaxed);
+        tls_buffer.buffer = buffer;
+    }
+    // start 之后第一次写入时由所属线程自己清空，避免与写入竞争
+    uint32_t current = generation.load(std::memory_order_acquire);
+    if (buffer->generation.load(std::memory_order_relaxed) != current) {
+        buffer->count.store(0, std::memory_order_relaxed);
+        buffer->generation.store(current, std::memory_order_release);
+    }
+    return buffer;
+}
+
+} // namespace
+
+
+void Trace::start() {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    // 已退出线程的缓冲区不会再被写入，随旧事件一起释放
+    for (auto it = registry.begin(); it != registry.end();) {
+        if (!(*it)->alive.load(std::memory_order_acquire)) {
+            delete *it;
+            it = registry.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (int i = 0; i < SPARE_BUFFERS; i++) {
+        if (!spare_buffers[i].load(std::memory_order_acquire)) {
+            spare_buffers[i].store(allocateBuffer(), std::memory_order_release);
+        }
+    }
+    start_time_us = nowUs();
+    generation.fetch_add(1, std::memory_order_acq_rel);
+    enabled.store(true, std::memory_order_release);
+    LOGI("开始记录 trace");
+}
+
+void Trace::stop() {
+    enabled.store(false, std::memory_order_release);
+    LOGI("停止记录 trace");
+}
+
+void Trace::event(Phase phase, const char* name, int64_t id) {
+    ThreadBuffer* buffer = currentBuffer();
+    uint32_t index = buffer->count.load(std::memory_order_relaxed);
+    TraceEvent& e = buffer->events[index & (EVENTS_PER_THREAD - 1)];
+    e.ts_us = nowUs();
+    e.id = id;
+    e.name = name;
+    e.phase = phase;
+    buffer->count.store(index + 1, std::memory_order_release);
+}
+
+int Trace::dump(const char* path) {
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        LOGE("无法创建 trace 文件：%s", path);
+        return -1;
+    }
+    int pid = getpid();
+    uint32_t current = generation.load(std::memory_order_acquire);
+    size_t total = 0;
+    bool first = true;
+    fputs("{\"traceEvents\":[\n", file);
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    for (ThreadBuffer* buffer : registry) {
+        if (buffer->generation.load(std::memory_order_acquire) != current) {
+            continue; // 本次记录期间没有写过事件
+        }
+        // 先拷出环中的事件，拷贝期间所属线程可能继续写入、覆盖最早的几个，拷完后按新的 count 丢掉这些
+        uint32_t count = buffer->count.load(std::memory_order_acquire);
+        uint32_t begin = count > EVENTS_PER_THREAD ? count - EVENTS_PER_THREAD : 0;
+        std::vector<TraceEvent> events;
+        events.reserve(count - begin);
+        for (uint32_t i = begin; i < count; i++) {
+            events.push_back(buffer->events[i & (EVENTS_PER_THREAD - 1)]);
+        }
+        uint32_t written = buffer->count.load(std::memory_order_acquire);
+        uint32_t valid = written >= EVENTS_PER_THREAD ? written - EVENTS_PER_THREAD + 1 : 0;
+        size_t skip = valid > begin ? std::min<size_t>(valid - begin, events.size()) : 0;
+        int tid = buffer->tid.load(std::memory_order_relaxed);
+        for (size_t i = skip; i < events.size(); i++) {
+            const TraceEvent& e = events[i];
+            fprintf(file, "%s{\"name\":\"%s\",\"cat\":\"pipeline\",\"ph\":\"%c\",\"ts\":%lld,\"pid\":%d,\"tid\":%d",
+                    first ? "" : ",\n", e.name, e.phase, (long long)(e.ts_us - start_time_us), pid, tid);
+            if (e.phase == AsyncBegin || e.phase == AsyncEnd) {
+                fprintf(file, ",\"id\":\"0x%llx\"", (unsigned long long)e.id);
+            } else if (e.phase == Instant) {
+                fputs(",\"s\":\"t\"", file);
+            }
+            fputc('}', file);
+            first = false;
+        }
+        total += events.size() - skip;
+        uint32_t overwritten = begin + (uint32_t)skip;
+        if (overwritten) {
+            LOGW("线程 %d 的 trace 缓冲区已写满，最早的 %u 个事件被覆盖", tid, overwritten);
+        }
+    }
+    fputs("\n],\"displayTimeUnit\":\"ms\"}\n", file);
+    fclose(file);
+    LOGI("trace 已写入 %s，共 %zu 个事件", path, total);
+    return 0;
+}
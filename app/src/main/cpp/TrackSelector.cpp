@@ -0,0 +1,133 @@
+#include "TrackSelector.h"
+#include <strings.h>
+#include <mutex>
+#include "Log.h"
+
+#define LOG_TAG "TrackSelector"
+
+namespace TrackSelector {
+
+namespace {
+
+std::mutex preference_mutex;
+Preference preferences[AVMEDIA_TYPE_NB];
+
+// 封面图片在 mp3/m4a 等文件里以视频流出现，不作为视频轨
+bool isAttachedPicture(const AVStream* st) {
+    return (st->disposition & AV_DISPOSITION_ATTACHED_PIC) != 0;
+}
+
+const char* languageOf(const AVStream* st) {
+    AVDictionaryEntry* entry = av_dict_get(st->metadata, "language", nullptr, 0);
+    return entry ? entry->value : "";
+}
+
+// 偏好为空时视为匹配；偏好是两个字母的代码时按前缀匹配三个字母的代码
+bool languageMatches(const std::string& preferred, const char* language) {
+    if (preferred.empty()) {
+        return true;
+    }
+    return strncasecmp(preferred.c_str(), language, preferred.size()) == 0;
+}
+
+// 参与比较的各项按优先级从高到低排列，逐项比较
+struct Score {
+    int64_t keys[7];
+
+    bool operator>(const Score& other) const {
+        for (int i = 0; i < 7; i++) {
+            if (keys[i] != other.keys[i]) {
+                return keys[i] > other.keys[i];
+            }
+        }
+        return false;
+    }
+};
+
+Score scoreOf(const AVStream* st, const Preference& preference) {
+    const AVCodecParameters* par = st->codecpar;
+    const char* codec = avcodec_get_name(par->codec_id);
+    int64_t bitrate = par->bit_rate;
+    bool under_limit = preference.maxBitrate <= 0 || (bitrate > 0 && bitrate <= preference.maxBitrate);
+    int64_t size = par->codec_type == AVMEDIA_TYPE_VIDEO ? (int64_t)par->width * par->height : par->channels;
+    return {{
+        avcodec_find_decoder(par->codec_id) != nullptr,
+        languageMatches(preference.language, languageOf(st)),
+        preference.codec.empty() || strcasecmp(preference.codec.c_str(), codec) == 0,
+        under_limit,
+        (st->disposition & AV_DISPOSITION_DEFAULT) != 0,
+        // 码率上限内选码率最高的；超出上限的流里选码率最低的
+        under_limit ? bitrate : -bitrate,
+        size,
+    }};
+}
+
+}
+
+void setPreference(AVMediaType type, const Preference& preference) {
+    if (type < 0 || type >= AVMEDIA_TYPE_NB) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(preference_mutex);
+    preferences[type] = preference;
+}
+
+std::vector<Track> list(AVFormatContext* ctx) {
+    std::vector<Track> tracks;
+    for (unsigned int i = 0; i < ctx->nb_streams; i++) {
+        const AVStream* st = ctx->streams[i];
+        const AVCodecParameters* par = st->codecpar;
+        if (par->codec_type == AVMEDIA_TYPE_VIDEO && isAttachedPicture(st)) {
+            continue;
+        }
+        Track track;
+        track.index = (int)i;
+        track.type = par->codec_type;
+        track.language = languageOf(st);
+        track.codec = avcodec_get_name(par->codec_id);
+        track.bitrate = par->bit_rate;
+        track.channels = par->channels;
+        track.sampleRate = par->sample_rate;
+        track.width = par->width;
+        track.height = par->height;
+        track.isDefault = (st->disposition & AV_DISPOSITION_DEFAULT) != 0;
+        tracks.push_back(track);
+    }
+    return tracks;
+}
+
+int choose(AVFormatContext* ctx, AVMediaType type) {
+    Preference preference;
+    if (type >= 0 && type < AVMEDIA_TYPE_NB) {
+        std::lock_guard<std::mutex> lock(preference_mutex);
+        preference = preferences[type];
+    }
+    int best = AVERROR_STREAM_NOT_FOUND;
+    Score best_score = {};
+    for (unsigned int i = 0; i < ctx->nb_streams; i++) {
+        const AVStream* st = ctx->streams[i];
+        if (st->codecpar->codec_type != type || (type == AVMEDIA_TYPE_VIDEO && isAttachedPicture(st))) {
+            continue;
+        }
+        Score score = scoreOf(st, preference);
+        // 分数相同时取编号小的
+        if (best < 0 || score > best_score) {
+            best = (int)i;
+            best_score = score;
+        }
+    }
+    if (best >= 0 && best_score.keys[0] == 0) {
+        LOGW("没有可解码的%s流", av_get_media_type_string(type));
+        return AVERROR_STREAM_NOT_FOUND;
+    }
+    return best;
+}
+
+void applyDiscard(AVFormatContext* ctx, int videoIndex, int audioIndex) {
+    for (unsigned int i = 0; i < ctx->nb_streams; i++) {
+        bool selected = (int)i == videoIndex || (int)i == audioIndex;
+        ctx->streams[i]->discard = selected ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+    }
+}
+
+}
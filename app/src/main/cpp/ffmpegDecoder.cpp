@@ -1,6 +1,6 @@
 // 用于实现多线程的解码过程，包括视频解封装和视频解码，并将解码后的帧转换为 YUV 格式并写入输出文件。
 #include <jni.h>
-#include <android/log.h>
+#include "Log.h"
 #include <queue>
 #include <mutex>
 #include <condition_variable>
@@ -8,6 +8,9 @@
 #include <fstream>
 #include <iostream>
 
+#include "FrameConverter.h"
+#include "FramePool.h"
+
 extern "C" {
 #include <libavutil/avutil.h>
 #include <libavcodec/avcodec.h>
@@ -18,8 +21,6 @@ extern "C" {
 }
 
 #define LOG_TAG "ffmpegDecoder"
-#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
-#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
 
 // 全局队列及同步相关变量
 std::mutex packet_queue_mutex;
@@ -27,6 +28,20 @@ std::condition_variable packet_queue_cv;
 std::queue<AVPacket*> packet_queue;
 bool stop_threads = false;
 
+// 输出文件只接受 YUV420P，解码格式相同时直接写解码帧
+static const AVPixelFormat yuvSinkFormats[] = {AV_PIX_FMT_YUV420P, AV_PIX_FMT_NONE};
+
+// 按有效宽度逐行写出 YUV420P 帧，跳过行尾的对齐填充
+static void writeYUV420P(FILE* out_file, const AVFrame* frame) {
+    for (int i = 0; i < 3; i++) {
+        int width = (i == 0) ? frame->width : (frame->width + 1) / 2;
+        int lines = (i == 0) ? frame->height : (frame->height + 1) / 2;
+        for (int j = 0; j < lines; j++) {
+            fwrite(frame->data[i] + j * frame->linesize[i], 1, width, out_file);
+        }
+    }
+}
+
 // 线程1：负责解封装视频流，将视频包放入共享队列中
 void demux_thread(JNIEnv *env, AVFormatContext* fmt_ctx, int video_stream_index) {
     AVPacket* pkt = av_packet_alloc();
@@ -51,13 +66,8 @@ void demux_thread(JNIEnv *env, AVFormatContext* fmt_ctx, int video_stream_index)
 }
 
 // 线程2：负责解码视频帧，将解码后的帧转换为 YUV 格式并写入输出文件
-void decode_thread(AVCodecContext* codec_ctx, SwsContext* sws_ctx, FILE* out_file, int width, int height) {
+void decode_thread(AVCodecContext* codec_ctx, FrameConverter* converter, FILE* out_file) {
     AVFrame* frame = av_frame_alloc();
-    AVFrame* yuv_frame = av_frame_alloc();
-    // 为 YUV420P 帧分配缓冲区
-    uint8_t* yuv_buffer = new uint8_t[av_image_get_buffer_size(AV_PIX_FMT_YUV420P, width, height, 1)];
-    av_image_fill_arrays(yuv_frame->data, yuv_frame->linesize, yuv_buffer,
-                         AV_PIX_FMT_YUV420P, width, height, 1);
 
     while (true) {
         AVPacket* pkt = nullptr;
@@ -86,24 +96,17 @@ void decode_thread(AVCodecContext* codec_ctx, SwsContext* sws_ctx, FILE* out_fil
                 std::cerr << "解码错误" << std::endl;
                 break;
             }
-            // 将解码后的帧转换为 YUV420P 格式
-            sws_scale(sws_ctx,
-                      frame->data, frame->linesize, 0, frame->height,
-                      yuv_frame->data, yuv_frame->linesize);
-            // 将 YUV 数据写入输出文件
-            for (int i = 0; i < 3; i++) {
-                int lines = (i == 0) ? height : height / 2;
-                for (int j = 0; j < lines; j++) {
-                    fwrite(yuv_frame->data[i] + j * yuv_frame->linesize[i],
-                           1, yuv_frame->linesize[i], out_file);
-                }
+            // 将解码后的帧转换为 YUV420P 格式，已是 YUV420P 时不做转换
+            const AVFrame* yuv_frame = converter->convert(frame);
+            if (!yuv_frame) {
+                continue;
             }
+            // 将 YUV 数据写入输出文件
+            writeYUV420P(out_file, yuv_frame);
         }
         av_packet_free(&pkt);
     }
-    delete[] yuv_buffer;
     av_frame_free(&frame);
-    av_frame_free(&yuv_frame);
 }
 
 extern "C" JNIEXPORT jint JNICALL
@@ -161,16 +164,21 @@ Java_com_example_androidplayer_MainActivity_ffmpegDecodethread(JNIEnv *env, jobj
     }
     AVCodecContext* codec_ctx = avcodec_alloc_context3(codec); // 根据解码器创建解码器上下文
     avcodec_parameters_to_context(codec_ctx, codec_params); // 将视频流参数拷贝到解码器上下文
+    FramePool frame_pool; // 解码帧与转换输出共用的缓冲池
+    frame_pool.attach(codec_ctx);
     if (avcodec_open2(codec_ctx, codec, nullptr) < 0) {
         std::cerr << "无法打开解码器" << std::endl;
         return -1;
     }
 
-    // 初始化 SWS 上下文，用于像素格式转换（转换为 YUV420P）
-    SwsContext* sws_ctx = sws_getContext(
-            codec_ctx->width, codec_ctx->height, codec_ctx->pix_fmt,
-            codec_ctx->width, codec_ctx->height, AV_PIX_FMT_YUV420P,
-            SWS_BILINEAR, nullptr, nullptr, nullptr);
+    // 协商像素格式，解码格式不是 YUV420P 时才做转换
+    FrameConverter converter;
+    converter.setFramePool(&frame_pool);
+    if (converter.init(codec_ctx->pix_fmt, codec_ctx->width, codec_ctx->height,
+                       yuvSinkFormats, "decode-thread") < 0) {
+        std::cerr << "像素格式协商失败" << std::endl;
+        return -1;
+    }
 
     // 打开输出文件
     FILE* out_file = fopen(output_file, "wb");
@@ -187,7 +195,7 @@ Java_com_example_androidplayer_MainActivity_ffmpegDecodethread(JNIEnv *env, jobj
 
     // 启动两个线程
     std::thread t1(demux_thread, env, fmt_ctx, video_stream_index);
-    std::thread t2(decode_thread, codec_ctx, sws_ctx, out_file, codec_ctx->width, codec_ctx->height);
+    std::thread t2(decode_thread, codec_ctx, &converter, out_file);
 
     t1.join();
     // 当解封装线程结束后，设置停止标志，并通知等待的解码线程退出
@@ -198,7 +206,7 @@ Java_com_example_androidplayer_MainActivity_ffmpegDecodethread(JNIEnv *env, jobj
     // 释放资源
     avcodec_free_context(&codec_ctx);
     avformat_close_input(&fmt_ctx);
-    sws_freeContext(sws_ctx);
+    converter.release();
     fclose(out_file);
 
     std::cout << "解码完成！" << std::endl;
@@ -253,6 +261,8 @@ Java_com_example_androidplayer_MainActivity_ffmpegDecodernothread(JNIEnv *env, j
     }
     AVCodecContext* codec_ctx = avcodec_alloc_context3(codec);
     avcodec_parameters_to_context(codec_ctx, codec_params);
+    FramePool frame_pool;
+    frame_pool.attach(codec_ctx);
     if (avcodec_open2(codec_ctx, codec, nullptr) < 0) {
         std::cerr << "无法打开解码器" << std::endl;
         return -1;
@@ -260,20 +270,18 @@ Java_com_example_androidplayer_MainActivity_ffmpegDecodernothread(JNIEnv *env, j
 
     // 4. 分配帧和数据包结构
     AVFrame* frame = av_frame_alloc();
-    AVFrame* yuv_frame = av_frame_alloc();
     AVPacket* pkt = av_packet_alloc();
 
-    // 5. 初始化 SWS 上下文用于像素格式转换
-    SwsContext* sws_ctx = sws_getContext(
-            codec_ctx->width, codec_ctx->height, codec_ctx->pix_fmt,
-            codec_ctx->width, codec_ctx->height, AV_PIX_FMT_YUV420P,
-            SWS_BILINEAR, nullptr, nullptr, nullptr);
+    // 5. 协商像素格式，解码格式已是 YUV420P 时跳过转换
+    FrameConverter converter;
+    converter.setFramePool(&frame_pool);
+    if (converter.init(codec_ctx->pix_fmt, codec_ctx->width, codec_ctx->height,
+                       yuvSinkFormats, "decode-nothread") < 0) {
+        std::cerr << "像素格式协商失败" << std::endl;
+        return -1;
+    }
 
-    // 6. 为 YUV 帧分配缓冲区
-    uint8_t* yuv_buffer = new uint8_t[av_image_get_buffer_size(
-            AV_PIX_FMT_YUV420P, codec_ctx->width, codec_ctx->height, 1)];
-    av_image_fill_arrays(yuv_frame->data, yuv_frame->linesize, yuv_buffer,
-                         AV_PIX_FMT_YUV420P, codec_ctx->width, codec_ctx->height, 1);
+    // 6. 转换缓冲区由 FrameConverter 按协商结果分配
 
     // 7. 打开输出文件
     FILE* out_file = fopen(output_file, "wb");
@@ -298,29 +306,22 @@ Java_com_example_androidplayer_MainActivity_ffmpegDecodernothread(JNIEnv *env, j
                     std::cerr << "解码错误" << std::endl;
                     break;
                 }
-                sws_scale(sws_ctx,
-                          frame->data, frame->linesize, 0, frame->height,
-                          yuv_frame->data, yuv_frame->linesize);
-                for (int i = 0; i < 3; i++) {
-                    int lines = (i == 0) ? codec_ctx->height : codec_ctx->height / 2;
-                    for (int j = 0; j < lines; j++) {
-                        fwrite(yuv_frame->data[i] + j * yuv_frame->linesize[i],
-                               1, yuv_frame->linesize[i], out_file);
-                    }
+                const AVFrame* yuv_frame = converter.convert(frame);
+                if (!yuv_frame) {
+                    continue;
                 }
+                writeYUV420P(out_file, yuv_frame);
             }
         }
         av_packet_unref(pkt);
     }
 
     // 9. 清理资源
-    delete[] yuv_buffer;
     av_frame_free(&frame);
-    av_frame_free(&yuv_frame);
     av_packet_free(&pkt);
     avcodec_free_context(&codec_ctx);
     avformat_close_input(&fmt_ctx);
-    sws_freeContext(sws_ctx);
+    converter.release();
     fclose(out_file);
 
     std::cout << "解码完成！" << std::endl;
@@ -1,6 +1,9 @@
 #pragma once
 
 #include <aaudio/AAudio.h>
+#include <atomic>
+#include <mutex>
+#include "AudioClock.h"
 #include "PacketQueue.h"
 
 
@@ -10,36 +13,59 @@
 // 这个回调，返回1表示希望AAudio停止调用回调。
 using AAudioCallback = int(*)(AAudioStream*, void*, void*, int32_t);
 
-class AAudioRender{
+class AAudioRender : public PresentationSource {
     AAudioStream* stream;
+    std::mutex stream_mtx;          // 打开/关闭流与其他线程查询时间戳互斥
     int32_t channel_count;
     int32_t sample_rate;
     bool paused;
     AAudioCallback callback;
     void* user_data;
     aaudio_format_t format;
+    int32_t frames_per_burst;
+    aaudio_sharing_mode_t sharing_mode;
+    int32_t last_xrun_count;        // 只在音频回调线程上访问
+    int32_t callback_count;
+    std::atomic<int32_t> buffer_frames;
+
+    // AAudio 数据回调的入口，调用用户回调后按 XRun 次数调整缓冲区
+    static aaudio_data_callback_result_t dataCallback(AAudioStream* stream, void* userData,
+                                                      void* audioData, int32_t numFrames);
+    void tuneBufferSize();
 
 public:
     ~AAudioRender() ;
 
     AAudioRender();
 
-    // 指定采样率，通道数和数据格式，否则使用默认
+    // 指定采样率，通道数和数据格式，否则使用默认。采样率为0时使用设备的原生采样率，
+    // 数据在应用内重采样一次即可，避免音频服务再做一次重采样
     void configure(int32_t sampleRate, int32_t channelCnt, aaudio_format_t fmt);
 
     // 设置AAudio的回调，指定user_data为你需要的数据指针，user_data会传递给callback的第二个参数
     void setCallback(AAudioCallback cb, void* data);
 //    void setCallback(AAudioCallback cb, PacketQueue* packetQueue);
 
-    // AAudioStream开始工作，成功返回0，失败返回<0
+    // AAudioStream开始工作，成功返回0，失败返回<0。先请求独占模式（可走 MMAP 低延迟通路），
+    // 设备不支持时退回共享模式；已有打开的流时先关闭
     int start();
 
+    // 停止并关闭音频流
+    void stop();
+
     // 刷新AAudio的内部缓冲区
     int flush();
 
     // 参数p为true时表示暂停，为false时表示取消暂停
     int pause(bool p);
 
-    //
+    // 实际协商得到的参数，start 成功后有效
+    int32_t getSampleRate() const { return sample_rate; }
+    int32_t getChannelCount() const { return channel_count; }
+    int32_t getFramesPerBurst() const { return frames_per_burst; }
+    int32_t getBufferSizeInFrames() const { return buffer_frames; }
+    bool isExclusive() const { return sharing_mode == AAUDIO_SHARING_MODE_EXCLUSIVE; }
 
+    // 由 AAudioStream_getTimestamp 得到的实际呈现位置，可在任意线程调用；流未开始输出时返回 false
+    bool getPresentedPosition(int64_t* framePosition, int64_t* timeNs) override;
 };
@@ -0,0 +1,83 @@
+#ifndef ANDROIDPLAYER_AUDIOCLOCK_H
+#define ANDROIDPLAYER_AUDIOCLOCK_H
+
+#include <stdint.h>
+#include <math.h>
+#include <atomic>
+#include <mutex>
+
+// 音频输出的实际呈现位置。帧位置以音频流开始以来写出的帧计数，与回调中写出的帧数同一度量
+class PresentationSource {
+public:
+    virtual ~PresentationSource() = default;
+
+    // 返回 timeNs（CLOCK_MONOTONIC 纳秒）时刻正在被听到的帧位置，暂时无法获得时返回 false
+    virtual bool getPresentedPosition(int64_t* framePosition, int64_t* timeNs) = 0;
+};
+
+// 固定输出延迟的模拟来源，在没有音频设备的主机环境中代替 AAudio 时间戳：
+// 以最近一次回调写出的帧数减去延迟作为当时听到的位置
+class SimulatedLatencySource : public PresentationSource {
+public:
+    SimulatedLatencySource(int sampleRate, int latencyMs);
+
+    // 在回调中调用，frames 为本次写出的帧数
+    void onFramesWritten(int64_t frames);
+
+    bool getPresentedPosition(int64_t* framePosition, int64_t* timeNs) override;
+
+private:
+    int64_t latency_frames;
+    std::atomic<int64_t> written{0};
+    std::atomic<int64_t> write_time_ns{0};
+};
+
+// 音频播放时钟：当前真正被听到的媒体时间。
+// 解码线程记录环形缓冲区中某一帧对应的媒体时间（锚点），音频回调记录环形缓冲区的读位置和累计写给设备的帧数，
+// 查询时用呈现来源给出的已听到的帧位置算出仍在设备缓冲中的帧数，从读位置中扣除后由锚点换算为媒体时间。
+// 结果相对单调时钟做平滑，偏差超过阈值（跳转、切换）时直接对齐
+class AudioClock {
+public:
+    // 重新开始计时，在音频流启动前调用；source 可为空，此时不计输出延迟
+    void reset(PresentationSource* source);
+
+    // 音频流协商得到的采样率
+    void setSampleRate(int sampleRate);
+
+    // 解码线程：自 reset 起写入环形缓冲区的第 ringFrame 帧的媒体时间为 pts 秒
+    void setAnchor(int64_t ringFrame, double pts);
+
+    // 音频回调：读完后环形缓冲区的读位置为 ringFrame，输出流累计写给设备 deviceFrame 帧（含补的静音与其他来源的混音）
+    void onCallback(int64_t ringFrame, int64_t deviceFrame);
+
+    // 暂停期间时钟停在暂停时的值
+    void setPaused(bool paused);
+
+    // 当前被听到的媒体时间（秒），还没有锚点或采样率时返回 NAN
+    double now();
+
+    // 环形缓冲区第 ringFrame 帧的媒体时间（秒），按最近的锚点推算，没有锚点时返回 NAN
+    double mediaTimeAt(int64_t ringFrame);
+
+    // 最近一次估计的输出延迟（微秒）
+    int64_t latencyUs() const { return latency_us; }
+
+private:
+    static int64_t monotonicNs();
+
+    std::mutex mtx;
+    PresentationSource* source = nullptr;
+    int sample_rate = 0;
+    bool has_anchor = false;
+    int64_t anchor_frame = 0;
+    double anchor_pts = 0;
+    bool paused = false;
+    bool has_offset = false;
+    double smoothed_offset = 0;     // 媒体时间减单调时钟（秒）
+    double paused_value = NAN;
+    std::atomic<int64_t> ring_read{0};  // 最近一次回调后环形缓冲区的读位置（帧）
+    std::atomic<int64_t> written{0};    // 输出流累计写给设备的帧数
+    std::atomic<int64_t> latency_us{0};
+};
+
+#endif //ANDROIDPLAYER_AUDIOCLOCK_H
@@ -0,0 +1,45 @@
+#ifndef ANDROIDPLAYER_AUDIOCROSSFADE_H
+#define ANDROIDPLAYER_AUDIOCROSSFADE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+// 播放列表切换时的音频交叉淡化，输入输出均为交织的 S16 PCM。
+// 开启时始终保留最近 durationMs 的数据不输出，切换到下一项时把保留的上一项尾部
+// 与下一项开头按等功率曲线混合；时长为0时直接透传。
+// 保留的数据放在 configure 时分配的定长环形缓冲区中，处理过程中不分配内存、不整体搬移
+class AudioCrossfade {
+public:
+    void configure(int sampleRate, int channels, int durationMs);
+
+    // 处理 frames 帧输入，可输出的数据追加到 out
+    void process(const int16_t* in, int frames, std::vector<int16_t>& out);
+
+    // 之后的输入属于下一项，与保留的尾部交叉淡化
+    void markBoundary();
+
+    // 输出保留的数据，播放结束时调用
+    void flush(std::vector<int16_t>& out);
+
+    // 丢弃保留的数据与进行中的淡化，跳转后调用
+    void reset();
+
+private:
+    // 把 count 个采样放入环形缓冲区，挤出的最早数据追加到 out
+    void append(const int16_t* in, size_t count, std::vector<int16_t>& out);
+    // 按从旧到新的顺序取出环形缓冲区中最早的 count 个采样
+    void take(size_t count, int16_t* dst);
+
+    int channels = 2;
+    size_t window = 0;              // 淡化窗口的采样数（帧数 * 声道数）
+    std::vector<int16_t> tail;      // 尚未输出的最近数据，容量为 window 的环形缓冲区
+    size_t tail_start = 0;          // 最早一个采样的位置
+    size_t tail_size = 0;
+    std::vector<int16_t> fade_from; // 切换时冻结的上一项尾部，容量为 window
+    size_t fade_size = 0;           // fade_from 中有效的采样数
+    size_t fade_pos = 0;            // 已混合的采样数，等于 fade_size 时淡化结束
+    std::vector<int16_t> mixed;     // 淡化结果的临时缓冲区，容量为 window
+};
+
+#endif //ANDROIDPLAYER_AUDIOCROSSFADE_H
@@ -0,0 +1,103 @@
+#ifndef ANDROIDPLAYER_AUDIODSP_H
+#define ANDROIDPLAYER_AUDIODSP_H
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+// 解码线程上的音频处理：平滑增益 -> N 段双二阶均衡 -> 前视限幅，输入输出为交织的 S16 立体声，原地处理。
+// 均衡按段向量化：每 4 段为一组占一个 SIMD 寄存器的 4 个通道，第 k 段处理第 k-1 段上一个采样的输出，
+// 组内流水线因此带来每组 3 个采样的固定延迟。
+// 设置在 UI 线程上修改，经三缓冲交给音频线程，音频线程不加锁；configure 之后处理过程不分配内存。
+// 所有设置都为默认值时直接返回，不产生额外开销
+class AudioDsp {
+public:
+    enum BandType {
+        BAND_OFF = 0,
+        BAND_PEAK = 1,
+        BAND_LOW_SHELF = 2,
+        BAND_HIGH_SHELF = 3,
+    };
+    static const int MAX_BANDS = 8;
+
+    AudioDsp();
+
+    // UI 线程：增益（dB），处理时约 20ms 平滑过渡
+    void setGainDb(float db);
+    // UI 线程：设置第 index 段，BAND_OFF 关闭该段
+    void setBand(int index, BandType type, float freq, float gainDb, float q);
+    // UI 线程：前视限幅，峰值超过阈值（dBFS）时提前 5ms 压低增益
+    void setLimiter(bool enabled, float thresholdDb);
+
+    // 音频线程：按输出采样率分配限幅延迟线并重新计算系数，清空滤波器状态
+    void configure(int sampleRate);
+    // 音频线程：原地处理 frames 帧交织立体声
+    void process(int16_t* pcm, int frames);
+
+    // 处理 blocks 个 1024 帧的块，返回每块的平均耗时（纳秒）
+    static double benchmark(int bands, bool limiter, int blocks);
+
+private:
+    static const int CHANNELS = 2;
+    static const int CHUNK_FRAMES = 1024;
+    static const int LANES = 4;
+
+    struct Band {
+        int type = BAND_OFF;
+        float freq = 1000.0f;
+        float gain_db = 0.0f;
+        float q = 0.707f;
+    };
+    struct Settings {
+        float gain_db = 0.0f;
+        Band bands[MAX_BANDS];
+        bool limiter = false;
+        float threshold_db = -1.0f;
+    };
+    // 4 段双二阶（转置直接 II 型），每个数组的第 k 项对应组内第 k 段
+    struct BiquadGroup {
+        float b0[LANES], b1[LANES], b2[LANES], a1[LANES], a2[LANES];
+        float z1[CHANNELS][LANES], z2[CHANNELS][LANES];
+        float y[CHANNELS][LANES];   // 上一步各段的输出，移入下一段
+    };
+
+    void publish();
+    void pollSettings();
+    void apply(const Settings& settings);
+    static void runGroup(BiquadGroup& group, int channel, float* x, int frames);
+    void limit(int frames);
+
+    // 三缓冲：UI 线程写 back 后与 middle 交换，音频线程发现 middle 有新数据时与 front 交换
+    std::mutex settings_mutex;
+    Settings pending;               // UI 线程上的完整设置
+    Settings buffers[3];
+    int back = 0;
+    int front = 1;
+    std::atomic<int> middle;
+    bool force_apply = true;
+
+    int sample_rate = 0;
+    float gain = 1.0f;              // 当前线性增益
+    float gain_target = 1.0f;
+    float gain_coeff = 0.0f;        // 每帧向目标靠近的比例
+    BiquadGroup groups[MAX_BANDS / LANES];
+    int group_count = 0;
+    bool limiter = false;
+    float threshold = 1.0f;
+    float limiter_gain = 1.0f;
+    float release_coeff = 0.0f;
+    float attack_step = 0.0f;       // 压低阶段每帧减小的增益
+    int64_t attack_end = -1;        // 压低阶段结束（目标峰值输出）的帧序号
+    int lookahead = 0;              // 前视的帧数
+    int delay_pos = 0;
+    int64_t frame_index = 0;
+    std::vector<float> delay[CHANNELS];
+    std::vector<float> peak_value;  // 前视窗口内峰值的单调队列
+    std::vector<int64_t> peak_index;
+    int peak_head = 0;
+    int peak_size = 0;
+    float buf[CHANNELS][CHUNK_FRAMES];
+};
+
+#endif //ANDROIDPLAYER_AUDIODSP_H
@@ -0,0 +1,44 @@
+#ifndef ANDROIDPLAYER_AUDIOMIXER_H
+#define ANDROIDPLAYER_AUDIOMIXER_H
+
+#include <stdint.h>
+#include "AudioClock.h"
+#include "PcmRing.h"
+
+// 进程内的音频混音器：整个进程只打开一路 AAudio 输出流（S16 立体声，设备原生采样率），
+// 各播放来源把 PCM 写入自己的 PcmRing，混音器在同一个实时回调里读取各来源、按增益渐变后饱和相加。
+// 来源的添加、移除、增益与暂停都不需要停止输出流，最后一路来源移除后才关闭输出流、释放设备；
+// 增益变化与进出都经过约 10ms 的线性渐变，避免爆音。
+// 回调线程上不加锁也不分配内存，来源槽位固定，状态用原子变量交接
+namespace AudioMixer {
+    // 每次回调读完一路来源后调用：ringFrame 为该来源环形缓冲区的读位置（帧），
+    // deviceFrame 为输出流启动以来累计写给设备的帧数，在音频回调线程上执行
+    using Listener = void (*)(void* opaque, int64_t ringFrame, int64_t deviceFrame);
+
+    // 同时存在的来源上限
+    const int MAX_SOURCES = 8;
+
+    // 添加一路来源，ring 中为输出采样率的交织立体声 S16。增益从0渐变到 gain（0~1）。
+    // 输出流尚未打开时先打开，失败或槽位已满时返回 -1，否则返回来源编号
+    int addSource(PcmRing* ring, float gain, Listener listener, void* opaque);
+
+    // 渐变到静音后移除，返回后回调不再访问该来源的 ring。移除的是最后一路来源时关闭输出流
+    void removeSource(int id);
+
+    // 设置增益（0~1），从当前值渐变过去
+    void setGain(int id, float gain);
+
+    // 暂停的来源渐变到静音后不再从 ring 读取
+    void setPaused(int id, bool paused);
+
+    // 跳转后丢弃 ring 中尚未播放的旧数据，由回调线程在下一次回调时丢弃
+    void discard(int id);
+
+    // 输出流的采样率，未打开时为0
+    int32_t sampleRate();
+
+    // 输出流的实际呈现位置，供 AudioClock 扣除输出延迟
+    PresentationSource* presentation();
+}
+
+#endif //ANDROIDPLAYER_AUDIOMIXER_H
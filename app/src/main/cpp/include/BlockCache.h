@@ -0,0 +1,34 @@
+#ifndef ANDROIDPLAYER_BLOCKCACHE_H
+#define ANDROIDPLAYER_BLOCKCACHE_H
+
+#include <stdint.h>
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+// 远程输入（http/https）的磁盘块缓存。资源按固定大小分块，已下载的块写入以 URL 哈希命名的稀疏数据文件，
+// 索引文件记录资源大小和每块是否已缓存。读取与跳转时命中的块直接从磁盘读，
+// 只有缺失的块才由 RangeFetcher 多连接并行下载：读取位置所在块最先，打开时文件尾（moov）与文件头并行，
+// 之后保持读取位置之后若干块的预读。
+// 以条目为单位按最近使用时间淘汰，总占用（按实际分配的磁盘空间计）不超过容量上限。
+// 假定同一 URL 的内容不变；源站报告的大小与索引不一致时丢弃整个条目
+namespace BlockCache {
+    // 设置缓存目录与容量上限（字节），目录为空时缓存不生效
+    void setDirectory(const char* dir, int64_t capacity);
+
+    // 下载连接数与读取位置之后的预读块数（每块 256 KiB），对之后打开的输入生效
+    void setFetchOptions(int connections, int aheadBlocks);
+
+    // 为远程 url 创建读取走缓存的 pb。interrupt 为所属 AVFormatContext 的中断回调，
+    // 等待下载时在读取线程上检查其当前值，pb 的生命周期不得超过它。
+    // 未设置目录、资源大小未知（如直播）或同一 URL 已在使用时返回 nullptr，调用方直接打开源地址
+    AVIOContext* open(const char* url, const AVIOInterruptCB* interrupt);
+
+    // pb 是否由 open 创建
+    bool owns(const AVIOContext* pb);
+
+    // 关闭 pb，写回索引并按容量淘汰
+    void close(AVIOContext** pb);
+}
+
+#endif //ANDROIDPLAYER_BLOCKCACHE_H
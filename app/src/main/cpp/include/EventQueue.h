@@ -0,0 +1,65 @@
+#ifndef ANDROIDPLAYER_EVENTQUEUE_H
+#define ANDROIDPLAYER_EVENTQUEUE_H
+
+#include <jni.h>
+#include <queue>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+// native 向 Java 投递的事件，取值与 Player.java 中的 EVENT_* 常量一致
+enum PlayerEvent {
+    EVENT_PREPARE_PROGRESS = 1,  // arg1 为 PrepareStage
+    EVENT_PREPARED = 2,
+    EVENT_ERROR = 3,             // arg1 为 AVERROR 错误码
+    EVENT_CANCELLED = 4,
+    EVENT_PLAYLIST_ITEM = 5,     // 播放列表切换到下一项，arg1 为序号
+    EVENT_REVERSE_FINISHED = 6,  // 倒放到开头，之后从开头正向播放
+};
+
+// 异步准备的阶段，随 EVENT_PREPARE_PROGRESS 上报
+enum PrepareStage {
+    PREPARE_OPENING = 0,         // avformat_open_input
+    PREPARE_PROBING = 1,         // 读取流信息
+    PREPARE_OPENING_DECODERS = 2,
+};
+
+// native 到 Java 的事件队列。任意线程 post，由一个挂接到 JVM 的投递线程按顺序调用
+// listener 的 onNativeEvent(int what, int arg1, int arg2)，post 不会阻塞在 Java 代码上
+class EventQueue {
+public:
+    EventQueue() = default;
+    ~EventQueue();
+
+    // 在 JNI_OnLoad 中设置
+    static void setJavaVM(JavaVM* vm);
+
+    // 设置接收事件的 Java 对象并启动投递线程，重复调用时替换 listener
+    void attach(JNIEnv* env, jobject listener);
+
+    // 停止投递线程并释放 listener，未投递的事件丢弃
+    void detach(JNIEnv* env);
+
+    void post(int what, int arg1 = 0, int arg2 = 0);
+
+private:
+    struct Event {
+        int what;
+        int arg1;
+        int arg2;
+    };
+
+    void deliverLoop();
+
+    static JavaVM* java_vm;
+
+    std::mutex mtx;
+    std::condition_variable cond;
+    std::queue<Event> events;
+    std::thread thread;
+    jobject listener = nullptr;     // 全局引用
+    jmethodID on_event = nullptr;
+    bool running = false;
+};
+
+#endif //ANDROIDPLAYER_EVENTQUEUE_H
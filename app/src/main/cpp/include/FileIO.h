@@ -0,0 +1,46 @@
+#ifndef ANDROIDPLAYER_FILEIO_H
+#define ANDROIDPLAYER_FILEIO_H
+
+#include <stdint.h>
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+// 本地文件的自定义 AVIOContext。FFmpeg 自带的 file: 协议每次 read() 只读一个小缓冲区，
+// 高码率或全帧内编码的内容会卡在系统调用上。这里提供两种后端：
+//  - mmap：整个文件映射到内存，madvise(SEQUENTIAL) 并对读取位置之后的窗口 WILLNEED
+//  - 预读：后台线程以大块 pread 保持读取位置之后若干块已在内存中，适合顺序读取的大文件
+// 远程地址交给 BlockCache，未启用缓存时与 content:// 等其他路径一样使用 FFmpeg 自带协议
+namespace FileIO {
+    enum Backend {
+        BACKEND_AUTO = 0,       // 按文件大小选择：小文件 mmap，大文件预读
+        BACKEND_STOCK = 1,      // FFmpeg 自带 file: 协议
+        BACKEND_MMAP = 2,
+        BACKEND_READAHEAD = 3,
+    };
+
+    void setBackend(Backend backend);
+
+    // 代替 avformat_open_input：本地文件按配置的后端创建 pb 后打开，其余情况直接打开。
+    // *fmt_ctx 可为预先分配（如已设置 interrupt_callback）的上下文，失败时与 avformat_open_input 一样被释放
+    int openInput(AVFormatContext** fmt_ctx, const char* url, AVDictionary** options);
+
+    // 同上，但指定后端，BACKEND_AUTO 时按文件大小选择
+    int openInput(AVFormatContext** fmt_ctx, const char* url, AVDictionary** options, Backend backend);
+
+    // 代替 avformat_close_input，同时释放 openInput 创建的 pb（包括 BlockCache 的）
+    void closeInput(AVFormatContext** fmt_ctx);
+
+    struct BenchmarkResult {
+        int64_t packets;
+        int64_t bytes;
+        double wallSeconds;
+        double cpuSeconds;      // 进程 CPU 时间，包含预读线程
+    };
+
+    // 用指定后端从头到尾读取一遍数据包（不解码），统计数据包数、耗时和 CPU 时间。
+    // 第一次读取会把文件载入页缓存，对比不同后端前应先预热一遍。成功返回0
+    int benchmark(const char* url, Backend backend, BenchmarkResult* result);
+}
+
+#endif //ANDROIDPLAYER_FILEIO_H
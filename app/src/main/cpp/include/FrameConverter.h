@@ -0,0 +1,70 @@
+#ifndef ANDROIDPLAYER_FRAMECONVERTER_H
+#define ANDROIDPLAYER_FRAMECONVERTER_H
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
+#include <libswscale/swscale.h>
+}
+#include "FramePool.h"
+
+// 像素格式转换路径，按代价从低到高排列
+enum class ConvertPath {
+    Passthrough, // 解码帧格式即输出格式，直接使用解码帧的平面，不做任何拷贝
+    FastKernel,  // 只需重排色度平面（NV12/NV21 -> YUV420P），亮度平面直接复用
+    Swscale,     // 其余情况交给 swscale 兜底
+};
+
+const char* convertPathName(ConvertPath path);
+
+// 像素格式协商。sinkFormats 为输出端可接受的格式，按偏好排列并以 AV_PIX_FMT_NONE 结尾。
+// 返回代价最低的输出格式，代价相同时取输出端更偏好的格式，所选路径通过 path 返回
+AVPixelFormat negotiatePixelFormat(AVPixelFormat srcFmt, const AVPixelFormat* sinkFormats, ConvertPath* path);
+
+// 解码帧到输出端格式的转换器，初始化时完成一次格式协商，之后每帧按协商结果走对应路径
+class FrameConverter {
+public:
+    FrameConverter();
+    ~FrameConverter();
+
+    // 按源格式和输出端格式列表协商并准备转换资源，tag 用于在日志中标识会话。成功返回0，失败返回<0
+    int init(AVPixelFormat srcFmt, int width, int height, const AVPixelFormat* sinkFormats, const char* tag);
+
+    // 输出帧从 pool 中分配，不设置时使用 FFmpeg 默认分配器。需在 init 之前调用
+    void setFramePool(FramePool* pool) { this->frame_pool = pool; }
+
+    // 设置输出尺寸，传0表示与源帧相同。尺寸与源帧不同时只能走 swscale，在转换的同时完成缩放，
+    // 新尺寸在下一次 convert 时生效
+    void setOutputSize(int w, int h);
+
+    // 转换一帧，源帧尺寸、格式或输出尺寸变化时自动重新协商。
+    // 返回的帧在下一次调用 convert/release 之前有效，Passthrough 路径直接返回 src。
+    // 下游需要更久地持有时用 av_frame_ref 增加引用即可，之后的转换会另取缓冲，不会覆盖被持有的帧
+    const AVFrame* convert(const AVFrame* src);
+
+    void release();
+
+    AVPixelFormat outputFormat() const { return dst_fmt; }
+    ConvertPath path() const { return convert_path; }
+
+private:
+    AVFrame* allocOutput();
+    int prepareOutput();
+
+    FramePool* frame_pool;
+    const AVPixelFormat* sink_formats;
+    const char* tag;
+    AVPixelFormat src_fmt;
+    AVPixelFormat dst_fmt;
+    int width;
+    int height;
+    int out_width;  // 调用方请求的输出尺寸，0表示跟随源帧
+    int out_height;
+    int dst_width;  // 当前实际输出尺寸
+    int dst_height;
+    ConvertPath convert_path;
+    SwsContext* sws_ctx;
+    AVFrame* dst_frame;
+};
+
+#endif //ANDROIDPLAYER_FRAMECONVERTER_H
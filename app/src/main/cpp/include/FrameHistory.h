@@ -0,0 +1,62 @@
+#ifndef ANDROIDPLAYER_FRAMEHISTORY_H
+#define ANDROIDPLAYER_FRAMEHISTORY_H
+
+#include <stdint.h>
+#include <atomic>
+#include <deque>
+#include "FramePool.h"
+extern "C" {
+#include <libavutil/frame.h>
+#include <libswscale/swscale.h>
+}
+
+// 逐帧的历史缓存：按上屏顺序保存最近上屏的若干帧（渲染端格式），游标指向当前显示的一帧。
+// 后退以及后退之后的前进直接从这里上屏，不需要解码。
+// 平时只增加引用不拷贝；单帧较大、预算内放不下 MIN_FULL_FRAMES 帧时改存缩小一半的副本，缓冲从 FramePool 分配。
+// 只在视频解码线程上访问，预算可在其他线程上设置
+class FrameHistory {
+public:
+    static const size_t DEFAULT_BUDGET = 64 * 1024 * 1024;
+    static const int MIN_FULL_FRAMES = 16;
+
+    explicit FrameHistory(FramePool* pool);
+    ~FrameHistory();
+
+    // 总大小上限（字节），0 表示不保存历史，下一次 push 时生效
+    void setBudget(size_t bytes);
+
+    // 记录刚上屏的一帧，pts 小于最新一帧时（跳转、播放列表切换）先清空，游标移到最新
+    void push(const AVFrame* frame, int64_t pts);
+
+    void clear();
+
+    // 游标后退或前进一帧并返回该帧，到头时返回 nullptr。返回的帧在下一次修改历史之前有效
+    const AVFrame* back();
+    const AVFrame* forward();
+
+    bool empty() const { return entries.empty(); }
+    bool atNewest() const { return cursor + 1 >= (int)entries.size(); }
+
+    // 游标处与最早一帧的时间戳，没有时为 AV_NOPTS_VALUE
+    int64_t currentPts() const;
+    int64_t oldestPts() const;
+
+private:
+    struct Entry {
+        AVFrame* frame;
+        int64_t pts;
+        size_t bytes;
+    };
+
+    AVFrame* downscale(const AVFrame* frame);
+    void popOldest();
+
+    FramePool* frame_pool;
+    std::atomic<size_t> budget;
+    std::deque<Entry> entries;
+    int cursor = -1;
+    size_t total_bytes = 0;
+    SwsContext* sws_ctx = nullptr;
+};
+
+#endif //ANDROIDPLAYER_FRAMEHISTORY_H
@@ -0,0 +1,64 @@
+#ifndef ANDROIDPLAYER_FRAMEPOOL_H
+#define ANDROIDPLAYER_FRAMEPOOL_H
+
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <unordered_map>
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/frame.h>
+}
+
+// 视频帧缓冲池。缓冲区按大小分桶复用，64字节对齐，以 AVBufferRef 引用计数管理，
+// 最后一个引用释放时回到池中而不是还给系统。解码器通过 get_buffer2 从池中取缓冲，
+// 转换和输出阶段通过 allocFrame 取缓冲，下游持有帧只需 av_frame_ref，无需拷贝。
+// 总分配量受内存上限约束，超过上限时先回收空闲缓冲，仍不够则交还 FFmpeg 默认分配器。
+class FramePool {
+public:
+    static const size_t DEFAULT_MEMORY_LIMIT = 256 * 1024 * 1024;
+    static const int BUFFER_ALIGN = 64;
+
+    explicit FramePool(size_t memoryLimit = DEFAULT_MEMORY_LIMIT);
+    ~FramePool();
+
+    // 接管解码器的 get_buffer2，需在 avcodec_open2 之前调用
+    void attach(AVCodecContext* ctx);
+
+    // 分配一帧带引用计数的图像，packed 为 true 时按行紧密排列（输出端整块上传时使用），失败返回 nullptr
+    AVFrame* allocFrame(AVPixelFormat fmt, int width, int height, bool packed);
+
+    // 从池中取一块至少 size 字节的缓冲，超过内存上限时返回 nullptr
+    AVBufferRef* getBuffer(size_t size);
+
+    void setMemoryLimit(size_t bytes);
+
+    // 释放所有空闲缓冲，正在使用的缓冲不受影响
+    void trim();
+
+    size_t allocatedBytes() const;
+
+    // AVCodecContext::get_buffer2 回调，ctx->opaque 为 FramePool
+    static int getBuffer2(AVCodecContext* ctx, AVFrame* frame, int flags);
+
+private:
+    // 池的共享状态，池本身与每块在外的缓冲各持有一个引用，
+    // 池先于缓冲析构时，缓冲释放时仍能安全地归还或释放
+    struct State {
+        std::mutex mtx;
+        std::unordered_map<size_t, std::vector<uint8_t*>> free_buffers; // 按缓冲大小分桶的空闲缓冲
+        size_t allocated = 0;  // 已分配的总字节数（含空闲缓冲）
+        size_t idle = 0;       // 空闲缓冲的总字节数
+        size_t limit = 0;
+        bool closed = false;
+        std::atomic<int> refs{1};
+    };
+
+    static void releaseBuffer(void* opaque, uint8_t* data);
+    static void unref(State* state);
+    static void evictIdle(State* state, size_t needed);
+
+    State* state;
+};
+
+#endif //ANDROIDPLAYER_FRAMEPOOL_H
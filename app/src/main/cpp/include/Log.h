@@ -0,0 +1,76 @@
+#ifndef ANDROIDPLAYER_LOG_H
+#define ANDROIDPLAYER_LOG_H
+
+#include <stdint.h>
+#include <atomic>
+
+// 日志级别，数值与 android_LogPriority 保持一致
+enum LogLevel {
+    LOG_LEVEL_VERBOSE = 2,
+    LOG_LEVEL_DEBUG = 3,
+    LOG_LEVEL_INFO = 4,
+    LOG_LEVEL_WARN = 5,
+    LOG_LEVEL_ERROR = 6,
+    LOG_LEVEL_SILENT = 8,
+};
+
+// 编译期最低级别，低于该级别的日志调用在编译时被整体消除，参数也不会求值。
+// release 构建（定义了 NDEBUG）默认只保留 INFO 及以上，可通过 -DLOG_MIN_LEVEL=... 覆盖
+#ifndef LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define LOG_MIN_LEVEL LOG_LEVEL_INFO
+#else
+#define LOG_MIN_LEVEL LOG_LEVEL_VERBOSE
+#endif
+#endif
+
+// 异步日志：调用线程只负责格式化并写入无锁环形缓冲区，由后台线程批量输出到 logcat
+// （Linux 主机上输出到 stdout），解码和音频线程上不再产生日志系统调用。缓冲区满时丢弃新日志并计数
+namespace Logger {
+    // 设置运行时级别。tag 为 nullptr 时设置全局级别，否则只设置该子系统（按 LOG_TAG 区分）
+    void setLevel(const char* tag, int level);
+
+    // 该级别的日志在该子系统下是否需要输出
+    bool isEnabled(int level, const char* tag);
+
+    // 按调用点限频，距上次放行不足 intervalMs 毫秒时返回 false，last 由调用点的静态变量提供
+    bool allow(std::atomic<int64_t>* last, int64_t intervalMs);
+
+    void print(int level, const char* tag, const char* fmt, ...) __attribute__((format(printf, 3, 4)));
+
+    // 输出超过单条长度上限的文本（统计 JSON 等）：按上限切成多条依次写入，
+    // 每条带 [序号/总数] 前缀便于拼接，不在 UTF-8 字符中间切开
+    void printLong(int level, const char* tag, const char* text);
+
+    // 等待后台线程把缓冲区中已有的日志全部输出
+    void flush();
+
+    // 因缓冲区满被丢弃的日志条数
+    uint64_t droppedCount();
+}
+
+#define LOG_PRINT(level, tag, ...)                                                  \
+    do {                                                                            \
+        if ((level) >= LOG_MIN_LEVEL && Logger::isEnabled((level), (tag))) {        \
+            Logger::print((level), (tag), __VA_ARGS__);                             \
+        }                                                                           \
+    } while (0)
+
+// 限频日志，同一调用点每 intervalMs 毫秒最多输出一条，适合放在轮询或逐帧的路径上
+#define LOG_EVERY_MS(intervalMs, level, tag, ...)                                   \
+    do {                                                                            \
+        static std::atomic<int64_t> log_last_time_(0);                              \
+        if ((level) >= LOG_MIN_LEVEL && Logger::isEnabled((level), (tag))          \
+            && Logger::allow(&log_last_time_, (intervalMs))) {                      \
+            Logger::print((level), (tag), __VA_ARGS__);                             \
+        }                                                                           \
+    } while (0)
+
+// 各文件定义 LOG_TAG 后直接使用以下宏，LOG_TAG 在展开时才求值，可以定义在 include 之后
+#define LOGV(...) LOG_PRINT(LOG_LEVEL_VERBOSE, LOG_TAG, __VA_ARGS__)
+#define LOGD(...) LOG_PRINT(LOG_LEVEL_DEBUG, LOG_TAG, __VA_ARGS__)
+#define LOGI(...) LOG_PRINT(LOG_LEVEL_INFO, LOG_TAG, __VA_ARGS__)
+#define LOGW(...) LOG_PRINT(LOG_LEVEL_WARN, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) LOG_PRINT(LOG_LEVEL_ERROR, LOG_TAG, __VA_ARGS__)
+
+#endif //ANDROIDPLAYER_LOG_H
@@ -2,6 +2,7 @@
 #define OPENGL_RENDERER_H
 
 #include <jni.h>
+#include <mutex>
 #include <EGL/egl.h>
 #include <GLES2/gl2.h>
 #include <android/native_window.h>
@@ -9,10 +10,64 @@
 #include <android/log.h>
 
 
-bool initOpenGL(ANativeWindow* window, int width, int height);
+// 常驻的 OpenGL ES 渲染器。EGL 上下文、着色器程序、纹理和 VBO 在第一次 attach 时创建，
+// 之后跨播放会话和窗口变化一直保留：同一窗口复用 EGLSurface，换窗口时只重建 EGLSurface，
+// 纹理尺寸变化时重新分配存储而不重建纹理对象。默认 EGLDisplay 为进程共享，不调用 eglTerminate。
+// 上下文同一时间只能在一个线程上 current，解码线程开始渲染前 attach，结束时 detach
+class OpenGLRenderer {
+public:
+    OpenGLRenderer() = default;
+    ~OpenGLRenderer();
 
-void renderFrame(uint8_t* rgbaData, int width, int height);
+    // 在当前线程上绑定到 window 并设为 current，必要时创建上下文或切换 EGLSurface。成功返回 true
+    bool attach(ANativeWindow* window);
 
-void cleanupOpenGL(); // 释放资源
+    // 让出当前线程上的上下文，EGLSurface 与 GL 资源保留给下一次 attach
+    void detach();
 
-#endif // OPENGL_RENDERER_H
\ No newline at end of file
+    // 销毁 EGLSurface，窗口即将失效时调用（可在任意线程），下一次 attach 时重新创建
+    void releaseSurface();
+
+    // 调整绘制区域，纹理按视口大小在着色器采样时完成缩放
+    void resizeViewport(int width, int height);
+
+    void renderFrame(uint8_t* rgbaData, int width, int height);
+
+    // 渲染 YUV420P 帧，planes/linesizes 为三个平面的数据与行宽，颜色转换在着色器中完成
+    void renderFrameYUV420P(uint8_t* const planes[3], const int linesizes[3], int width, int height);
+
+private:
+    bool initContext();
+    bool initPrograms();
+    bool initRGBAProgram();
+    bool initYUVProgram();
+    void destroySurfaceLocked();
+
+    std::mutex mtx;     // 保护 EGL 对象的创建与销毁，渲染只在持有上下文的线程上进行
+    EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+    EGLConfig eglConfig = nullptr;
+    EGLContext eglContext = EGL_NO_CONTEXT;
+    EGLSurface eglSurface = EGL_NO_SURFACE;
+    ANativeWindow* surfaceWindow = nullptr; // eglSurface 所对应的窗口，持有一个引用
+    bool programsReady = false;
+
+    GLuint programObject = 0;
+    GLuint textureId = 0;
+    GLint attrPosition = -1;
+    GLint attrTexCoord = -1;
+    GLint uniTexture = -1;
+    GLuint vbo = 0;
+    int rgbaTextureWidth = 0;
+    int rgbaTextureHeight = 0;
+    // YUV420P 直接上传所用的程序与纹理，省去 CPU 端的 RGBA 转换
+    GLuint yuvProgramObject = 0;
+    GLuint yuvTextureIds[3] = {0, 0, 0};
+    GLint yuvAttrPosition = -1;
+    GLint yuvAttrTexCoord = -1;
+    GLint yuvUniTextures[3] = {-1, -1, -1};
+    GLint yuvUniCrop = -1;
+    int yuvTextureWidths[3] = {0, 0, 0};
+    int yuvTextureHeights[3] = {0, 0, 0};
+};
+
+#endif // OPENGL_RENDERER_H
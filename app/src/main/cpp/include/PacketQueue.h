@@ -11,10 +11,16 @@ extern "C" {
 
 class PacketQueue {
 public:
-    std::queue<AVPacket*> queue;
+    // 每个数据包带有入队时的序号，播放列表切换到下一项时序号加一，解码线程据此识别分界
+    struct Entry {
+        AVPacket* pkt;
+        int serial;
+    };
+    std::queue<Entry> queue;
     std::mutex mtx;
     std::condition_variable cond;
     bool finished;
+    int serial;
 
 
 public:
@@ -23,25 +29,23 @@ public:
 
     void push(AVPacket* pkt);
 
-    bool pop(AVPacket* pkt);
+    // serial 不为空时返回数据包的序号
+    bool pop(AVPacket* pkt, int* serial = nullptr);
 
-    void setFinished(bool finished);
+    // 之后入队的数据包使用新的序号，返回新序号
+    int nextSerial();
 
-    bool isFinished();
-};
+    int currentSerial();
 
-// 音频队列
-class SafeQueue {
+    // 丢弃排队中的数据包，序号和结束状态不变
+    void flush();
 
-public:
-    void push(uint8_t* data, size_t size);
-    std::unique_ptr<uint8_t[]> pop();
-    bool empty() const;
+    void setFinished(bool finished);
 
-public:
-    std::queue<std::unique_ptr<uint8_t[]>> queue_;
-    mutable std::mutex mutex_;
-    std::condition_variable cond_;
+    bool isFinished();
+
+    // 当前排队的数据包数
+    int size();
 };
 
 #endif //ANDROIDPLAYER_PACKETQUEUE_H
@@ -0,0 +1,43 @@
+#ifndef ANDROIDPLAYER_PCMRING_H
+#define ANDROIDPLAYER_PCMRING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <vector>
+
+// 单生产者单消费者的 PCM 环形缓冲区，元素为交织的 int16 采样。
+// 解码线程写、音频回调读，两端都不加锁也不分配内存；读写位置单调递增，取模得到下标
+class PcmRing {
+public:
+    // 分配 capacity 个采样的空间并清空，只能在没有读写时调用
+    void reset(size_t capacity);
+
+    size_t capacity() const { return buffer.size(); }
+    size_t readable() const;
+    size_t writable() const;
+
+    // 自 reset 起累计写入和读出的采样数，clear() 丢弃的部分也计入读出
+    size_t totalWritten() const { return write_pos.load(std::memory_order_acquire); }
+    size_t totalRead() const { return read_pos.load(std::memory_order_acquire); }
+
+    // 生产者：返回写位置处连续可写的空间，contiguous 为采样数，可能因回绕小于 writable()
+    int16_t* writePointer(size_t* contiguous);
+    void commitWrite(size_t samples);
+
+    // 生产者：写入最多 samples 个采样，返回实际写入数
+    size_t write(const int16_t* data, size_t samples);
+
+    // 消费者：读出最多 samples 个采样，返回实际读出数
+    size_t read(int16_t* out, size_t samples);
+
+    // 消费者：丢弃所有未读数据
+    void clear();
+
+private:
+    std::vector<int16_t> buffer;
+    std::atomic<size_t> read_pos{0};
+    std::atomic<size_t> write_pos{0};
+};
+
+#endif //ANDROIDPLAYER_PCMRING_H
@@ -0,0 +1,91 @@
+#ifndef ANDROIDPLAYER_PLAYERSTATS_H
+#define ANDROIDPLAYER_PLAYERSTATS_H
+
+#include <stdint.h>
+#include <string>
+
+// 播放管线各阶段，每个阶段维护一个耗时直方图
+enum class Stage {
+    Demux,          // av_read_frame
+    QueueWait,      // 解码线程等待数据包
+    Decode,         // avcodec_send_packet + avcodec_receive_frame
+    Convert,        // 像素格式转换
+    Upload,         // 纹理上传
+    Swap,           // eglSwapBuffers
+    AudioCallback,  // AAudio 回调
+    FrameStep,      // 逐帧请求到上屏
+    Count,
+};
+
+// 累计计数
+enum class Counter {
+    PacketsRead,
+    FramesDecoded,
+    FramesRendered,
+    FramesDropped,
+    FramesLate,
+    AudioUnderruns,
+    Count,
+};
+
+// 瞬时值，记录最近一次的设置
+enum class Gauge {
+    VideoQueueDepth,
+    AudioQueueDepth,
+    AvDriftUs,      // 视频相对主时钟的偏差，正值表示视频落后
+    AudioLatencyUs, // 音频输出延迟，由 AAudio 时间戳估计
+    Count,
+};
+
+// 启动阶段。打开/探测/打开解码器/启动线程记录各自耗时，首帧解码与上屏记录距启动开始的时间
+enum class StartupPhase {
+    OpenInput,          // avformat_open_input
+    FindStreamInfo,     // avformat_find_stream_info
+    OpenAudioDecoder,
+    OpenVideoDecoder,
+    StartThreads,
+    FirstFrameDecoded,
+    FirstFrameRendered, // 即首帧时间（time to first frame）
+    Count,
+};
+
+// 管线统计。热路径上只做 relaxed 原子操作，snapshotJson 读取时不保证各项之间严格一致
+namespace PlayerStats {
+    // 单调时钟，微秒
+    int64_t nowUs();
+
+    void record(Stage stage, int64_t us);
+    void increment(Counter counter, uint64_t n = 1);
+    void setGauge(Gauge gauge, int64_t value);
+
+    // 清零所有统计，新会话开始时调用
+    void reset();
+
+    // 开始一次启动计时，清空上一次的启动数据
+    void beginStartup();
+    // 记录启动阶段耗时
+    void recordStartup(StartupPhase phase, int64_t us);
+    // 记录到达某个里程碑的时间（距 beginStartup），每次启动只记录第一次，返回是否为第一次
+    bool markStartup(StartupPhase phase);
+    // 启动各阶段数据的 JSON，未到达的阶段为 -1
+    std::string startupJson();
+
+    // 生成当前统计的 JSON 快照：各阶段的次数、平均/最大耗时与 p50/p90/p99，计数、瞬时值和启动耗时
+    std::string snapshotJson();
+
+    // 每 intervalMs 毫秒把快照写入日志，传0停止
+    void setDumpInterval(int intervalMs);
+}
+
+// 作用域计时，析构时把耗时记入对应阶段
+class ScopedStageTimer {
+public:
+    explicit ScopedStageTimer(Stage stage) : stage(stage), start(PlayerStats::nowUs()) {}
+    ~ScopedStageTimer() { PlayerStats::record(stage, PlayerStats::nowUs() - start); }
+
+private:
+    Stage stage;
+    int64_t start;
+};
+
+#endif //ANDROIDPLAYER_PLAYERSTATS_H
@@ -0,0 +1,93 @@
+#ifndef ANDROIDPLAYER_PRELOADMANAGER_H
+#define ANDROIDPLAYER_PRELOADMANAGER_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+}
+
+class FramePool;
+
+// 预加载完成的媒体：已打开的解封装和解码器、开头几秒的数据包，以及可选的已转换为渲染格式的首帧。
+// take 之后由调用方接管，调用方取走的字段置空即可，析构时释放其余资源
+struct PreloadedMedia {
+    std::string url;
+    AVFormatContext* fmt_ctx = nullptr;
+    AVCodecContext* video_ctx = nullptr;
+    AVCodecContext* audio_ctx = nullptr;
+    int video_stream_index = -1;
+    int audio_stream_index = -1;
+    std::deque<AVPacket*> packets;      // 按解封装顺序缓存的数据包，第一个视频包为关键帧
+    AVFrame* first_frame = nullptr;     // 渲染端格式的首帧，未开启预解码时为空
+    size_t bytes = 0;                   // 数据包与首帧占用的内存
+
+    ~PreloadedMedia();
+};
+
+// 短视频列表预加载。后台线程按顺序打开接下来的 N 个地址，读取开头几秒的数据包并打开解码器，
+// 可选地预先解码并转换首帧。所有条目共享一个内存预算，超出时按最近使用顺序淘汰。
+// 切到已预加载的条目时，播放端直接接管解码器和数据包，首帧可在下一次刷新时上屏
+class PreloadManager {
+public:
+    static const size_t DEFAULT_MEMORY_BUDGET = 64 * 1024 * 1024;
+    static constexpr double DEFAULT_PRELOAD_SECONDS = 3.0;
+
+    // sinkFormats 为渲染端接受的像素格式，以 AV_PIX_FMT_NONE 结尾；pool 为解码帧缓冲池，可为空
+    PreloadManager(FramePool* pool, const AVPixelFormat* sinkFormats);
+    ~PreloadManager();
+
+    // 设置接下来要播放的地址，靠前的优先加载；不在列表中的已加载条目保留到预算不足时淘汰
+    void preload(const std::vector<std::string>& urls);
+
+    // 取走已预加载的条目。条目正在加载时等待加载结束，waitPending 为 true 时还等待排队中的条目；
+    // 没有或加载失败时返回空
+    std::unique_ptr<PreloadedMedia> take(const std::string& url, bool waitPending = false);
+
+    void setMemoryBudget(size_t bytes);
+    // 每个条目缓存的时长（秒）与是否预解码首帧，对之后开始加载的条目生效
+    void setOptions(double seconds, bool decodeFirstFrame);
+
+    // 取消加载并释放所有条目
+    void clear();
+
+private:
+    enum class State { Pending, Loading, Ready };
+
+    struct Entry {
+        std::string url;
+        State state = State::Pending;
+        std::atomic<bool> cancelled{false};
+        std::unique_ptr<PreloadedMedia> media;
+    };
+
+    void workerLoop();
+    int load(Entry* entry, double seconds, bool withFirstFrame, size_t budget);
+    int decodeFirstFrame(PreloadedMedia* media);
+    void evictLocked();
+    static int interruptCallback(void* opaque);
+
+    FramePool* frame_pool;
+    const AVPixelFormat* sink_formats;
+
+    std::mutex mtx;
+    std::condition_variable cond;
+    std::list<std::shared_ptr<Entry>> entries;  // 最近使用的在前
+    size_t memory_budget = DEFAULT_MEMORY_BUDGET;
+    size_t used_bytes = 0;                      // 已加载完成的条目占用
+    size_t item_budget = DEFAULT_MEMORY_BUDGET; // 单个条目的上限，按预算与列表长度均分
+    double preload_seconds = DEFAULT_PRELOAD_SECONDS;
+    bool decode_first_frame = true;
+    bool running = true;
+    std::thread worker;
+};
+
+#endif //ANDROIDPLAYER_PRELOADMANAGER_H
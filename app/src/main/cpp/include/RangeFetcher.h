@@ -0,0 +1,78 @@
+#ifndef ANDROIDPLAYER_RANGEFETCHER_H
+#define ANDROIDPLAYER_RANGEFETCHER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <set>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+extern "C" {
+#include <libavformat/avio.h>
+}
+
+// 远程资源的并行分块下载。多个连接同时下载，每次请求都是有界的范围（Range: bytes=a-b），
+// 排队中相邻的块合成一次请求。连接保持 keep-alive，下一次请求直接在同一连接上发出：
+// FFmpeg 的 http 协议每次打开和跳转都会新建连接，复用连接的接口不公开，所以请求直接写在 FFmpeg 的 tcp/tls 连接上。
+// 分块传输等这里不处理的响应改用 FFmpeg 的 http 协议，用 offset/end_offset 限定同样的范围。
+// 优先级：当前读取位置所在块 > 固定请求（如文件尾的 moov）> 读取位置之后的预读窗口
+class RangeFetcher {
+public:
+    // 一块下载完成或失败时在下载线程上调用，len 为负时是 AVERROR 错误码
+    using Deliver = std::function<void(int64_t index, const uint8_t* data, int len)>;
+
+    // 连接在第一次请求时才建立，全部命中缓存时不产生网络请求
+    RangeFetcher(const std::string& url, int64_t size, int blockSize, int connections, Deliver deliver);
+    ~RangeFetcher();
+
+    // 请求当前读取位置所在块，排在所有请求之前
+    void fetchNow(int64_t index);
+
+    // 固定请求，不会被预读窗口替换
+    void fetchPinned(const std::vector<int64_t>& indices);
+
+    // 用新的预读窗口替换尚未开始的预读请求，读取位置跳转后旧窗口不再需要
+    void prefetch(const std::vector<int64_t>& indices);
+
+private:
+    struct Worker {
+        std::thread thread;
+        AVIOContext* io = nullptr;  // 保持的 tcp/tls 连接
+        std::string origin;         // io 连向的 tcp://host:port 或 tls://host:port
+        std::string received;       // 读响应头时多读到的响应体
+    };
+
+    void workerLoop(Worker* worker);
+    bool takeLocked(int64_t* first, int* count);
+    bool queuedLocked(int64_t index) const;
+    int fetchRun(Worker* worker, int64_t first, int count, uint8_t* buffer, int* done);
+    int request(Worker* worker, int64_t offset, int64_t end, bool* keepAlive);
+    int roundTrip(Worker* worker, const std::string& origin, const std::string& message, std::string* header);
+    int receive(Worker* worker, uint8_t* buf, int len);
+    int openHttp(AVIOContext** http, int64_t offset, int64_t end);
+    static void closeConnection(Worker* worker);
+    static int interruptCallback(void* opaque);
+
+    std::string url;
+    std::string location;           // 跟随重定向后的地址，受 mtx 保护
+    std::atomic<bool> ffmpeg_http{false};   // 源站的响应这里处理不了，之后都改用 FFmpeg 的 http 协议
+    int64_t size;
+    int block_size;
+    Deliver deliver;
+    AVIOInterruptCB interrupt;
+
+    std::mutex mtx;
+    std::condition_variable cond;
+    std::deque<int64_t> urgent;
+    std::deque<int64_t> pinned;
+    std::deque<int64_t> ahead;
+    std::set<int64_t> inflight;
+    bool stopping = false;
+    std::vector<Worker*> workers;
+};
+
+#endif //ANDROIDPLAYER_RANGEFETCHER_H
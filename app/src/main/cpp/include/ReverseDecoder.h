@@ -0,0 +1,98 @@
+#ifndef ANDROIDPLAYER_REVERSEDECODER_H
+#define ANDROIDPLAYER_REVERSEDECODER_H
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "FrameConverter.h"
+#include "FramePool.h"
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+// 倒放解码：从指定位置起按 GOP 倒序分段，每段从关键帧整段解码进帧缓存，调用方按时间戳从大到小取帧上屏。
+// 两个解码通道各有独立的解封装与解码器，一个通道解码的同时另一个预取更早的一段；
+// 段的分界在通道读到关键帧时立即公布，下一段不必等上一段解码完。
+// 缓存的帧已转换为渲染端格式（可缩小到显示尺寸），缓冲从 FramePool 分配。
+// 同时存在的段（正在上屏的一段与两个通道各一段）总大小按内存预算限制，单段帧数超过上限的长 GOP
+// 拆成多段，每段都从同一个关键帧解码、只保留各自范围内的帧，以重复解码换内存
+class ReverseDecoder {
+public:
+    static const size_t DEFAULT_MEMORY_BUDGET = 96 * 1024 * 1024;
+
+    ReverseDecoder(FramePool* pool, const AVPixelFormat* sinkFormats);
+    ~ReverseDecoder();
+
+    // 下一次 start 时生效
+    void setMemoryBudget(size_t bytes);
+
+    // 从 position（秒）之前的一帧开始倒放 url 的第 streamIndex 路视频，
+    // 输出尺寸为 width x height，传0表示原尺寸。成功返回0
+    int start(const std::string& url, int streamIndex, double position, int width, int height);
+
+    // 取下一帧（时间戳从大到小），需要时等待通道解码完成；到开头或 stop 之后返回 nullptr。
+    // 返回的帧由调用方 av_frame_free，best_effort_timestamp 为其时间戳
+    AVFrame* nextFrame();
+
+    // 停止通道线程并释放缓存的帧
+    void stop();
+
+    AVRational timeBase() const { return time_base; }
+
+private:
+    static const int LANES = 2;
+    static const int MIN_CHUNK_FRAMES = 4;
+
+    // 一段保留 [lo, hi) 内的帧；key 已知时（长 GOP 拆分出的更早一段）从该关键帧开始解码，
+    // 否则向前查找 hi 之前最近的关键帧
+    struct Plan {
+        int64_t hi;
+        int64_t key;
+    };
+    struct Lane {
+        AVFormatContext* fmt_ctx = nullptr;
+        AVCodecContext* codec_ctx = nullptr;
+        FrameConverter converter;
+        AVPacket* pkt = nullptr;
+        AVFrame* frame = nullptr;
+        std::thread thread;
+    };
+
+    static int interruptCallback(void* opaque);
+    int openLane(Lane* lane);
+    void closeLane(Lane* lane);
+    void laneLoop(Lane* lane, bool open);
+    int64_t seekKeyframe(Lane* lane, int64_t target);
+    void decodeChunk(Lane* lane, int seq, const Plan& plan, std::vector<AVFrame*>* frames);
+    void publish(int seq, const Plan* plan);
+    void releaseFrames();
+
+    FramePool* frame_pool;
+    const AVPixelFormat* sink_formats;
+    size_t budget;
+    Lane lanes[LANES];
+    std::string url;
+    int stream_index = -1;
+    AVRational time_base = {0, 1};
+    int64_t frame_duration = 1;     // 按帧率估计的一帧时长（time_base）
+    int chunk_frames = MIN_CHUNK_FRAMES;
+    int out_width = 0;
+    int out_height = 0;
+
+    std::mutex mtx;
+    std::condition_variable cond;
+    std::atomic<bool> running{false};
+    std::map<int, Plan> plans;                      // 已公布、还没有通道认领的段
+    std::map<int, std::vector<AVFrame*>> ready;     // 解码完成的段，帧按时间戳升序
+    std::vector<AVFrame*> presenting;               // 正在上屏的段中还没有取走的帧
+    int next_claim = 0;                             // 下一个要认领的段号
+    int present_seq = -1;                           // 正在上屏的段号
+    int end_seq = 0;                                // 段号到此为止（已到开头）
+};
+
+#endif //ANDROIDPLAYER_REVERSEDECODER_H
@@ -0,0 +1,66 @@
+#ifndef ANDROIDPLAYER_SAMPLECONVERT_H
+#define ANDROIDPLAYER_SAMPLECONVERT_H
+
+#include <stdint.h>
+
+// 常见音频输入到 S16 交织立体声的向量化转换，采样率与输出相同时代替 swresample：
+//  - fltp 立体声 -> s16：与 swr 逐位一致（lrintf 舍入、饱和到 int16）；超出 lrintf 范围的异常值按符号饱和
+//  - s16p 立体声 -> s16：只做交织
+//  - fltp 5.1/7.1 -> s16 立体声下混：系数同 swr 默认矩阵（中置、环绕 -3dB，丢弃 LFE，
+//    整数输出时归一化到不削波），累加顺序不同，误差不超过 1 LSB
+// x86 使用 SSE2，arm64 使用 NEON（armv7 的 NEON 没有就近舍入的转换指令，fltp 走标量），其余情况交给 swresample
+namespace SampleConvert {
+    enum Kernel {
+        KERNEL_NONE = 0,            // 没有对应的转换核，使用 swresample
+        KERNEL_FLTP_STEREO = 1,
+        KERNEL_S16P_STEREO = 2,
+        KERNEL_FLTP_DOWNMIX = 3,
+    };
+
+    // 一种输入格式对应的转换方式，输入格式变化时重新选择
+    struct Plan {
+        Kernel kernel = KERNEL_NONE;
+        int format = -1;            // AVSampleFormat
+        uint64_t channel_layout = 0;
+        int channels = 0;
+        int sample_rate = 0;
+        int out_sample_rate = 0;
+        // 下混：左声道为 left[i] 乘 gain[i] 之和，右声道同理
+        int taps = 0;
+        int left[4] = {};
+        int right[4] = {};
+        float gain[4] = {};
+
+        bool matches(int fmt, uint64_t layout, int ch, int rate, int outRate) const {
+            return fmt == format && layout == channel_layout && ch == channels
+                   && rate == sample_rate && outRate == out_sample_rate;
+        }
+    };
+
+    // 声道布局为0（部分流不带布局）时按声道数取默认布局
+    uint64_t layoutOf(uint64_t channelLayout, int channels);
+
+    // 按输入格式选择转换核，采样率不同或没有对应的核时 kernel 为 KERNEL_NONE
+    Plan choose(int format, uint64_t channelLayout, int channels, int sampleRate, int outSampleRate);
+
+    // 转换 in 各声道平面中从 offset 帧开始的 frames 帧，输出交织立体声到 out
+    void run(const Plan& plan, const uint8_t* const* in, int offset, int16_t* out, int frames);
+
+    enum BenchmarkCase {
+        BENCH_FLTP_STEREO = 0,
+        BENCH_S16P_STEREO = 1,
+        BENCH_DOWNMIX_5_1 = 2,
+        BENCH_DOWNMIX_7_1 = 3,
+    };
+
+    struct BenchmarkResult {
+        double fastNsPerFrame;
+        double swrNsPerFrame;
+        int maxDiff;                // 与 swr 输出的最大差值（LSB）
+    };
+
+    // 用合成信号分别以转换核和 swr 转换 frames 帧，比较输出并统计每帧耗时。成功返回0
+    int benchmark(BenchmarkCase benchCase, int frames, BenchmarkResult* result);
+}
+
+#endif //ANDROIDPLAYER_SAMPLECONVERT_H
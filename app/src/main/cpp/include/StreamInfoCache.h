@@ -0,0 +1,28 @@
+#ifndef ANDROIDPLAYER_STREAMINFOCACHE_H
+#define ANDROIDPLAYER_STREAMINFOCACHE_H
+
+#include <stdint.h>
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+// 流信息磁盘缓存。以路径+文件大小+修改时间（远程地址以 URL+资源大小）为键，
+// 保存各流的编码参数、extradata、时长和上次播放位置。再次打开同一内容时用缓存填充流信息，
+// 跳过 avformat_find_stream_info，并从上次位置继续播放。
+// 每个条目一个文件，文件名为键的 FNV-1a 哈希；内容只在本机读写，按本机字节序存放
+namespace StreamInfoCache {
+    // 设置缓存目录（如 Context.getCacheDir()），未设置时缓存不生效
+    void setDirectory(const char* dir);
+
+    // 用缓存填充 avformat_open_input 之后的 fmt_ctx。流的数量和编码器与缓存一致时返回 true，
+    // 调用方可跳过 avformat_find_stream_info；lastPosition 返回上次播放位置（秒），没有时为 0
+    bool load(const char* url, AVFormatContext* fmt_ctx, double* lastPosition);
+
+    // 保存 avformat_find_stream_info 之后的流信息，保留已有条目中的播放位置
+    void save(const char* url, AVFormatContext* fmt_ctx);
+
+    // 更新条目中的播放位置（秒），条目不存在时忽略
+    void savePosition(const char* url, double position);
+}
+
+#endif //ANDROIDPLAYER_STREAMINFOCACHE_H
@@ -0,0 +1,76 @@
+#ifndef ANDROIDPLAYER_TRACE_H
+#define ANDROIDPLAYER_TRACE_H
+
+#include <stdint.h>
+#include <atomic>
+
+// Chrome trace event 格式的事件追踪。每个线程写自己的无锁环形缓冲区，保留最近的事件，
+// dump 时合并输出为 JSON，可直接在 chrome://tracing 或 Perfetto 中打开。
+// 未启用时每个事件只有一次 relaxed 原子读取的开销
+namespace Trace {
+    // 事件类型，取值即 trace event 的 ph 字段
+    enum Phase : char {
+        Begin = 'B',
+        End = 'E',
+        AsyncBegin = 'b',
+        AsyncEnd = 'e',
+        Instant = 'i',
+    };
+
+    extern std::atomic<bool> enabled;
+
+    // 开始记录，清空之前的事件。同时预先分配若干线程缓冲区，音频回调等线程第一次写事件时直接取用，
+    // 不在实时线程上分配内存或加锁
+    void start();
+    void stop();
+
+    // 记录一个事件，name 必须是字符串字面量等生命周期覆盖整个进程的字符串。
+    // 异步事件以 id 关联（例如帧的 PTS），可跨线程配对
+    void event(Phase phase, const char* name, int64_t id = 0);
+
+    // 把所有线程的事件写成 Chrome JSON trace 文件，成功返回0
+    int dump(const char* path);
+
+    inline bool isEnabled() {
+        return enabled.load(std::memory_order_relaxed);
+    }
+}
+
+// 作用域事件，构造时记 Begin，析构时记 End
+class TraceScope {
+public:
+    explicit TraceScope(const char* name) : name(Trace::isEnabled() ? name : nullptr) {
+        if (this->name) {
+            Trace::event(Trace::Begin, this->name);
+        }
+    }
+    ~TraceScope() {
+        if (name) {
+            Trace::event(Trace::End, name);
+        }
+    }
+
+private:
+    const char* name;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+
+#define TRACE_ASYNC_BEGIN(name, id)                                 \
+    do {                                                            \
+        if (Trace::isEnabled()) Trace::event(Trace::AsyncBegin, (name), (id)); \
+    } while (0)
+
+#define TRACE_ASYNC_END(name, id)                                   \
+    do {                                                            \
+        if (Trace::isEnabled()) Trace::event(Trace::AsyncEnd, (name), (id)); \
+    } while (0)
+
+#define TRACE_INSTANT(name)                                         \
+    do {                                                            \
+        if (Trace::isEnabled()) Trace::event(Trace::Instant, (name)); \
+    } while (0)
+
+#endif //ANDROIDPLAYER_TRACE_H
@@ -0,0 +1,48 @@
+#ifndef ANDROIDPLAYER_TRACKSELECTOR_H
+#define ANDROIDPLAYER_TRACKSELECTOR_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+// 轨道选择：列出媒体中的流，按进程级的偏好（语言、编码、码率上限）为每种类型选出一路，
+// 并把没有选中的流在解封装层设为 AVDISCARD_ALL，多音轨的 mkv/ts 不再解析和拷贝用不到的数据包。
+// 偏好对之后打开的媒体（包括预加载和播放列表的下一项）生效
+namespace TrackSelector {
+    struct Track {
+        int index;
+        int type;               // AVMediaType
+        std::string language;   // 元数据中的 language，没有时为空
+        std::string codec;
+        int64_t bitrate;        // 未知时为0
+        int channels;
+        int sampleRate;
+        int width;
+        int height;
+        bool isDefault;
+    };
+
+    struct Preference {
+        std::string language;   // 不区分大小写，"en" 也匹配 "eng"
+        std::string codec;      // avcodec_get_name 的名称，如 "aac"、"hevc"
+        int64_t maxBitrate = 0; // 大于0时优先选不超过该码率的流
+    };
+
+    // 设置 type 类型的偏好，空的偏好表示按默认规则选择
+    void setPreference(AVMediaType type, const Preference& preference);
+
+    // 列出全部流，封面图片（attached pic）不计入视频
+    std::vector<Track> list(AVFormatContext* ctx);
+
+    // 按偏好选择 type 类型的流：能解码 > 语言 > 编码 > 码率上限 > 默认标记 > 码率/分辨率/声道数，
+    // 没有可用的流时返回 AVERROR_STREAM_NOT_FOUND
+    int choose(AVFormatContext* ctx, AVMediaType type);
+
+    // 只保留 videoIndex 与 audioIndex 两路，其余流全部丢弃；参数为 -1 时该类型也不读取
+    void applyDiscard(AVFormatContext* ctx, int videoIndex, int audioIndex);
+}
+
+#endif //ANDROIDPLAYER_TRACKSELECTOR_H
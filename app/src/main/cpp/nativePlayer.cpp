@@ -1,20 +1,40 @@
 #include <jni.h>
 #include <string>
-#include <android/log.h>
+#include "Log.h"
 #include <android/native_window.h>
 #include <android/native_window_jni.h>
 #include <thread>
 #include <aaudio/AAudio.h>
 #include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <vector>
 #include <mutex>
 #include <condition_variable>
 #include <queue>
+#include <deque>
+#include <atomic>
 
 #include "PacketQueue.h"
 #include "OpenGLRenderer.h"
-#include "AAudioRender.h"
+#include "AudioMixer.h"
+#include "AudioDsp.h"
+#include "FrameConverter.h"
+#include "FramePool.h"
+#include "PlayerStats.h"
+#include "Trace.h"
+#include "StreamInfoCache.h"
+#include "EventQueue.h"
+#include "PreloadManager.h"
+#include "AudioCrossfade.h"
+#include "FileIO.h"
+#include "PcmRing.h"
+#include "BlockCache.h"
+#include "AudioClock.h"
+#include "SampleConvert.h"
+#include "TrackSelector.h"
+#include "ReverseDecoder.h"
+#include "FrameHistory.h"
 
 extern "C" {
 #include <libavcodec/avcodec.h>
@@ -31,8 +51,6 @@ extern "C" {
 
 
 #define LOG_TAG "NativePlayer"
-#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
-#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
 
 // 全局变量
 static AVFormatContext* fmt_ctx;
@@ -41,16 +59,313 @@ static AVCodecContext* codec_ctx_audio = nullptr; // 音频解码上下文
 static int video_stream_index = -1;
 static int audio_stream_index = -1;
 static ANativeWindow* native_window = nullptr;
+static OpenGLRenderer renderer; // 跨播放会话常驻，EGL 上下文与着色器只创建一次
 static PacketQueue packetQueue_video; // 视频队列
 static PacketQueue packetQueue_audio; // 音频队列
 //static PacketQueue packetQueue_PCM; // 音频帧队列
 std::atomic<bool> isPaused(false); // 暂停控制
 std::atomic<bool> isStopped(false); // 停止控制
 std::atomic<float> playbackSpeed(1.0f); // 播放速度控制
-SwsContext *sws_ctx;
 SwrContext *swr_ctx;
-SafeQueue safeQueue;  // 音频帧队列
+static PcmRing pcmRing;  // 解码后的 PCM，解码线程写、音频回调读
+static std::atomic<int> audio_source(-1); // 在进程混音器中的来源编号，混音器的输出流取设备原生采样率
+static std::atomic<float> audio_volume(1.0f);
+static AudioDsp audioDsp; // 重采样之后、写入 pcmRing 之前的增益/均衡/限幅，设置来自 UI 线程
+static std::atomic<int> audio_output_rate(0); // 音频流协商得到的采样率，解码线程按此重采样
+static AudioClock audioClock; // 扣除输出延迟后真正被听到的音频时间，有音频时作为视频同步的主时钟
+static const size_t AUDIO_RING_SAMPLES = 48000;  // 环形缓冲区容量，48kHz 立体声约 0.5 秒
 double duration;
+// 目标窗口尺寸，由 Java 层 surfaceChanged 通知，generation 变化时解码线程重新协商输出尺寸
+static std::atomic<int> surface_width(0);
+static std::atomic<int> surface_height(0);
+static std::atomic<int> surface_generation(0);
+// 后台模式：窗口销毁后解封装丢弃视频流、视频线程不再解码和渲染，只播放音频。
+// native_window 的更换与渲染在 window_mutex 内进行，window_generation 变化时解码线程重新绑定窗口
+static std::mutex window_mutex;
+static std::atomic<bool> video_detached(false);
+static std::atomic<int> window_generation(0);
+// UI 线程请求切换到的音轨，由读线程执行
+static std::atomic<int> requested_audio_stream(-1);
+// 视频帧缓冲池，解码、转换、渲染共用，跨seek和跨会话复用
+static FramePool framePool;
+// 快速起播：限制探测量、并行打开解码器、首帧解码后立即上屏
+static std::atomic<bool> fastStart(false);
+static const char* FAST_START_PROBESIZE = "524288";        // 字节
+static const char* FAST_START_ANALYZEDURATION = "500000";  // 微秒
+// 最近一帧上屏的位置（秒），与当前地址一起用于在流信息缓存中记录续播位置
+static std::atomic<double> playback_position(0);
+// UI 线程查询的媒体信息快照。fmt_ctx 只在打开它的线程和读线程上访问（播放列表切换时读线程会替换并释放它），
+// 每次更换 fmt_ctx 或切换音轨后在该线程上重建快照，JNI 的查询只读快照
+struct MediaSnapshot {
+    bool valid = false;
+    int width = 0;
+    int height = 0;
+    std::string videoCodec;
+    int sampleRate = 0;
+    int channels = 0;
+    std::string audioCodec = "none";
+    double duration = 0;
+    int videoIndex = -1;
+    int audioIndex = -1;
+    std::vector<TrackSelector::Track> tracks;
+};
+static std::mutex snapshot_mutex;
+static MediaSnapshot mediaSnapshot;
+// 异步准备：工作线程、取消标志、是否已准备完成待 nativeStart，以及向 Java 投递事件的队列
+static std::thread prepareThread;
+static std::atomic<bool> prepareCancelled(false);
+static std::atomic<bool> mediaPrepared(false);
+static EventQueue eventQueue;
+// 预加载条目的首帧（渲染端格式），由解码线程在第一次渲染前上屏
+static AVFrame* preloadedFirstFrame = nullptr;
+
+// OpenGL 渲染端可直接接受的像素格式，YUV420P 在着色器中转换，上传量只有 RGBA 的 3/8
+static const AVPixelFormat glSinkFormats[] = {AV_PIX_FMT_YUV420P, AV_PIX_FMT_RGBA, AV_PIX_FMT_NONE};
+
+// 短视频列表预加载，解码帧与播放共用缓冲池
+static PreloadManager preloadManager(&framePool, glSinkFormats);
+
+// 倒放：另开解码通道按 GOP 倒序解码，由视频解码线程倒序上屏；期间正向的数据包不消费，音频暂停
+static ReverseDecoder reverseDecoder(&framePool, glSinkFormats);
+static std::atomic<bool> reverse_requested(false);
+static std::atomic<bool> reverse_reduced(false);  // 倒放缓存总是缩小到显示尺寸
+// 读线程与视频解码线程是否在运行；读线程读完后等到视频解码线程结束，以便倒放结束后跳转
+static std::atomic<bool> reading(false);
+static std::atomic<bool> videoDecoding(false);
+// 读线程与两个解码线程，由 nativeStop 等待退出
+static std::thread readWorker;
+static std::thread videoWorker;
+static std::thread audioWorker;
+// 请求读线程跳转到的位置（微秒），AV_NOPTS_VALUE 表示没有
+static std::atomic<int64_t> requested_seek_us(AV_NOPTS_VALUE);
+// 跳转来自 nativeSeek 而不是逐帧后退，解码线程据此放弃未完成的预解码
+static std::atomic<bool> user_seek(false);
+
+// 逐帧：暂停时按请求前进或后退一帧。后退先在最近上屏的帧里找，超出范围时跳转到之前的关键帧，
+// 预解码到目标帧再上屏；历史缓存只在视频解码线程上访问
+static FrameHistory frameHistory(&framePool);
+static std::atomic<int> pending_steps(0);        // 待处理的逐帧请求，正数前进、负数后退
+static std::atomic<int64_t> step_request_us(0);  // 最近一次逐帧请求的时刻，统计逐帧延迟
+static std::atomic<bool> stepped(false);         // 逐帧后到恢复播放前，进度取最近上屏的一帧
+
+// AVIOInterruptCB 回调，取消准备时让阻塞中的读取和探测尽快返回
+static int prepareInterrupt(void* opaque) {
+    return prepareCancelled ? 1 : 0;
+}
+
+// 播放列表：当前项播放时预先打开下一项，读到结尾后解封装与解码无缝接续，EGL 与音频输出不重建
+static std::mutex playlist_mutex;
+static std::vector<std::string> playlist;
+static size_t playlist_index = 0;
+// 当前播放的地址，读线程切到下一项时更新，由 playlist_mutex 保护，其他线程通过 currentUrl 取副本
+static std::string current_url;
+static std::atomic<int> crossfade_ms(0);
+// 读线程切到下一项或切换音轨后交给解码线程的解码器，解码线程读到对应序号的数据包时换用
+struct Segment {
+    int serial;
+    AVCodecContext* ctx;
+    AVRational time_base;
+    bool flush;     // 切换音轨：丢弃旧解码器中的数据，而不是冲出后交叉淡化；ctx 为空时表示跳转，只清空解码器
+};
+static std::mutex segment_mutex;
+static std::deque<Segment> videoSegments;
+static std::deque<Segment> audioSegments;
+static std::atomic<bool> audioDecoding(false);
+
+// 取出序号为 serial 的片段，没有时 ctx 为空
+static Segment takeSegment(std::deque<Segment>& segments, int serial) {
+    std::lock_guard<std::mutex> lock(segment_mutex);
+    for (auto it = segments.begin(); it != segments.end(); ++it) {
+        if (it->serial == serial) {
+            Segment segment = *it;
+            segments.erase(it);
+            return segment;
+        }
+    }
+    return {serial, nullptr, {0, 1}, false};
+}
+
+// 释放尚未被解码线程接管的片段
+static void releaseSegments(std::deque<Segment>& segments) {
+    std::lock_guard<std::mutex> lock(segment_mutex);
+    for (Segment& segment : segments) {
+        avcodec_free_context(&segment.ctx);
+    }
+    segments.clear();
+}
+
+static std::string currentUrl() {
+    std::lock_guard<std::mutex> lock(playlist_mutex);
+    return current_url;
+}
+
+// 在后台预先打开播放列表中的下一项
+static void preloadNextItem() {
+    std::lock_guard<std::mutex> lock(playlist_mutex);
+    if (playlist_index + 1 < playlist.size()) {
+        preloadManager.preload({playlist[playlist_index + 1]});
+    }
+}
+
+// 当前项读完后切到播放列表的下一项：接管已预先打开的解封装和解码器，新的数据包使用新的序号。
+// 没有下一项或打开失败时返回 false
+// 在持有 fmt_ctx 的线程上重建媒体信息快照
+static void publishMediaSnapshot() {
+    MediaSnapshot snapshot;
+    AVCodecParameters* video = fmt_ctx->streams[video_stream_index]->codecpar;
+    AVCodecParameters* audio = audio_stream_index >= 0 ? fmt_ctx->streams[audio_stream_index]->codecpar : nullptr;
+    snapshot.valid = true;
+    snapshot.width = video->width;
+    snapshot.height = video->height;
+    snapshot.videoCodec = avcodec_get_name(video->codec_id);
+    if (audio) {
+        snapshot.sampleRate = audio->sample_rate;
+        snapshot.channels = audio->channels;
+        snapshot.audioCodec = avcodec_get_name(audio->codec_id);
+    }
+    snapshot.duration = duration;
+    snapshot.videoIndex = video_stream_index;
+    snapshot.audioIndex = audio_stream_index;
+    snapshot.tracks = TrackSelector::list(fmt_ctx);
+    std::lock_guard<std::mutex> lock(snapshot_mutex);
+    mediaSnapshot = std::move(snapshot);
+}
+
+// 关闭 fmt_ctx 时让快照失效，时长保留到下一次打开
+static void clearMediaSnapshot() {
+    std::lock_guard<std::mutex> lock(snapshot_mutex);
+    mediaSnapshot.valid = false;
+    mediaSnapshot.tracks.clear();
+}
+
+static MediaSnapshot currentMediaSnapshot() {
+    std::lock_guard<std::mutex> lock(snapshot_mutex);
+    return mediaSnapshot;
+}
+
+static bool advancePlaylist() {
+    std::string next_url;
+    size_t next_index;
+    {
+        std::lock_guard<std::mutex> lock(playlist_mutex);
+        if (playlist_index + 1 >= playlist.size()) {
+            return false;
+        }
+        next_index = playlist_index + 1;
+        next_url = playlist[next_index];
+    }
+    // 正常情况下已经预加载完成；还没开始时让它排到最前并等待
+    preloadManager.preload({next_url});
+    std::unique_ptr<PreloadedMedia> next = preloadManager.take(next_url, true);
+    if (!next || isStopped) {
+        LOGE("无法打开播放列表下一项：%s", next_url.c_str());
+        return false;
+    }
+
+    // 切换音轨会单独推进音频队列的序号，两个队列的序号不一定相同
+    int serial = packetQueue_video.nextSerial();
+    int audio_serial = packetQueue_audio.nextSerial();
+    {
+        std::lock_guard<std::mutex> lock(segment_mutex);
+        videoSegments.push_back({serial, next->video_ctx,
+                                 next->fmt_ctx->streams[next->video_stream_index]->time_base, false});
+        if (audioDecoding && next->audio_ctx) {
+            audioSegments.push_back({audio_serial, next->audio_ctx,
+                                     next->fmt_ctx->streams[next->audio_stream_index]->time_base, false});
+        } else {
+            avcodec_free_context(&next->audio_ctx);
+        }
+    }
+    next->video_ctx = nullptr;
+    next->audio_ctx = nullptr;
+
+    AVFormatContext* old_fmt_ctx = fmt_ctx;
+    fmt_ctx = next->fmt_ctx;
+    next->fmt_ctx = nullptr;
+    fmt_ctx->interrupt_callback.callback = prepareInterrupt;
+    fmt_ctx->interrupt_callback.opaque = nullptr;
+    video_stream_index = next->video_stream_index;
+    audio_stream_index = next->audio_stream_index;
+    duration = fmt_ctx->duration / (double)AV_TIME_BASE;
+    // 按上一项的轨道列表发出的切换请求不适用于新的一项
+    requested_audio_stream = -1;
+    publishMediaSnapshot();
+    FileIO::closeInput(&old_fmt_ctx);
+
+    StreamInfoCache::savePosition(currentUrl().c_str(), playback_position);
+    for (AVPacket* pkt : next->packets) {
+        if (pkt->stream_index == video_stream_index) {
+            packetQueue_video.push(pkt);
+        } else {
+            packetQueue_audio.push(pkt);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(playlist_mutex);
+        playlist_index = next_index;
+        current_url = next_url;
+    }
+    LOGI("播放列表切换到第 %zu 项：%s", next_index, next_url.c_str());
+    eventQueue.post(EVENT_PLAYLIST_ITEM, (int)next_index);
+    preloadNextItem();
+    return true;
+}
+
+static AVCodecContext* openAudioDecoder(AVCodecParameters* parameters, bool startup = true);
+
+// 读线程上切换音轨：新音轨的解码器经 Segment 交给解码线程，只清空音频队列，视频队列和解码器不受影响。
+// 新音轨从环形缓冲区写位置对应的媒体时间接上，解封装回退到该时间之前的关键帧重新读取；
+// resumePts 返回新音轨中开始入队的时间戳，回退失败时为 AV_NOPTS_VALUE
+static bool switchAudioTrack(int index, int64_t* resumePts) {
+    if (index >= (int)fmt_ctx->nb_streams || fmt_ctx->streams[index]->codecpar->codec_type != AVMEDIA_TYPE_AUDIO) {
+        return false;
+    }
+    AVStream* st = fmt_ctx->streams[index];
+    AVCodecContext* ctx = openAudioDecoder(st->codecpar, false);
+    if (!ctx) {
+        return false;
+    }
+    double position = audioClock.mediaTimeAt((int64_t)(pcmRing.totalWritten() / 2));
+    if (std::isnan(position)) {
+        position = playback_position;
+    }
+    int serial = packetQueue_audio.nextSerial();
+    packetQueue_audio.flush();
+    {
+        std::lock_guard<std::mutex> lock(segment_mutex);
+        audioSegments.push_back({serial, ctx, st->time_base, true});
+    }
+    audio_stream_index = index;
+    publishMediaSnapshot();
+    int64_t target_ts = (int64_t)(position * AV_TIME_BASE);
+    *resumePts = AV_NOPTS_VALUE;
+    if (av_seek_frame(fmt_ctx, -1, target_ts, AVSEEK_FLAG_BACKWARD) >= 0) {
+        *resumePts = av_rescale_q(target_ts, AV_TIME_BASE_Q, st->time_base);
+    } else {
+        LOGW("切换音轨时回退失败，新音轨从当前读取位置开始");
+    }
+    LOGI("切换到音轨 %d：%.3f 秒", index, position);
+    return true;
+}
+
+// 读线程上跳转：清空两个队列，解码线程读到新序号的数据包时清空解码器，音频同时丢弃环形缓冲区中的旧数据。
+// 跳转失败时同样推进序号，等待新序号的解码线程不会卡住
+static void seekReader(int64_t target_us) {
+    if (av_seek_frame(fmt_ctx, -1, target_us, AVSEEK_FLAG_BACKWARD) < 0) {
+        LOGW("跳转失败：%.3f 秒", target_us / (double)AV_TIME_BASE);
+    }
+    packetQueue_video.setFinished(false);
+    packetQueue_audio.setFinished(false);
+    int video_serial = packetQueue_video.nextSerial();
+    packetQueue_video.flush();
+    int audio_serial = packetQueue_audio.nextSerial();
+    packetQueue_audio.flush();
+    std::lock_guard<std::mutex> lock(segment_mutex);
+    videoSegments.push_back({video_serial, nullptr, {0, 1}, true});
+    if (audioDecoding) {
+        audioSegments.push_back({audio_serial, nullptr, {0, 1}, true});
+    }
+}
 
 // 读数据包线程
 void readThread(const char* input_file) {
@@ -61,338 +376,1603 @@ void readThread(const char* input_file) {
         packetQueue_audio.setFinished(true);
         return;
     }
-    while (av_read_frame(fmt_ctx, pkt) >= 0) {
+    AVFormatContext* discard_ctx = nullptr;    // 已设置过 discard 的上下文，播放列表切换后重新设置
+    int discard_video = -1;
+    int discard_audio = -1;
+    int64_t last_video_dts = AV_NOPTS_VALUE;   // 最后入队的视频数据包，切换音轨回退后跳过已入队的部分
+    bool skip_video = false;
+    int64_t audio_resume_pts = AV_NOPTS_VALUE; // 切换音轨后新音轨从这里开始入队
+    while (!isStopped) {
+        int64_t seek_us = requested_seek_us.exchange(AV_NOPTS_VALUE);
+        if (seek_us != AV_NOPTS_VALUE) {
+            seekReader(seek_us);
+            last_video_dts = AV_NOPTS_VALUE;
+            skip_video = false;
+            // 音频从跳转位置开始送出，而不是从之前的关键帧开始
+            audio_resume_pts = audio_stream_index >= 0
+                    ? av_rescale_q(seek_us, AV_TIME_BASE_Q, fmt_ctx->streams[audio_stream_index]->time_base)
+                    : AV_NOPTS_VALUE;
+        }
+        int requested = requested_audio_stream.exchange(-1);
+        if (requested >= 0 && requested != audio_stream_index && switchAudioTrack(requested, &audio_resume_pts)) {
+            skip_video = audio_resume_pts != AV_NOPTS_VALUE && last_video_dts != AV_NOPTS_VALUE;
+        }
+        // 只读取选中的两路；后台时视频也在解封装层跳过（mp4 等不读取视频样本），没有音频输出时跳过音频
+        int video = video_detached ? -1 : video_stream_index;
+        int audio = audio_output_rate > 0 ? audio_stream_index : -1;
+        if (fmt_ctx != discard_ctx || video != discard_video || audio != discard_audio) {
+            TrackSelector::applyDiscard(fmt_ctx, video, audio);
+            discard_ctx = fmt_ctx;
+            discard_video = video;
+            discard_audio = audio;
+        }
+        int64_t read_start = PlayerStats::nowUs();
+        int ret;
+        {
+            TRACE_SCOPE("av_read_frame");
+            ret = av_read_frame(fmt_ctx, pkt);
+        }
+        if (ret < 0) {
+            // 播放列表还有下一项时接着读下一项
+            if (ret == AVERROR_EOF && !isStopped && advancePlaylist()) {
+                last_video_dts = AV_NOPTS_VALUE;
+                skip_video = false;
+                audio_resume_pts = AV_NOPTS_VALUE;
+                continue;
+            }
+            // 读完后等视频解码线程结束；期间有跳转请求（倒放结束后恢复正向播放）时从新位置接着读
+            packetQueue_video.setFinished(true);
+            packetQueue_audio.setFinished(true);
+            while (!isStopped && videoDecoding && requested_seek_us == AV_NOPTS_VALUE) {
+                av_usleep(10000);
+            }
+            if (isStopped || requested_seek_us == AV_NOPTS_VALUE) {
+                break;
+            }
+            continue;
+        }
+        PlayerStats::record(Stage::Demux, PlayerStats::nowUs() - read_start);
+        PlayerStats::increment(Counter::PacketsRead);
         if (pkt->stream_index == video_stream_index) {
+            int64_t dts = pkt->dts != AV_NOPTS_VALUE ? pkt->dts : pkt->pts;
+            if (skip_video) {
+                // 回退后重新读到的视频已经在队列中
+                if (dts == AV_NOPTS_VALUE || dts <= last_video_dts) {
+                    av_packet_unref(pkt);
+                    continue;
+                }
+                skip_video = false;
+            }
+            if (dts != AV_NOPTS_VALUE) {
+                last_video_dts = dts;
+            }
+            // 以 PTS 关联一帧从解封装到上屏的全过程
+            TRACE_ASYNC_BEGIN("frame", pkt->pts);
             packetQueue_video.push(pkt);
+            PlayerStats::setGauge(Gauge::VideoQueueDepth, packetQueue_video.size());
         } else if (pkt->stream_index == audio_stream_index) {
+            if (audio_resume_pts != AV_NOPTS_VALUE) {
+                // 新音轨在已经写入环形缓冲区的时间之前的部分不再送出
+                if (pkt->pts != AV_NOPTS_VALUE && pkt->pts + pkt->duration <= audio_resume_pts) {
+                    av_packet_unref(pkt);
+                    continue;
+                }
+                audio_resume_pts = AV_NOPTS_VALUE;
+            }
             packetQueue_audio.push(pkt);
+            PlayerStats::setGauge(Gauge::AudioQueueDepth, packetQueue_audio.size());
         }
         av_packet_unref(pkt);
     }
     packetQueue_video.setFinished(true); // 设置视频队列为完成状态
     packetQueue_audio.setFinished(true); // 设置音频队列为完成状态
     av_packet_free(&pkt);
+    reading = false;
+}
+
+// 将视频按比例放入窗口，结果不超过视频本身的尺寸，并取偶数便于 YUV420P 色度对齐
+static void fitToSurface(int videoWidth, int videoHeight, int surfaceWidth, int surfaceHeight,
+                         int* outWidth, int* outHeight) {
+    *outWidth = videoWidth;
+    *outHeight = videoHeight;
+    if (surfaceWidth <= 0 || surfaceHeight <= 0
+        || (surfaceWidth >= videoWidth && surfaceHeight >= videoHeight)) {
+        return;
+    }
+    double scale = std::min(surfaceWidth / (double)videoWidth, surfaceHeight / (double)videoHeight);
+    *outWidth = std::max(2, (int)(videoWidth * scale) & ~1);
+    *outHeight = std::max(2, (int)(videoHeight * scale) & ~1);
+}
+
+// 选择 lowres 级别：解码器支持时，在缩小后仍不小于窗口的前提下取最大的级别
+static int chooseLowres(const AVCodec* codec, int videoWidth, int videoHeight) {
+    int surfaceWidth = surface_width;
+    int surfaceHeight = surface_height;
+    if (surfaceWidth <= 0 || surfaceHeight <= 0) {
+        return 0;
+    }
+    int lowres = 0;
+    while (lowres < codec->max_lowres
+           && (videoWidth >> (lowres + 1)) >= surfaceWidth
+           && (videoHeight >> (lowres + 1)) >= surfaceHeight) {
+        lowres++;
+    }
+    return lowres;
+}
+
+// 按当前窗口尺寸调整输出：窗口缓冲区与视口取视频放入窗口后的尺寸；
+// 缩小到一半以下时在转换阶段缩放以减少上传量，否则保持原尺寸上传，由着色器采样时缩放
+static void applySurfaceSize(FrameConverter* converter, int frameWidth, int frameHeight) {
+    int displayWidth, displayHeight;
+    fitToSurface(frameWidth, frameHeight, surface_width, surface_height, &displayWidth, &displayHeight);
+    ANativeWindow_setBuffersGeometry(native_window, displayWidth, displayHeight, WINDOW_FORMAT_RGBA_8888);
+    renderer.resizeViewport(displayWidth, displayHeight);
+    if (displayWidth * 2 <= frameWidth) {
+        converter->setOutputSize(displayWidth, displayHeight);
+    } else {
+        converter->setOutputSize(0, 0);
+    }
+    LOGI("窗口尺寸：%dx%d，显示尺寸：%dx%d", surface_width.load(), surface_height.load(),
+         displayWidth, displayHeight);
+}
+
+// 按帧格式上屏，格式须为 glSinkFormats 之一
+static void renderOutputFrame(const AVFrame* out_frame) {
+    if (out_frame->format == AV_PIX_FMT_YUV420P) {
+        renderer.renderFrameYUV420P(out_frame->data, out_frame->linesize, out_frame->width, out_frame->height);
+    } else {
+        renderer.renderFrame(out_frame->data[0], out_frame->width, out_frame->height);
+    }
+}
+
+// 更换 native_window（nullptr 为释放旧窗口），调用方持有 window_mutex；解码线程在 window_generation 变化时重新绑定
+static void replaceWindowLocked(ANativeWindow* window) {
+    if (native_window) {
+        ANativeWindow_release(native_window);
+    }
+    native_window = window;
+    window_generation++;
+}
+
+// 视频解码线程退出前释放会话资源。线程启动后视频解码器、解封装上下文与窗口都归它释放；
+// 读线程读完后在等本线程结束，先让它退出再关闭解封装上下文
+static void closeVideoSession() {
+    videoDecoding = false;
+    while (reading) {
+        av_usleep(1000);
+    }
+    releaseSegments(videoSegments);
+    avcodec_free_context(&codec_ctx_video);
+    clearMediaSnapshot();
+    FileIO::closeInput(&fmt_ctx);
+    std::lock_guard<std::mutex> lock(window_mutex);
+    replaceWindowLocked(nullptr);
 }
 
 // 解码线程
 void decodeVideo() {
     AVFrame* frame = av_frame_alloc();
-    AVFrame* rgb_frame = av_frame_alloc();
-    if (!frame || !rgb_frame) {
+    if (!frame) {
+        closeVideoSession();
         return;
     }
 
-    // 初始化SWS上下文
-    sws_ctx = sws_getContext(codec_ctx_video->width, codec_ctx_video->height, codec_ctx_video->pix_fmt,
-                                         codec_ctx_video->width, codec_ctx_video->height, AV_PIX_FMT_RGBA,
-                                         SWS_BILINEAR, nullptr, nullptr, nullptr);
-    if (!sws_ctx) {
+    // 协商输出像素格式，解码格式被渲染端接受时不做转换
+    FrameConverter converter;
+    converter.setFramePool(&framePool);
+    if (converter.init(codec_ctx_video->pix_fmt, codec_ctx_video->width, codec_ctx_video->height,
+                       glSinkFormats, "player") < 0) {
         av_frame_free(&frame);
-        av_frame_free(&rgb_frame);
+        closeVideoSession();
         return;
     }
 
-    // 为RGB帧分配缓冲区
-    int numBytes = av_image_get_buffer_size(AV_PIX_FMT_RGBA, codec_ctx_video->width, codec_ctx_video->height, 1);
-    uint8_t* rgb_buffer = new uint8_t[numBytes];
-    av_image_fill_arrays(rgb_frame->data, rgb_frame->linesize, rgb_buffer,
-                         AV_PIX_FMT_RGBA, codec_ctx_video->width, codec_ctx_video->height, 1);
-
-    // 初始化OpenGL环境，传入ANativeWindow
-    if (!initOpenGL(native_window, codec_ctx_video->width, codec_ctx_video->height)) {
-        LOGE("OpenGL 初始化失败");
+    // 把常驻的 OpenGL 上下文绑定到当前窗口与解码线程，窗口未变时复用已有的 EGLSurface，
+    // 按窗口尺寸设置ANativeWindow的缓冲区与输出尺寸。后台启动时等回到前台再绑定
+    int attached_generation = -1;
+    int applied_generation = surface_generation;
+    // 在 window_mutex 内调用：窗口换过时重新绑定，没有窗口时返回 false
+    auto bindWindow = [&](int width, int height) {
+        if (video_detached || !native_window) {
+            return false;
+        }
+        if (attached_generation != window_generation) {
+            if (!renderer.attach(native_window)) {
+                LOGE("OpenGL 初始化失败");
+            }
+            attached_generation = window_generation;
+            applySurfaceSize(&converter, width, height);
+        }
+        return true;
+    };
+    {
+        std::lock_guard<std::mutex> lock(window_mutex);
+        bindWindow(codec_ctx_video->width, codec_ctx_video->height);
     }
 
-    // 设置ANativeWindow的缓冲区格式
-    ANativeWindow_setBuffersGeometry(native_window, codec_ctx_video->width, codec_ctx_video->height, WINDOW_FORMAT_RGBA_8888);
+    // 预加载的首帧直接上屏，解码出同一帧时不再重复渲染
+    int64_t skip_pts = AV_NOPTS_VALUE;
+    if (preloadedFirstFrame) {
+        PlayerStats::markStartup(StartupPhase::FirstFrameDecoded);
+        {
+            std::lock_guard<std::mutex> lock(window_mutex);
+            if (bindWindow(codec_ctx_video->width, codec_ctx_video->height)) {
+                renderOutputFrame(preloadedFirstFrame);
+            }
+        }
+        if (PlayerStats::markStartup(StartupPhase::FirstFrameRendered)) {
+            std::string message = "启动耗时（预加载）：" + PlayerStats::startupJson();
+            Logger::printLong(LOG_LEVEL_INFO, LOG_TAG, message.c_str());
+        }
+        skip_pts = preloadedFirstFrame->pts;
+        av_frame_free(&preloadedFirstFrame);
+    }
 
     AVPacket* pkt = av_packet_alloc();
-    while (packetQueue_video.pop(pkt)) {
-        int ret = avcodec_send_packet(codec_ctx_video, pkt);
-        if (ret < 0) {
-            LOGE("发送数据包失败：%d", ret);
-            av_packet_unref(pkt);
-            continue;
+    int64_t due_us = 0; // 当前帧按帧率应当显示的时刻，用于统计迟到帧与偏差
+    bool first_frame = skip_pts == AV_NOPTS_VALUE;
+    int current_serial = packetQueue_video.currentSerial();
+    AVRational time_base = fmt_ctx->streams[video_stream_index]->time_base;
+    int frame_width = codec_ctx_video->width;
+    int frame_height = codec_ctx_video->height;
+    int64_t decode_start = 0;
+    bool wait_keyframe = false; // 从后台回来后丢弃数据包直到关键帧
+    int64_t preroll_target = AV_NOPTS_VALUE; // 逐帧后退跳转后要解到的帧（time_base），之前的帧只进历史
+    bool preroll_wait_flush = false;         // 逐帧后退已请求跳转，旧位置的帧不再输出
+
+    // 上屏逐帧请求的结果，记录从请求到上屏的延迟
+    auto renderStep = [&](const AVFrame* out_frame, int64_t pts) {
+        {
+            std::lock_guard<std::mutex> lock(window_mutex);
+            if (bindWindow(frame_width, frame_height)) {
+                renderOutputFrame(out_frame);
+            }
+        }
+        if (pts != AV_NOPTS_VALUE) {
+            playback_position = pts * av_q2d(time_base);
+        }
+        PlayerStats::increment(Counter::FramesRendered);
+        PlayerStats::record(Stage::FrameStep, PlayerStats::nowUs() - step_request_us);
+    };
+
+    // 暂停期间处理逐帧请求。前进先走完历史中游标之后的帧，到最新一帧后放行当前帧（*step 置为 true）；
+    // 后退在历史范围内直接上屏，超出时请求跳转并返回 false，当前帧丢弃
+    auto waitWhilePaused = [&](bool* step) {
+        while (isPaused && !isStopped) {
+            int steps = pending_steps;
+            if (steps > 0) {
+                pending_steps--;
+                const AVFrame* next = frameHistory.forward();
+                if (!next) {
+                    *step = true;
+                    return true;
+                }
+                renderStep(next, frameHistory.currentPts());
+            } else if (steps < 0) {
+                const AVFrame* previous = frameHistory.back();
+                if (previous) {
+                    pending_steps++;
+                    renderStep(previous, frameHistory.currentPts());
+                    continue;
+                }
+                // 从最早一帧之前的关键帧开始预解码，解到最早一帧时上屏它的前一帧
+                int64_t target = frameHistory.oldestPts();
+                if (target == AV_NOPTS_VALUE) {
+                    target = (int64_t)(playback_position / av_q2d(time_base));
+                }
+                preroll_target = target;
+                preroll_wait_flush = true;
+                int serial_before = packetQueue_video.currentSerial();
+                requested_seek_us = av_rescale_q(target, time_base, AV_TIME_BASE_Q) - 1;
+                while (!isStopped && reading && packetQueue_video.currentSerial() == serial_before) {
+                    av_usleep(5000);
+                }
+                return false;
+            } else {
+                av_usleep(10000);  // 线程休眠
+            }
         }
+        return true;
+    };
+
+    // 取出解码器中所有可用的帧并逐帧显示
+    auto receiveFrames = [&]() {
+        int ret = 0;
         while (ret >= 0) {
-            ret = avcodec_receive_frame(codec_ctx_video, frame);
+            {
+                TRACE_SCOPE("avcodec_receive_frame");
+                ret = avcodec_receive_frame(codec_ctx_video, frame);
+            }
+            PlayerStats::record(Stage::Decode, PlayerStats::nowUs() - decode_start);
             if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
                 break;
             } else if (ret < 0) {
                 LOGE("解码错误：%d", ret);
                 break;
             }
+            PlayerStats::increment(Counter::FramesDecoded);
+            PlayerStats::markStartup(StartupPhase::FirstFrameDecoded);
+            if (skip_pts != AV_NOPTS_VALUE && frame->pts == skip_pts) {
+                skip_pts = AV_NOPTS_VALUE;
+                decode_start = PlayerStats::nowUs();
+                continue;
+            }
+            if (preroll_wait_flush) {
+                decode_start = PlayerStats::nowUs();
+                continue;
+            }
+
+            // 进入后台时解码器中剩余的帧不再转换和渲染
+            if (video_detached) {
+                decode_start = PlayerStats::nowUs();
+                continue;
+            }
+
+            // 窗口尺寸或视频尺寸（播放列表切换后）变化时重新协商输出尺寸
+            if (applied_generation != surface_generation
+                || frame->width != frame_width || frame->height != frame_height) {
+                applied_generation = surface_generation;
+                frame_width = frame->width;
+                frame_height = frame->height;
+                std::lock_guard<std::mutex> lock(window_mutex);
+                if (native_window) {
+                    applySurfaceSize(&converter, frame->width, frame->height);
+                }
+            }
 
-            // 转为RGBA格式
-            sws_scale(sws_ctx,
-                      frame->data, frame->linesize, 0, frame->height,
-                      rgb_frame->data, rgb_frame->linesize);
+            // 转为渲染端格式，Passthrough 时直接返回解码帧
+            int64_t convert_start = PlayerStats::nowUs();
+            const AVFrame* out_frame = converter.convert(frame);
+            PlayerStats::record(Stage::Convert, PlayerStats::nowUs() - convert_start);
+            if (!out_frame) {
+                PlayerStats::increment(Counter::FramesDropped);
+                decode_start = PlayerStats::nowUs();
+                continue;
+            }
 
             // 停止控制
             if (isStopped) break;
 
-            // 暂停控制
-            while (isPaused) {
-                av_usleep(10000);  // 线程休眠
+            // 逐帧后退的预解码：目标之前的帧只进历史不上屏，解到目标帧时上屏它的前一帧
+            if (preroll_target != AV_NOPTS_VALUE) {
+                int64_t pts = frame->best_effort_timestamp;
+                frameHistory.push(out_frame, pts);
+                if (pts != AV_NOPTS_VALUE && pts < preroll_target) {
+                    decode_start = PlayerStats::nowUs();
+                    continue;
+                }
+                preroll_target = AV_NOPTS_VALUE;
+                const AVFrame* previous = frameHistory.back();
+                if (pending_steps < 0) {
+                    pending_steps++;
+                }
+                renderStep(previous ? previous : out_frame, frameHistory.currentPts());
+                TRACE_ASYNC_END("frame", frame->pts);
+                decode_start = PlayerStats::nowUs();
+                continue;
+            }
+
+            // 暂停控制，逐帧前进放行的帧不等待直接上屏
+            if (isPaused) {
+                bool step = false;
+                if (!waitWhilePaused(&step)) {
+                    decode_start = PlayerStats::nowUs();
+                    continue;
+                }
+                if (step) {
+                    renderStep(out_frame, frame->best_effort_timestamp);
+                    frameHistory.push(out_frame, frame->best_effort_timestamp);
+                    TRACE_ASYNC_END("frame", frame->pts);
+                    decode_start = PlayerStats::nowUs();
+                    continue;
+                }
+                due_us = 0; // 恢复后重新计时
             }
             // 倍速控制
             double frame_delay = 1 / (codec_ctx_video->framerate.num / (double)codec_ctx_video->framerate.den);
-            frame_delay /= (playbackSpeed*10);  // 根据播放速度调整帧的显示时间间隔
-            av_usleep((int)(frame_delay * 1000000));   // 等待帧的显示时间
+            int64_t frame_delay_us = (int64_t)(frame_delay * 1000000);
+            double audio_time = playbackSpeed == 1.0f ? audioClock.now() : NAN;
+            if (!std::isnan(audio_time) && frame->best_effort_timestamp != AV_NOPTS_VALUE) {
+                // 有音频时以听到的音频时间为主时钟：视频超前时等到音频追上，最多等一秒以免时间戳跳变卡住
+                double ahead = frame->best_effort_timestamp * av_q2d(time_base) - audio_time;
+                if (ahead > 0 && !(first_frame && fastStart)) {
+                    av_usleep((int)(std::min(ahead, 1.0) * 1000000));
+                }
+                int64_t drift_us = (int64_t)(-ahead * 1000000);
+                PlayerStats::setGauge(Gauge::AvDriftUs, drift_us);
+                PlayerStats::setGauge(Gauge::AudioLatencyUs, audioClock.latencyUs());
+                if (drift_us > frame_delay_us) {
+                    PlayerStats::increment(Counter::FramesLate);
+                }
+                due_us = 0;
+            } else {
+                frame_delay /= (playbackSpeed*10);  // 根据播放速度调整帧的显示时间间隔
+                frame_delay_us = (int64_t)(frame_delay * 1000000);
+                // 快速起播时首帧不等待，解码出来就上屏
+                if (!(first_frame && fastStart)) {
+                    av_usleep((int)(frame_delay * 1000000));   // 等待帧的显示时间
+                }
+
+                // 与按帧率推算的显示时刻比较，超过一个帧间隔记为迟到
+                int64_t render_start = PlayerStats::nowUs();
+                due_us = due_us ? due_us + frame_delay_us : render_start;
+                PlayerStats::setGauge(Gauge::AvDriftUs, render_start - due_us);
+                if (render_start - due_us > frame_delay_us) {
+                    PlayerStats::increment(Counter::FramesLate);
+                }
+            }
+            first_frame = false;
+
+            // 调用opengl渲染函数，不直接渲染到ANativeWindow；等待期间进入后台时不渲染
+            {
+                std::lock_guard<std::mutex> lock(window_mutex);
+                if (bindWindow(frame->width, frame->height)) {
+                    renderOutputFrame(out_frame);
+                }
+            }
+            TRACE_ASYNC_END("frame", frame->pts);
+            if (frame->best_effort_timestamp != AV_NOPTS_VALUE) {
+                playback_position = frame->best_effort_timestamp * av_q2d(time_base);
+            }
+            frameHistory.push(out_frame, frame->best_effort_timestamp);
+            PlayerStats::increment(Counter::FramesRendered);
+            if (PlayerStats::markStartup(StartupPhase::FirstFrameRendered)) {
+                std::string message = std::string("启动耗时") + (fastStart ? "（快速起播）" : "") + "："
+                        + PlayerStats::startupJson();
+                Logger::printLong(LOG_LEVEL_INFO, LOG_TAG, message.c_str());
+            }
+            decode_start = PlayerStats::nowUs();
+        }
+    };
+
+    // 倒放：ReverseDecoder 在另外的通道上按 GOP 倒序解码，这里按相邻帧的时间戳间隔倒序上屏。
+    // 结束（或倒放到开头）后读线程跳转到倒放停下的位置，正向播放从那里恢复
+    auto playReverse = [&]() {
+        frameHistory.clear();
+        AudioMixer::setPaused(audio_source, true);
+        audioClock.setPaused(true);
+        // 缓存的帧与正向一样在显示尺寸不到视频一半时缩小，要求省内存时总是缩小
+        int display_width, display_height;
+        fitToSurface(codec_ctx_video->width, codec_ctx_video->height, surface_width, surface_height,
+                     &display_width, &display_height);
+        bool reduce = reverse_reduced || display_width * 2 <= codec_ctx_video->width;
+        if (reverseDecoder.start(currentUrl(), video_stream_index, playback_position,
+                                 reduce ? display_width : 0, reduce ? display_height : 0) < 0) {
+            reverse_requested = false;
+        }
+        double reverse_time_base = av_q2d(reverseDecoder.timeBase());
+        int64_t last_pts = AV_NOPTS_VALUE;
+        AVFrame* reversed = nullptr;
+        while (reverse_requested && !isStopped && (reversed = reverseDecoder.nextFrame())) {
+            while (isPaused && reverse_requested && !isStopped) {
+                av_usleep(10000);
+            }
+            int64_t pts = reversed->best_effort_timestamp;
+            if (last_pts != AV_NOPTS_VALUE) {
+                double delay = std::min((last_pts - pts) * reverse_time_base / playbackSpeed, 1.0);
+                if (delay > 0) {
+                    av_usleep((unsigned)(delay * 1000000));
+                }
+            }
+            {
+                std::lock_guard<std::mutex> lock(window_mutex);
+                if (bindWindow(codec_ctx_video->width, codec_ctx_video->height)) {
+                    renderOutputFrame(reversed);
+                }
+            }
+            last_pts = pts;
+            playback_position = pts * reverse_time_base;
+            PlayerStats::increment(Counter::FramesRendered);
+            av_frame_free(&reversed);
+        }
+        bool reached_start = reverse_requested && !isStopped;
+        reverseDecoder.stop();
+        reverse_requested = false;
+        if (reached_start) {
+            LOGI("倒放到开头");
+            eventQueue.post(EVENT_REVERSE_FINISHED, 0);
+        }
+        // 等读线程跳转完成（视频队列换了序号），之后取到的都是新位置的数据包
+        int serial_before = packetQueue_video.currentSerial();
+        requested_seek_us = (int64_t)(playback_position * AV_TIME_BASE);
+        while (!isStopped && reading && packetQueue_video.currentSerial() == serial_before) {
+            av_usleep(5000);
+        }
+        AudioMixer::discard(audio_source);
+        audioClock.setPaused(isPaused);
+        AudioMixer::setPaused(audio_source, isPaused);
+        due_us = 0;
+    };
+
+    while (true) {
+        if (reverse_requested && !isStopped) {
+            playReverse();
+        }
+        int64_t wait_start = PlayerStats::nowUs();
+        int serial;
+        if (!packetQueue_video.pop(pkt, &serial)) {
+            break;
+        }
+        if (isStopped) {
+            av_packet_unref(pkt);
+            break;
+        }
+        decode_start = PlayerStats::nowUs();
+        PlayerStats::record(Stage::QueueWait, decode_start - wait_start);
+
+        // 播放列表切到下一项：先冲出上一项解码器中剩余的帧，再换用下一项的解码器，EGL 与转换器保持不变
+        if (serial != current_serial) {
+            Segment segment = takeSegment(videoSegments, serial);
+            if (segment.ctx) {
+                avcodec_send_packet(codec_ctx_video, nullptr);
+                receiveFrames();
+                avcodec_free_context(&codec_ctx_video);
+                codec_ctx_video = segment.ctx;
+                time_base = segment.time_base;
+                decode_start = PlayerStats::nowUs();
+                frameHistory.clear();
+                preroll_target = AV_NOPTS_VALUE;
+            } else if (segment.flush) {
+                // 跳转：清空解码器，跳转前的帧不再输出
+                avcodec_flush_buffers(codec_ctx_video);
+                due_us = 0;
+                frameHistory.clear();
+                // 用户跳转放弃未完成的逐帧后退预解码，否则跳转后的帧会被当作预解码吞掉
+                if (user_seek.exchange(false) || !preroll_wait_flush) {
+                    preroll_target = AV_NOPTS_VALUE;
+                }
+                preroll_wait_flush = false;
+            }
+            current_serial = serial;
+        }
+
+        // 后台：不解码，丢弃已排队的数据包，让出 GL 上下文使延迟销毁的 EGLSurface 真正释放
+        if (video_detached) {
+            if (!wait_keyframe) {
+                renderer.detach();
+                wait_keyframe = true;
+            }
+            av_packet_unref(pkt);
+            continue;
+        }
+        // 回到前台后从下一个关键帧开始解码，之后的帧按音频时钟同步
+        if (wait_keyframe) {
+            if (!(pkt->flags & AV_PKT_FLAG_KEY)) {
+                av_packet_unref(pkt);
+                continue;
+            }
+            avcodec_flush_buffers(codec_ctx_video);
+            wait_keyframe = false;
+            due_us = 0;
+            frameHistory.clear();
+            LOGI("回到前台，从关键帧恢复视频");
+        }
 
-            // 调用opengl渲染函数，不直接渲染到ANativeWindow
-            renderFrame(rgb_frame->data[0], codec_ctx_video->width, codec_ctx_video->height);
+        int ret;
+        {
+            TRACE_SCOPE("avcodec_send_packet");
+            ret = avcodec_send_packet(codec_ctx_video, pkt);
+        }
+        if (ret < 0) {
+            LOGE("发送数据包失败：%d", ret);
+            av_packet_unref(pkt);
+            continue;
         }
+        receiveFrames();
         av_packet_unref(pkt);
     }
 
-    // 播放结束后，清理资源
-    cleanupOpenGL();
+    // 播放结束后让出上下文，GL 资源留给下一次播放
+    renderer.detach();
     av_packet_free(&pkt);
-    delete[] rgb_buffer;
+    frameHistory.clear();
+    converter.release();
     av_frame_free(&frame);
-    av_frame_free(&rgb_frame);
-    sws_freeContext(sws_ctx);
+    closeVideoSession();
+}
 
-    // 清理资源
-    avcodec_free_context(&codec_ctx_video);
-    avformat_close_input(&fmt_ctx);
-    if (native_window) {
-        ANativeWindow_release(native_window);
-        native_window = nullptr;
+// 混音器读完 pcmRing 后在音频回调线程上调用，更新音频时钟
+static void onAudioConsumed(void* opaque, int64_t ringFrame, int64_t deviceFrame) {
+    audioClock.onCallback(ringFrame, deviceFrame);
+}
+
+// 等待环形缓冲区有 samples 个采样的空间，停止时返回 false
+static bool waitWritable(size_t samples) {
+    samples = std::min(samples, pcmRing.capacity());
+    while (pcmRing.writable() < samples) {
+        if (isStopped) {
+            return false;
+        }
+        av_usleep(5000);
     }
+    return true;
 }
 
-int audioCallback(AAudioStream *stream, void *userData, void *audioData, int32_t numFrames) {
-    SafeQueue *safeQueue_ = static_cast<SafeQueue*>(userData);
-    // 计算每个帧的字节数，假设是 16 位立体声
-    int bytesPerFrame = av_get_bytes_per_sample(AV_SAMPLE_FMT_S16) * 2;
-    int bufferSize = numFrames * bytesPerFrame;
-    // 如果队列为空，填充静音数据
-    if (safeQueue_->empty()) {
-        memset(audioData, 0, bufferSize);
+// 重采样后直接写入环形缓冲区。回绕时先填满尾部的连续空间，放不下的输出留在 swr 内部，
+// 再以零输入取出写到开头。in 为空时冲出 swr 内部延迟的采样，只在一项结束时调用
+static int resampleToRing(SwrContext* swr, const uint8_t** in, int in_samples, int channels) {
+    // 非空、长度为0的输入只取出已缓冲的输出，不触发 flush
+    static const uint8_t* no_input[64] = {};   // swr 支持的声道数上限
+    int needed = swr_get_out_samples(swr, in_samples);
+    if (needed <= 0 || !waitWritable((size_t)needed * channels)) {
         return 0;
     }
-    // 从队列中取出音频数据
-    auto audioFrame = safeQueue_->pop();
-    // 计算可用数据的大小
-    int availableSize = av_samples_get_buffer_size(nullptr, 2, numFrames, AV_SAMPLE_FMT_S16, 1);
-    // 将数据复制到音频缓冲区
-    if (availableSize <= bufferSize) {
-        memcpy(audioData, audioFrame.get(), availableSize);
-        // 如果可用数据小于缓冲区大小，剩余部分填充静音数据
-        if (availableSize < bufferSize) {
-            memset(static_cast<uint8_t*>(audioData) + availableSize, 0, bufferSize - availableSize);
+    int total = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        size_t contiguous;
+        int16_t* dst = pcmRing.writePointer(&contiguous);
+        int capacity = (int)(contiguous / channels);
+        if (capacity == 0) {
+            break;
+        }
+        int out = swr_convert(swr, (uint8_t**)&dst, capacity, pass == 0 ? in : (in ? no_input : nullptr),
+                              pass == 0 ? in_samples : 0);
+        if (out < 0) {
+            return out;
+        }
+        audioDsp.process(dst, out);
+        pcmRing.commitWrite((size_t)out * channels);
+        total += out;
+        if (out < capacity) {
+            break;
         }
-    } else {
-        // 如果可用数据大于缓冲区大小，只复制缓冲区大小的数据
-        memcpy(audioData, audioFrame.get(), bufferSize);
     }
-    return 0;
+    return total;
+}
+
+// 把交叉淡化输出的数据全部写入环形缓冲区后清空
+static void writeRing(std::vector<int16_t>& pcm) {
+    for (size_t written = 0; written < pcm.size() && waitWritable(pcm.size() - written);) {
+        written += pcmRing.write(pcm.data() + written, pcm.size() - written);
+    }
+    pcm.clear();
 }
 
+// 交叉淡化开启时的重采样：输出到复用的临时缓冲区，经过淡化后写入环形缓冲区
+static int resampleCrossfade(SwrContext* swr, const uint8_t** in, int in_samples, int channels,
+                             std::vector<int16_t>& scratch, AudioCrossfade& crossfade,
+                             std::vector<int16_t>& pcm) {
+    int needed = swr_get_out_samples(swr, in_samples);
+    if (needed <= 0) {
+        return 0;
+    }
+    if (scratch.size() < (size_t)needed * channels) {
+        scratch.resize((size_t)needed * channels);
+    }
+    uint8_t* dst = (uint8_t*)scratch.data();
+    int out = swr_convert(swr, &dst, needed, in, in_samples);
+    if (out > 0) {
+        audioDsp.process(scratch.data(), out);
+        crossfade.process(scratch.data(), out, pcm);
+    }
+    writeRing(pcm);
+    return out;
+}
+
+// 转换核直接写入环形缓冲区，回绕时分两段转换
+static void convertToRing(const SampleConvert::Plan& plan, const uint8_t* const* in, int frames, int channels) {
+    int done = 0;
+    while (done < frames && waitWritable((size_t)(frames - done) * channels)) {
+        size_t contiguous;
+        int16_t* dst = pcmRing.writePointer(&contiguous);
+        int n = std::min(frames - done, (int)(contiguous / channels));
+        SampleConvert::run(plan, in, done, dst, n);
+        audioDsp.process(dst, n);
+        pcmRing.commitWrite((size_t)n * channels);
+        done += n;
+    }
+}
 
-// 音频解码
+// 交叉淡化开启时的转换核：输出到临时缓冲区，经过淡化后写入环形缓冲区
+static void convertCrossfade(const SampleConvert::Plan& plan, const uint8_t* const* in, int frames, int channels,
+                             std::vector<int16_t>& scratch, AudioCrossfade& crossfade, std::vector<int16_t>& pcm) {
+    if (scratch.size() < (size_t)frames * channels) {
+        scratch.resize((size_t)frames * channels);
+    }
+    SampleConvert::run(plan, in, 0, scratch.data(), frames);
+    audioDsp.process(scratch.data(), frames);
+    crossfade.process(scratch.data(), frames, pcm);
+    writeRing(pcm);
+}
+
+static void configureResampler(SwrContext* swr, AVCodecContext* ctx, int out_sample_rate) {
+    // 部分流的声道布局为0，swr 初始化会失败，按声道数取默认布局
+    swr_alloc_set_opts(swr, AV_CH_LAYOUT_STEREO, AV_SAMPLE_FMT_S16, out_sample_rate,
+                       SampleConvert::layoutOf(ctx->channel_layout, ctx->channels), ctx->sample_fmt,
+                       ctx->sample_rate, 0, nullptr);
+    if (swr_init(swr) < 0) {
+        LOGE("重采样初始化失败：%d 声道，格式 %d", ctx->channels, ctx->sample_fmt);
+    }
+}
+
+// 音频解码：每个数据包送入后取尽解码器的全部输出，重采样为 S16 立体声写入 pcmRing。
+// 循环内不分配内存；一项结束（播放列表切换或文件结束）时冲出解码器和 swr 中延迟的数据
 void decodeAudio() {
     AVFrame *audioFrame = av_frame_alloc(); // 申请一个AVFrame，用来装解码后的数据
-    // 初始化重采样上下文
+    AVPacket *audioPacket = av_packet_alloc();
+    if (!audioFrame || !audioPacket) {
+        av_frame_free(&audioFrame);
+        av_packet_free(&audioPacket);
+        return;
+    }
+    // 初始化重采样上下文，直接转换到输出流的采样率，音频服务不再重采样
+    const int out_channel_nb = 2;
+    int out_sample_rate = audio_output_rate > 0 ? audio_output_rate.load() : codec_ctx_audio->sample_rate;
     swr_ctx = swr_alloc();
-    uint64_t out_ch_layout = AV_CH_LAYOUT_STEREO;
-    enum AVSampleFormat out_sample_fmt = AV_SAMPLE_FMT_S16;
-    int out_sample_rate = codec_ctx_audio->sample_rate;
-
-    swr_alloc_set_opts(swr_ctx, out_ch_layout, out_sample_fmt, out_sample_rate,
-                       codec_ctx_audio->channel_layout, codec_ctx_audio->sample_fmt,
-                       codec_ctx_audio->sample_rate, 0, nullptr);
-    swr_init(swr_ctx);
+    configureResampler(swr_ctx, codec_ctx_audio, out_sample_rate);
+    audioDsp.configure(out_sample_rate);
 
-    int out_channel_nb = av_get_channel_layout_nb_channels(AV_CH_LAYOUT_STEREO);
-    uint8_t *out_buffer = (uint8_t *) av_malloc(44100*2);
+    // 播放列表切换时与下一项交叉淡化，输出格式固定，下一项的采样率和声道由 swr 转换
+    AudioCrossfade crossfade;
+    crossfade.configure(out_sample_rate, out_channel_nb, crossfade_ms);
+    bool use_crossfade = crossfade_ms > 0;
+    int64_t crossfade_frames = use_crossfade ? (int64_t)out_sample_rate * crossfade_ms / 1000 : 0;
+    AVRational time_base = fmt_ctx->streams[audio_stream_index]->time_base;
+    std::vector<int16_t> scratch;
+    std::vector<int16_t> pcm;
+    auto resample = [&](const uint8_t** in, int in_samples) {
+        return use_crossfade
+               ? resampleCrossfade(swr_ctx, in, in_samples, out_channel_nb, scratch, crossfade, pcm)
+               : resampleToRing(swr_ctx, in, in_samples, out_channel_nb);
+    };
+    // 采样率与输出相同的常见格式走向量化转换核，其余交给 swr
+    SampleConvert::Plan plan;
+    auto convert = [&](AVFrame* f) {
+        if (!plan.matches(f->format, f->channel_layout, f->channels, f->sample_rate, out_sample_rate)) {
+            plan = SampleConvert::choose(f->format, f->channel_layout, f->channels, f->sample_rate, out_sample_rate);
+        }
+        if (plan.kernel == SampleConvert::KERNEL_NONE) {
+            resample((const uint8_t**)f->extended_data, f->nb_samples);
+        } else if (use_crossfade) {
+            convertCrossfade(plan, f->extended_data, f->nb_samples, out_channel_nb, scratch, crossfade, pcm);
+        } else {
+            convertToRing(plan, f->extended_data, f->nb_samples, out_channel_nb);
+        }
+    };
+    // 取尽解码器当前可输出的帧
+    auto receiveFrames = [&]() {
+        int ret;
+        while ((ret = avcodec_receive_frame(codec_ctx_audio, audioFrame)) >= 0) {
+            if (audioFrame->best_effort_timestamp != AV_NOPTS_VALUE) {
+                // 本帧从环形缓冲区当前写位置开始输出；交叉淡化扣留的尾部还未写入，输出相应推后
+                int64_t ring_frame = (int64_t)(pcmRing.totalWritten() / out_channel_nb) + crossfade_frames;
+                audioClock.setAnchor(ring_frame, audioFrame->best_effort_timestamp * av_q2d(time_base));
+            }
+            convert(audioFrame);
+            av_frame_unref(audioFrame);
+        }
+        return ret;
+    };
+    // 一项结束：冲出解码器缓存的帧和 swr 的延迟采样
+    auto drain = [&]() {
+        avcodec_send_packet(codec_ctx_audio, nullptr);
+        receiveFrames();
+        resample(nullptr, 0);
+    };
+    int current_serial = packetQueue_audio.currentSerial();
+    audioDecoding = true;
 
-    while (!packetQueue_audio.isFinished()) {// isstart
-        AVPacket *audioPacket = av_packet_alloc(); // 申请一个AVPacket，用来装pakect
-        // 从队列中获取音频数据包
-        if (packetQueue_audio.pop(audioPacket) < 0) {
-            continue; // 如果队列为空或发生错误，继续等待
+    while (!isStopped) {
+        // 从队列中获取音频数据包，队列结束且为空时返回 false
+        int serial;
+        if (!packetQueue_audio.pop(audioPacket, &serial)) {
+            break;
+        }
+        // 播放列表切到下一项或切换了音轨：换用新的解码器并按其输入格式重新配置重采样。
+        // 切换音轨时旧解码器与 swr 中缓存的数据直接丢弃（swr 重新初始化时清空）
+        if (serial != current_serial) {
+            Segment segment = takeSegment(audioSegments, serial);
+            if (segment.ctx) {
+                if (!segment.flush) {
+                    drain();
+                }
+                avcodec_free_context(&codec_ctx_audio);
+                codec_ctx_audio = segment.ctx;
+                time_base = segment.time_base;
+                configureResampler(swr_ctx, codec_ctx_audio, out_sample_rate);
+                if (!segment.flush) {
+                    crossfade.markBoundary();
+                }
+            } else if (segment.flush) {
+                // 跳转：清空解码器、swr 与交叉淡化扣留的尾部，环形缓冲区中还没播放的旧数据由混音器丢弃
+                avcodec_flush_buffers(codec_ctx_audio);
+                configureResampler(swr_ctx, codec_ctx_audio, out_sample_rate);
+                crossfade.reset();
+                AudioMixer::discard(audio_source);
+            }
+            current_serial = serial;
         }
-        LOGI("音频数据包大小：%d", audioPacket->size);
+        LOGV("音频数据包大小：%d", audioPacket->size);
         int ret = avcodec_send_packet(codec_ctx_audio, audioPacket);
-        ret = avcodec_receive_frame(codec_ctx_audio, audioFrame);
-        if (ret != 0) {
+        if (ret == AVERROR(EAGAIN)) {
+            // 解码器输出已满，先取走再送
+            receiveFrames();
+            ret = avcodec_send_packet(codec_ctx_audio, audioPacket);
+        }
+        av_packet_unref(audioPacket);
+        if (ret < 0) {
+            LOGW("发送音频数据包失败：%d", ret);
             continue;
         }
-        uint8_t *out_buffer = (uint8_t *) av_malloc(44100*2);
-        swr_convert(swr_ctx, &out_buffer, 44100*2,
-                    (const uint8_t **) audioFrame->data, audioFrame->nb_samples);
-        int size = av_samples_get_buffer_size(nullptr, out_channel_nb,
-                                              audioFrame->nb_samples, AV_SAMPLE_FMT_S16,1);
-
-        safeQueue.push(out_buffer, size);
-
-        LOGI("音频数据帧大小：%d", audioFrame->pkt_size);
-        av_packet_free(&audioPacket);
-        av_free(out_buffer);
+        receiveFrames();
     }
+    if (!isStopped) {
+        drain();
+    }
+    crossfade.flush(pcm);
+    writeRing(pcm);
+    audioDecoding = false;
+    releaseSegments(audioSegments);
     swr_free(&swr_ctx);
+    av_packet_free(&audioPacket);
     av_frame_free(&audioFrame);
-    avcodec_close(codec_ctx_audio);
-    avformat_close_input(&fmt_ctx);
-    return;
+    // 解封装上下文由视频解码线程关闭
+    avcodec_free_context(&codec_ctx_audio);
 }
 
 
-// 播放器初始化
-extern "C" JNIEXPORT jobject JNICALL
-Java_com_example_androidplayer_Player_nativePlay(JNIEnv *env, jobject thiz, jstring inputFile, jobject surface) {
-    // 获取输入文件路径和 ANativeWindow
-    const char* input_file = env->GetStringUTFChars(inputFile, nullptr);
-    native_window = ANativeWindow_fromSurface(env, surface);
-    if (!native_window) {
-        LOGE("无法获取 ANativeWindow");
-        env->ReleaseStringUTFChars(inputFile, input_file);
+// 打开音频解码器，失败时返回 nullptr；startup 为 false 时（播放中切换音轨）不计入起播耗时
+static AVCodecContext* openAudioDecoder(AVCodecParameters* parameters, bool startup) {
+    int64_t open_start = PlayerStats::nowUs();
+    AVCodec *audio_dec = avcodec_find_decoder(parameters->codec_id);
+    if (!audio_dec) {
+        LOGE("找不到音频解码器");
         return nullptr;
     }
-    if (avformat_open_input(&fmt_ctx, input_file, nullptr, nullptr) < 0) {
-        ANativeWindow_release(native_window);
-        env->ReleaseStringUTFChars(inputFile, input_file);
+    AVCodecContext* ctx = avcodec_alloc_context3(audio_dec);
+    if (!ctx) {
         return nullptr;
     }
-    // 获取流信息
-    if (avformat_find_stream_info(fmt_ctx, nullptr) < 0) {
-        avformat_close_input(&fmt_ctx);
-        ANativeWindow_release(native_window);
-        env->ReleaseStringUTFChars(inputFile, input_file);
+    if (avcodec_parameters_to_context(ctx, parameters) < 0 || avcodec_open2(ctx, audio_dec, nullptr) < 0) {
+        LOGE("无法打开音频解码器");
+        avcodec_free_context(&ctx);
         return nullptr;
     }
-    // 查找视频流索引
-    for (unsigned int i = 0; i < fmt_ctx->nb_streams; i++) {
-        if (fmt_ctx->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
-            video_stream_index = i;
-//            break;
-        } else if (fmt_ctx->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_AUDIO) {
-            // 音频解码器
-            audio_stream_index = i;
-            AVCodecParameters *parameters = fmt_ctx->streams[i]->codecpar;
-            LOGI("音频通道数：%d",parameters->channels);
-            LOGI("音频采样率：%d",parameters->sample_rate);
+    if (startup) {
+        PlayerStats::recordStartup(StartupPhase::OpenAudioDecoder, PlayerStats::nowUs() - open_start);
+    }
+    return ctx;
+}
+
+// 打开失败时释放已打开的解码器和解封装上下文
+static void closeMedia() {
+    avcodec_free_context(&codec_ctx_video);
+    avcodec_free_context(&codec_ctx_audio);
+    clearMediaSnapshot();
+    FileIO::closeInput(&fmt_ctx);
+}
+
+// 接管预加载好的媒体：解封装和解码器直接使用，缓存的数据包放入队列，首帧交给解码线程
+static void adoptPreloaded(PreloadedMedia* media) {
+    fmt_ctx = media->fmt_ctx;
+    codec_ctx_video = media->video_ctx;
+    codec_ctx_audio = media->audio_ctx;
+    media->fmt_ctx = nullptr;
+    media->video_ctx = nullptr;
+    media->audio_ctx = nullptr;
+    fmt_ctx->interrupt_callback.callback = prepareInterrupt;
+    fmt_ctx->interrupt_callback.opaque = nullptr;
+    video_stream_index = media->video_stream_index;
+    audio_stream_index = media->audio_stream_index;
+    duration = fmt_ctx->duration / (double)AV_TIME_BASE;
+    for (AVPacket* pkt : media->packets) {
+        if (pkt->stream_index == video_stream_index) {
+            packetQueue_video.push(pkt);
+        } else {
+            packetQueue_audio.push(pkt);
+        }
+    }
+    av_frame_free(&preloadedFirstFrame);
+    preloadedFirstFrame = media->first_frame;
+    media->first_frame = nullptr;
+}
+
+// 打开媒体：解封装、读取流信息、打开解码器，结果保存在全局状态中。
+// 不依赖 JNI，可在工作线程调用，成功返回0，失败或被取消返回 AVERROR
+static int openMedia(const char* input_file) {
+    PlayerStats::reset();
+    PlayerStats::beginStartup();
+    video_stream_index = -1;
+    audio_stream_index = -1;
+    {
+        std::lock_guard<std::mutex> lock(playlist_mutex);
+        current_url = input_file;
+    }
+    playback_position = 0;
 
-            AVCodec *audio_dec = avcodec_find_decoder(parameters->codec_id);
-            codec_ctx_audio = avcodec_alloc_context3(audio_dec);
-            avcodec_parameters_to_context(codec_ctx_audio,parameters);
-            avcodec_open2(codec_ctx_audio,audio_dec,0);
+    // 已预加载时直接接管，跳过打开、探测和解码器初始化
+    std::unique_ptr<PreloadedMedia> preloaded = preloadManager.take(input_file);
+    if (preloaded) {
+        adoptPreloaded(preloaded.get());
+        publishMediaSnapshot();
+        return 0;
+    }
+
+    // 快速起播时限制探测的数据量和时长，流信息不全的部分由解码器在首帧时补齐
+    AVDictionary* format_opts = nullptr;
+    if (fastStart) {
+        av_dict_set(&format_opts, "probesize", FAST_START_PROBESIZE, 0);
+        av_dict_set(&format_opts, "analyzeduration", FAST_START_ANALYZEDURATION, 0);
+    }
+    eventQueue.post(EVENT_PREPARE_PROGRESS, PREPARE_OPENING);
+    fmt_ctx = avformat_alloc_context();
+    if (!fmt_ctx) {
+        av_dict_free(&format_opts);
+        return AVERROR(ENOMEM);
+    }
+    fmt_ctx->interrupt_callback.callback = prepareInterrupt;
+    int64_t phase_start = PlayerStats::nowUs();
+    int ret = FileIO::openInput(&fmt_ctx, input_file, &format_opts);
+    av_dict_free(&format_opts);
+    if (ret < 0) {
+        LOGE("无法打开输入：%s", input_file);
+        return ret;
+    }
+    PlayerStats::recordStartup(StartupPhase::OpenInput, PlayerStats::nowUs() - phase_start);
+    // 获取流信息：缓存命中时直接使用缓存的流信息，跳过探测
+    eventQueue.post(EVENT_PREPARE_PROGRESS, PREPARE_PROBING);
+    phase_start = PlayerStats::nowUs();
+    double resume_position = 0;
+    if (!StreamInfoCache::load(input_file, fmt_ctx, &resume_position)) {
+        ret = avformat_find_stream_info(fmt_ctx, nullptr);
+        if (ret < 0 || prepareCancelled) {
+            closeMedia();
+            return prepareCancelled ? AVERROR_EXIT : ret;
         }
+        StreamInfoCache::save(input_file, fmt_ctx);
+    }
+    PlayerStats::recordStartup(StartupPhase::FindStreamInfo, PlayerStats::nowUs() - phase_start);
+    // 按轨道偏好选择视频流和音频流，其余的流由读线程在解封装层丢弃
+    video_stream_index = TrackSelector::choose(fmt_ctx, AVMEDIA_TYPE_VIDEO);
+    audio_stream_index = TrackSelector::choose(fmt_ctx, AVMEDIA_TYPE_AUDIO);
+    if (audio_stream_index >= 0) {
+        AVCodecParameters *parameters = fmt_ctx->streams[audio_stream_index]->codecpar;
+        LOGI("音频通道数：%d",parameters->channels);
+        LOGI("音频采样率：%d",parameters->sample_rate);
     }
 
-    if (video_stream_index == -1) {
+    if (video_stream_index < 0) {
         LOGE("未找到视频流");
-        avformat_close_input(&fmt_ctx);
-        ANativeWindow_release(native_window);
-        env->ReleaseStringUTFChars(inputFile, input_file);
-        return nullptr;
+        closeMedia();
+        return AVERROR_STREAM_NOT_FOUND;
     }
     // 查找解码器
+    eventQueue.post(EVENT_PREPARE_PROGRESS, PREPARE_OPENING_DECODERS);
     AVCodecParameters* codec_params = fmt_ctx->streams[video_stream_index]->codecpar;
-    AVCodecParameters* codec_params2 = fmt_ctx->streams[audio_stream_index]->codecpar;
-    // 获取解码器参数
-    int width = codec_params->width;
-    int height = codec_params->height;
-
-    int sampleRate = codec_params2->sample_rate;
-    int channels = codec_params2->channels;
-    const char*  audioCodec = avcodec_get_name(codec_params2->codec_id);
-
-    // 自适应窗口的回调
-    jclass david_player = env->GetObjectClass(thiz);
-    jmethodID onSizeChange = env->GetMethodID(david_player, "onSizeChange", "(II)V");
-    env->CallVoidMethod(thiz, onSizeChange, width, height);
-
     duration = fmt_ctx->duration / (double)AV_TIME_BASE;
-    const char* codec_name = avcodec_get_name(codec_params->codec_id);
 
     AVCodec* codec = avcodec_find_decoder(codec_params->codec_id);
     if (!codec) {
         LOGE("找不到解码器");
-        avformat_close_input(&fmt_ctx);
-        ANativeWindow_release(native_window);
-        env->ReleaseStringUTFChars(inputFile, input_file);
-        return nullptr;
+        closeMedia();
+        return AVERROR_DECODER_NOT_FOUND;
     }
     // 分配解码器上下文并打开解码器
     codec_ctx_video = avcodec_alloc_context3(codec);
     if (!codec_ctx_video) {
         LOGE("无法分配 AVCodecContext");
-        avformat_close_input(&fmt_ctx);
-        ANativeWindow_release(native_window);
-        env->ReleaseStringUTFChars(inputFile, input_file);
-        return nullptr;
+        closeMedia();
+        return AVERROR(ENOMEM);
     }
-    if (avcodec_parameters_to_context(codec_ctx_video, codec_params) < 0) {
+    if ((ret = avcodec_parameters_to_context(codec_ctx_video, codec_params)) < 0) {
         LOGE("无法拷贝解码器参数到上下文");
-        avcodec_free_context(&codec_ctx_video);
-        avformat_close_input(&fmt_ctx);
-        ANativeWindow_release(native_window);
-        env->ReleaseStringUTFChars(inputFile, input_file);
-        return nullptr;
+        closeMedia();
+        return ret;
+    }
+    // 解码帧从缓冲池分配
+    framePool.attach(codec_ctx_video);
+    // 窗口远小于视频时直接以低分辨率解码（仅部分解码器支持）
+    codec_ctx_video->lowres = chooseLowres(codec, codec_params->width, codec_params->height);
+    if (codec_ctx_video->lowres > 0) {
+        LOGI("lowres 解码：%d", codec_ctx_video->lowres);
+    }
+
+    // 音频解码器：快速起播时与视频解码器并行打开，否则按顺序打开
+    std::thread audio_opener;
+    if (audio_stream_index >= 0) {
+        AVCodecParameters *parameters = fmt_ctx->streams[audio_stream_index]->codecpar;
+        if (fastStart) {
+            audio_opener = std::thread([parameters] {
+                codec_ctx_audio = openAudioDecoder(parameters);
+            });
+        } else {
+            codec_ctx_audio = openAudioDecoder(parameters);
+        }
+    }
+    phase_start = PlayerStats::nowUs();
+    ret = avcodec_open2(codec_ctx_video, codec, nullptr);
+    PlayerStats::recordStartup(StartupPhase::OpenVideoDecoder, PlayerStats::nowUs() - phase_start);
+    if (audio_opener.joinable()) {
+        audio_opener.join();
     }
-    if (avcodec_open2(codec_ctx_video, codec, nullptr) < 0) {
+    if (ret < 0 || prepareCancelled) {
         LOGE("无法打开解码器");
-        avcodec_free_context(&codec_ctx_video);
-        avformat_close_input(&fmt_ctx);
-        ANativeWindow_release(native_window);
-        env->ReleaseStringUTFChars(inputFile, input_file);
-        return nullptr;
+        closeMedia();
+        return prepareCancelled ? AVERROR_EXIT : ret;
     }
 
-    // 创建 MediaInfo 对象并返回的回调
+    // 从上次的位置继续播放，接近结尾时从头开始
+    if (resume_position > 1 && resume_position < duration - 1) {
+        if (av_seek_frame(fmt_ctx, -1, (int64_t)(resume_position * AV_TIME_BASE), AVSEEK_FLAG_BACKWARD) >= 0) {
+            playback_position = resume_position;
+            LOGI("续播位置：%.2f 秒", resume_position);
+        }
+    }
+    publishMediaSnapshot();
+    return 0;
+}
+
+// 根据媒体信息快照创建 MediaInfo 对象，没有音频流时音频字段为0
+static jobject createMediaInfo(JNIEnv* env, const MediaSnapshot& snapshot) {
+    int width = snapshot.width;
+    int height = snapshot.height;
+    const char* codec_name = snapshot.videoCodec.c_str();
+    double duration = snapshot.duration;
+
+    int sampleRate = snapshot.sampleRate;
+    int channels = snapshot.channels;
+    const char*  audioCodec = snapshot.audioCodec.c_str();
+
     jclass videoInfoClass = env->FindClass("com/example/androidplayer/MediaInfo");
 //    jmethodID constructor = env->GetMethodID(videoInfoClass, "<init>", "(IIDLjava/lang/String;)V");
     jmethodID constructor = env->GetMethodID(videoInfoClass, "<init>", "(IIDLjava/lang/String;IILjava/lang/String;)V");
 //    jobject videoInfo = env->NewObject(videoInfoClass, constructor, width, height, duration,
 //                                       env->NewStringUTF(codec_name));
-    jobject videoInfo = env->NewObject(videoInfoClass, constructor,
-                                       width, height, duration, env->NewStringUTF(codec_name),
-                                       sampleRate, channels, env->NewStringUTF(audioCodec));
+    return env->NewObject(videoInfoClass, constructor,
+                          width, height, duration, env->NewStringUTF(codec_name),
+                          sampleRate, channels, env->NewStringUTF(audioCodec));
+}
 
+// 启动读包和解码线程
+static void startPlayback() {
     packetQueue_video.setFinished(false); // 设置队列为未结束
-    
-//    AAudioRender audioRender;
-//    audioRender.configure(sampleRate, channels, AV_SAMPLE_FMT_S16);
-//    audioRender.setCallback(audioCallback, &safeQueue);
-//    audioRender.start();
-    // detach读数据包和解码线程，放置阻塞主线程
-    std::thread(readThread, input_file).detach();
-    std::thread(decodeVideo).detach();
-//    std::thread(decodeAudio).detach();
+
+    // 播放列表模式下从当前地址所在的位置开始，并预先打开下一项
+    {
+        std::lock_guard<std::mutex> lock(playlist_mutex);
+        auto it = std::find(playlist.begin(), playlist.end(), current_url);
+        playlist_index = it != playlist.end() ? it - playlist.begin() : playlist.size();
+    }
+    preloadNextItem();
+
+    // 混音器的输出流使用设备原生采样率，解码线程重采样到该采样率；pcmRing 在加入混音器前清空
+    bool audio_started = false;
+    AudioMixer::removeSource(audio_source.exchange(-1));
+    audio_output_rate = 0;
+    if (codec_ctx_audio) {
+        pcmRing.reset(AUDIO_RING_SAMPLES);
+        audioClock.reset(AudioMixer::presentation());
+        audio_source = AudioMixer::addSource(&pcmRing, audio_volume, onAudioConsumed, nullptr);
+        audio_started = audio_source >= 0;
+        audio_output_rate = audio_started ? AudioMixer::sampleRate() : 0;
+        audioClock.setSampleRate(audio_output_rate);
+        if (!audio_started) {
+            LOGW("音频输出启动失败，只播放视频");
+        }
+    }
+    // 没有音频输出时音频解码线程不启动，音频解码器在这里释放
+    if (!audio_started) {
+        avcodec_free_context(&codec_ctx_audio);
+    }
+    // 读数据包和解码线程在后台运行，不阻塞主线程，由 nativeStop 等待退出
+    int64_t phase_start = PlayerStats::nowUs();
+    reading = true;
+    videoDecoding = true;
+    readWorker = std::thread(readThread, nullptr);
+    videoWorker = std::thread(decodeVideo);
+    if (audio_started) {
+        audioWorker = std::thread(decodeAudio);
+    }
+    PlayerStats::recordStartup(StartupPhase::StartThreads, PlayerStats::nowUs() - phase_start);
+}
+
+// 等待上一次异步准备的工作线程结束
+static void joinPrepareThread() {
+    if (prepareThread.joinable()) {
+        prepareThread.join();
+    }
+}
+
+// 停止读线程与解码线程并等待退出：置停止标志，清空并结束两个队列，唤醒等待数据包的解码线程。
+// 阻塞中的读取由 prepareCancelled 经中断回调打断
+static void joinPlaybackThreads() {
+    isStopped = true;
+    reverse_requested = false;
+    packetQueue_video.flush();
+    packetQueue_video.setFinished(true);
+    packetQueue_audio.flush();
+    packetQueue_audio.setFinished(true);
+    if (readWorker.joinable()) {
+        readWorker.join();
+    }
+    if (videoWorker.joinable()) {
+        videoWorker.join();
+    }
+    if (audioWorker.joinable()) {
+        audioWorker.join();
+    }
+}
+
+// 新的一次准备开始前复位上一次会话留下的控制状态：停止、暂停、逐帧、倒放与跳转请求，
+// 以及上一次读线程结束时置为完成的两个队列。之后由调用方复位 prepareCancelled
+static void resetSessionState() {
+    // 上一次会话没有 nativeStop（或已自然播完）时先等它的线程退出
+    if (readWorker.joinable() || videoWorker.joinable() || audioWorker.joinable()) {
+        prepareCancelled = true;
+        joinPlaybackThreads();
+    }
+    isStopped = false;
+    isPaused = false;
+    pending_steps = 0;
+    stepped = false;
+    reverse_requested = false;
+    requested_seek_us = AV_NOPTS_VALUE;
+    user_seek = false;
+    requested_audio_stream = -1;
+    packetQueue_video.flush();
+    packetQueue_video.setFinished(false);
+    packetQueue_audio.flush();
+    packetQueue_audio.setFinished(false);
+}
+
+extern "C" JNIEXPORT jint JNI_OnLoad(JavaVM* vm, void* reserved) {
+    EventQueue::setJavaVM(vm);
+    return JNI_VERSION_1_6;
+}
+
+// 播放器初始化（同步），在调用线程上完成打开和解码器初始化
+extern "C" JNIEXPORT jobject JNICALL
+Java_com_example_androidplayer_Player_nativePlay(JNIEnv *env, jobject thiz, jstring inputFile, jobject surface) {
+    joinPrepareThread();
+    resetSessionState();
+    prepareCancelled = false;
+    // 获取输入文件路径和 ANativeWindow
+    const char* input_file = env->GetStringUTFChars(inputFile, nullptr);
+    video_detached = false;
+    ANativeWindow* window = ANativeWindow_fromSurface(env, surface);
+    if (!window) {
+        LOGE("无法获取 ANativeWindow");
+        env->ReleaseStringUTFChars(inputFile, input_file);
+        return nullptr;
+    }
+    {
+        std::lock_guard<std::mutex> lock(window_mutex);
+        replaceWindowLocked(window);
+    }
+    if (openMedia(input_file) < 0) {
+        {
+            std::lock_guard<std::mutex> lock(window_mutex);
+            replaceWindowLocked(nullptr);
+        }
+        env->ReleaseStringUTFChars(inputFile, input_file);
+        return nullptr;
+    }
     env->ReleaseStringUTFChars(inputFile, input_file);
 
+    // 自适应窗口的回调
+    MediaSnapshot snapshot = currentMediaSnapshot();
+    jclass david_player = env->GetObjectClass(thiz);
+    jmethodID onSizeChange = env->GetMethodID(david_player, "onSizeChange", "(II)V");
+    env->CallVoidMethod(thiz, onSizeChange, snapshot.width, snapshot.height);
+
+    // 创建 MediaInfo 对象并返回的回调
+    jobject videoInfo = createMediaInfo(env, snapshot);
+    startPlayback();
     return videoInfo;
 }
 
+// 异步准备：打开、探测和解码器初始化在 native 工作线程上进行，
+// 进度和结果通过 onNativeEvent 通知，完成后调用 nativeStart 开始播放
+extern "C" JNIEXPORT jint JNICALL
+Java_com_example_androidplayer_Player_nativePrepareAsync(JNIEnv *env, jobject thiz, jstring inputFile, jobject surface) {
+    joinPrepareThread();
+    resetSessionState();
+    video_detached = false;
+    ANativeWindow* window = ANativeWindow_fromSurface(env, surface);
+    if (!window) {
+        LOGE("无法获取 ANativeWindow");
+        return -1;
+    }
+    {
+        std::lock_guard<std::mutex> lock(window_mutex);
+        replaceWindowLocked(window);
+    }
+    eventQueue.attach(env, thiz);
+    const char* input_file = env->GetStringUTFChars(inputFile, nullptr);
+    std::string url = input_file;
+    env->ReleaseStringUTFChars(inputFile, input_file);
+
+    prepareCancelled = false;
+    mediaPrepared = false;
+    prepareThread = std::thread([url] {
+        int ret = openMedia(url.c_str());
+        if (ret < 0) {
+            // 准备期间窗口可能被 UI 线程分离或更换
+            {
+                std::lock_guard<std::mutex> lock(window_mutex);
+                replaceWindowLocked(nullptr);
+            }
+            if (prepareCancelled) {
+                LOGI("准备已取消：%s", url.c_str());
+                eventQueue.post(EVENT_CANCELLED);
+            } else {
+                eventQueue.post(EVENT_ERROR, ret);
+            }
+            return;
+        }
+        mediaPrepared = true;
+        eventQueue.post(EVENT_PREPARED);
+    });
+    return 0;
+}
+
+// 异步准备完成后开始播放
+extern "C" JNIEXPORT jint JNICALL
+Java_com_example_androidplayer_Player_nativeStart(JNIEnv *env, jobject thiz) {
+    joinPrepareThread();
+    if (!mediaPrepared) {
+        LOGE("尚未准备完成");
+        return -1;
+    }
+    mediaPrepared = false;
+    startPlayback();
+    return 0;
+}
+
+// 取消进行中的异步准备，阻塞中的打开和探测由中断回调打断
+extern "C" JNIEXPORT void JNICALL
+Java_com_example_androidplayer_Player_nativeCancelPrepare(JNIEnv *env, jobject thiz) {
+    prepareCancelled = true;
+    joinPrepareThread();
+    // 已准备完成但尚未开始播放时，释放打开的资源
+    if (mediaPrepared) {
+        mediaPrepared = false;
+        closeMedia();
+        std::lock_guard<std::mutex> lock(window_mutex);
+        replaceWindowLocked(nullptr);
+    }
+}
+
+// 异步准备完成后获取媒体信息
+extern "C" JNIEXPORT jobject JNICALL
+Java_com_example_androidplayer_Player_nativeGetMediaInfo(JNIEnv *env, jobject thiz) {
+    MediaSnapshot snapshot = currentMediaSnapshot();
+    if (!snapshot.valid) {
+        return nullptr;
+    }
+    return createMediaInfo(env, snapshot);
+}
+
+// 列出媒体中的全部轨道，selected 标记当前播放（或正在切换到）的视频与音频轨
+extern "C" JNIEXPORT jobjectArray JNICALL
+Java_com_example_androidplayer_Player_nativeGetTracks(JNIEnv *env, jobject thiz) {
+    jclass trackClass = env->FindClass("com/example/androidplayer/TrackInfo");
+    MediaSnapshot snapshot = currentMediaSnapshot();
+    if (!snapshot.valid) {
+        return env->NewObjectArray(0, trackClass, nullptr);
+    }
+    jmethodID constructor = env->GetMethodID(trackClass, "<init>",
+                                             "(IILjava/lang/String;Ljava/lang/String;JIIIIZZ)V");
+    int pending = requested_audio_stream;
+    int audio = pending >= 0 ? pending : snapshot.audioIndex;
+    const std::vector<TrackSelector::Track>& tracks = snapshot.tracks;
+    jobjectArray result = env->NewObjectArray((jsize)tracks.size(), trackClass, nullptr);
+    for (size_t i = 0; i < tracks.size(); i++) {
+        const TrackSelector::Track& t = tracks[i];
+        jstring language = env->NewStringUTF(t.language.c_str());
+        jstring codec = env->NewStringUTF(t.codec.c_str());
+        jboolean selected = (t.index == snapshot.videoIndex || t.index == audio) ? JNI_TRUE : JNI_FALSE;
+        jobject track = env->NewObject(trackClass, constructor, t.index, t.type, language, codec,
+                                       (jlong)t.bitrate, t.channels, t.sampleRate, t.width, t.height,
+                                       t.isDefault ? JNI_TRUE : JNI_FALSE, selected);
+        env->SetObjectArrayElement(result, (jsize)i, track);
+        env->DeleteLocalRef(track);
+        env->DeleteLocalRef(codec);
+        env->DeleteLocalRef(language);
+    }
+    return result;
+}
+
+// 播放中切换音轨，由读线程执行：只清空音频队列和解码器，视频不受影响。
+// 字幕没有解码和显示的通路，始终在解封装层丢弃，不支持选择
+extern "C"
+JNIEXPORT jint JNICALL
+Java_com_example_androidplayer_Player_nativeSelectTrack(JNIEnv *env, jobject thiz, jint index) {
+    MediaSnapshot snapshot = currentMediaSnapshot();
+    auto it = std::find_if(snapshot.tracks.begin(), snapshot.tracks.end(),
+                           [index](const TrackSelector::Track& t) { return t.index == index; });
+    if (!snapshot.valid || it == snapshot.tracks.end()) {
+        return -1;
+    }
+    if (it->type != AVMEDIA_TYPE_AUDIO) {
+        LOGW("只支持切换音轨：%d", index);
+        return -1;
+    }
+    if (!audioDecoding) {
+        LOGW("音频未在播放，无法切换音轨");
+        return -1;
+    }
+    requested_audio_stream = index;
+    return 0;
+}
+
+// 轨道偏好，对之后打开的媒体生效；language、codec 为空时不限制，maxBitrate 为0时不限制码率
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_example_androidplayer_Player_nativeSetTrackPreference(JNIEnv *env, jclass clazz, jint type,
+                                                               jstring language, jstring codec, jlong maxBitrate) {
+    TrackSelector::Preference preference;
+    if (language) {
+        const char* value = env->GetStringUTFChars(language, nullptr);
+        preference.language = value;
+        env->ReleaseStringUTFChars(language, value);
+    }
+    if (codec) {
+        const char* value = env->GetStringUTFChars(codec, nullptr);
+        preference.codec = value;
+        env->ReleaseStringUTFChars(codec, value);
+    }
+    preference.maxBitrate = maxBitrate;
+    TrackSelector::setPreference((AVMediaType)type, preference);
+}
+
+// 窗口尺寸变化，解码线程在下一帧按新尺寸重新协商
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_example_androidplayer_Player_nativeSetSurfaceSize(JNIEnv *env, jobject thiz, jint width, jint height) {
+    surface_width = width;
+    surface_height = height;
+    surface_generation++;
+}
+
+// 窗口即将销毁（应用进入后台）：视频停止解封装、解码和渲染，音频继续播放。
+// 返回前已不再使用该窗口，可在 surfaceDestroyed 中调用
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_example_androidplayer_Player_nativeDetachSurface(JNIEnv *env, jobject thiz) {
+    video_detached = true;
+    // 等进行中的一帧渲染结束；EGLSurface 若仍是解码线程的 current，EGL 会推迟到它让出上下文时销毁
+    std::lock_guard<std::mutex> lock(window_mutex);
+    renderer.releaseSurface();
+    replaceWindowLocked(nullptr);
+    LOGI("窗口已分离，进入仅音频模式");
+}
+
+// 新窗口可用（回到前台）：恢复视频解封装，解码线程从下一个关键帧开始按音频时钟继续
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_example_androidplayer_Player_nativeAttachSurface(JNIEnv *env, jobject thiz, jobject surface) {
+    ANativeWindow* window = surface ? ANativeWindow_fromSurface(env, surface) : nullptr;
+    if (!window) {
+        LOGE("无法获取 ANativeWindow");
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(window_mutex);
+        replaceWindowLocked(window);
+    }
+    surface_generation++;
+    video_detached = false;
+}
+
+// 快速起播开关，下一次 nativePlay 生效
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_example_androidplayer_Player_nativeSetFastStart(JNIEnv *env, jobject thiz, jboolean enable) {
+    fastStart = (enable == JNI_TRUE);
+}
+
+// 设置播放列表，从列表中的当前地址开始按顺序无缝播放，crossfadeMs 为音频交叉淡化时长，0为不淡化
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_example_androidplayer_Player_nativeSetPlaylist(JNIEnv *env, jobject thiz, jobjectArray urls, jint crossfadeMs) {
+    std::vector<std::string> list;
+    jsize count = env->GetArrayLength(urls);
+    for (jsize i = 0; i < count; i++) {
+        jstring url = (jstring)env->GetObjectArrayElement(urls, i);
+        const char* url_str = env->GetStringUTFChars(url, nullptr);
+        list.emplace_back(url_str);
+        env->ReleaseStringUTFChars(url, url_str);
+        env->DeleteLocalRef(url);
+    }
+    crossfade_ms = std::max(0, (int)crossfadeMs);
+    std::lock_guard<std::mutex> lock(playlist_mutex);
+    playlist.swap(list);
+    auto it = std::find(playlist.begin(), playlist.end(), current_url);
+    playlist_index = it != playlist.end() ? it - playlist.begin() : playlist.size();
+}
+
+// 设置接下来要播放的地址列表，后台预加载
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_example_androidplayer_Player_nativePreload(JNIEnv *env, jobject thiz, jobjectArray urls) {
+    std::vector<std::string> list;
+    jsize count = env->GetArrayLength(urls);
+    for (jsize i = 0; i < count; i++) {
+        jstring url = (jstring)env->GetObjectArrayElement(urls, i);
+        const char* url_str = env->GetStringUTFChars(url, nullptr);
+        list.emplace_back(url_str);
+        env->ReleaseStringUTFChars(url, url_str);
+        env->DeleteLocalRef(url);
+    }
+    preloadManager.preload(list);
+}
+
+// 设置预加载的内存预算（字节）、每个条目缓存的时长（秒）和是否预解码首帧
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_example_androidplayer_Player_nativeSetPreloadOptions(JNIEnv *env, jobject thiz, jlong budget,
+                                                              jdouble seconds, jboolean decodeFirstFrame) {
+    if (budget > 0) {
+        preloadManager.setMemoryBudget((size_t)budget);
+    }
+    preloadManager.setOptions(seconds, decodeFirstFrame == JNI_TRUE);
+}
+
+// 释放所有预加载条目
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_example_androidplayer_Player_nativeClearPreload(JNIEnv *env, jobject thiz) {
+    preloadManager.clear();
+}
+
+// 设置流信息缓存目录
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_example_androidplayer_Player_nativeSetCacheDir(JNIEnv *env, jclass clazz, jstring dir) {
+    const char* dir_str = env->GetStringUTFChars(dir, nullptr);
+    StreamInfoCache::setDirectory(dir_str);
+    env->ReleaseStringUTFChars(dir, dir_str);
+}
+
+// 设置远程输入的磁盘块缓存目录与容量（字节），目录为 null 时关闭缓存
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_example_androidplayer_Player_nativeSetBlockCache(JNIEnv *env, jclass clazz, jstring dir, jlong capacity) {
+    const char* dir_str = dir ? env->GetStringUTFChars(dir, nullptr) : nullptr;
+    BlockCache::setDirectory(dir_str, capacity);
+    if (dir_str) {
+        env->ReleaseStringUTFChars(dir, dir_str);
+    }
+}
+
+// 设置远程输入的并行下载连接数与预读块数
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_example_androidplayer_Player_nativeSetRangeFetch(JNIEnv *env, jclass clazz, jint connections, jint aheadBlocks) {
+    BlockCache::setFetchOptions(connections, aheadBlocks);
+}
+
+// 选择本地文件的读取后端，取值同 FileIO::Backend，下一次打开时生效
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_example_androidplayer_Player_nativeSetIOBackend(JNIEnv *env, jclass clazz, jint backend) {
+    FileIO::setBackend((FileIO::Backend)backend);
+}
+
+// 用指定后端读取一遍文件的全部数据包，返回 {数据包数, 字节数, 耗时秒, CPU 秒}，失败返回 null
+extern "C"
+JNIEXPORT jdoubleArray JNICALL
+Java_com_example_androidplayer_Player_nativeBenchmarkIO(JNIEnv *env, jclass clazz, jstring path, jint backend) {
+    const char* path_str = env->GetStringUTFChars(path, nullptr);
+    FileIO::BenchmarkResult result;
+    int ret = FileIO::benchmark(path_str, (FileIO::Backend)backend, &result);
+    env->ReleaseStringUTFChars(path, path_str);
+    if (ret < 0) {
+        return nullptr;
+    }
+    jdouble values[4] = {(jdouble)result.packets, (jdouble)result.bytes, result.wallSeconds, result.cpuSeconds};
+    jdoubleArray array = env->NewDoubleArray(4);
+    if (array) {
+        env->SetDoubleArrayRegion(array, 0, 4, values);
+    }
+    return array;
+}
+
+// 用合成信号比较音频转换核与 swresample，返回 {转换核 ns/帧, swr ns/帧, 最大误差}，不支持的用例返回 null
+extern "C"
+JNIEXPORT jdoubleArray JNICALL
+Java_com_example_androidplayer_Player_nativeBenchmarkAudioConvert(JNIEnv *env, jclass clazz, jint benchCase, jint frames) {
+    SampleConvert::BenchmarkResult result;
+    if (SampleConvert::benchmark((SampleConvert::BenchmarkCase)benchCase, frames, &result) < 0) {
+        return nullptr;
+    }
+    jdouble values[3] = {result.fastNsPerFrame, result.swrNsPerFrame, (jdouble)result.maxDiff};
+    jdoubleArray array = env->NewDoubleArray(3);
+    if (array) {
+        env->SetDoubleArrayRegion(array, 0, 3, values);
+    }
+    return array;
+}
+
+// 设置视频帧缓冲池的内存上限（字节）
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_example_androidplayer_Player_nativeSetFramePoolLimit(JNIEnv *env, jobject thiz, jlong bytes) {
+    if (bytes > 0) {
+        framePool.setMemoryLimit((size_t)bytes);
+    }
+}
+
+// 获取管线统计快照（JSON）
+extern "C"
+JNIEXPORT jstring JNICALL
+Java_com_example_androidplayer_Player_nativeGetStats(JNIEnv *env, jobject thiz) {
+    return env->NewStringUTF(PlayerStats::snapshotJson().c_str());
+}
+
+// 设置统计快照定期写入日志的间隔，0为关闭
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_example_androidplayer_Player_nativeSetStatsDumpInterval(JNIEnv *env, jobject thiz, jint intervalMs) {
+    PlayerStats::setDumpInterval(intervalMs);
+}
+
+// 开始/停止记录 trace 事件
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_example_androidplayer_Player_nativeSetTraceEnabled(JNIEnv *env, jobject thiz, jboolean enable) {
+    if (enable) {
+        Trace::start();
+    } else {
+        Trace::stop();
+    }
+}
+
+// 把已记录的 trace 写成 Chrome JSON 文件
+extern "C"
+JNIEXPORT jint JNICALL
+Java_com_example_androidplayer_Player_nativeDumpTrace(JNIEnv *env, jobject thiz, jstring path) {
+    const char* path_str = env->GetStringUTFChars(path, nullptr);
+    int ret = Trace::dump(path_str);
+    env->ReleaseStringUTFChars(path, path_str);
+    return ret;
+}
+
+// 设置日志级别，tag 为 null 时设置全局级别
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_example_androidplayer_Player_nativeSetLogLevel(JNIEnv *env, jclass clazz, jstring tag, jint level) {
+    if (!tag) {
+        Logger::setLevel(nullptr, level);
+        return;
+    }
+    const char* tag_str = env->GetStringUTFChars(tag, nullptr);
+    Logger::setLevel(tag_str, level);
+    env->ReleaseStringUTFChars(tag, tag_str);
+}
 
 // 暂停播放
 extern "C"
 JNIEXPORT void JNICALL
 Java_com_example_androidplayer_Player_nativePause(JNIEnv *env, jobject thiz, jboolean p) {
     isPaused = (p == JNI_TRUE); // 设置暂停标志
+    if (!isPaused) {
+        pending_steps = 0;
+        stepped = false;
+    }
+    // 倒放期间音频保持暂停，倒放结束时按暂停标志恢复
+    if (!reverse_requested) {
+        audioClock.setPaused(isPaused);
+        AudioMixer::setPaused(audio_source, isPaused);
+    }
+    if (isPaused) {
+        StreamInfoCache::savePosition(currentUrl().c_str(), playback_position);
+    }
 }
 
 // 跳转播放
 extern "C"
 JNIEXPORT jint JNICALL
 Java_com_example_androidplayer_Player_nativeSeek(JNIEnv *env, jobject thiz, jdouble position) {
-    if (!fmt_ctx || position < 0)
+    if (position < 0 || (!reading && !mediaPrepared))
         return -1;
-    int64_t target_ts = (int64_t)(position * AV_TIME_BASE); // 将秒数转换为时间戳
-    // 跳转到目标位置
-    int ret = av_seek_frame(fmt_ctx, -1, target_ts, AVSEEK_FLAG_BACKWARD);
-    if (ret < 0) {
-        LOGE("跳转失败: %s", av_err2str(ret));
-        return ret;
-    }
-    // 清空解码器缓冲区
-    if (codec_ctx_video) {
-        avcodec_flush_buffers(codec_ctx_video);
-    }
+    // 交给读线程跳转：解封装上下文与解码器只在播放线程上使用，由 seekReader 清空队列并推进序号，
+    // 解码线程读到新序号时清空解码器与历史帧。已准备但未开始播放时，读线程启动后先处理这个请求。
+    // 尚未处理的逐帧请求随跳转作废
+    pending_steps = 0;
+    user_seek = true;
+    requested_seek_us = (int64_t)(position * AV_TIME_BASE);
     return 0;
 }
 
@@ -401,18 +1981,62 @@ extern "C"
 JNIEXPORT jint JNICALL
 Java_com_example_androidplayer_Player_nativeStop(JNIEnv *env, jobject thiz) {
     isStopped = true;
-    if (codec_ctx_video) {
-        avcodec_close(codec_ctx_video);
-        avcodec_free_context(&codec_ctx_video);
-        codec_ctx_video = nullptr;
-    }
-    if (fmt_ctx) {
-        avformat_close_input(&fmt_ctx);
-        fmt_ctx = nullptr;
+    // 打断进行中的准备和阻塞中的读取
+    prepareCancelled = true;
+    joinPrepareThread();
+    StreamInfoCache::savePosition(currentUrl().c_str(), playback_position);
+    // 移除本播放器的来源，没有其他来源时混音器随之关闭输出流
+    AudioMixer::removeSource(audio_source.exchange(-1));
+    // 解码器与解封装上下文由视频解码线程退出时释放，这里只等待线程结束
+    joinPlaybackThreads();
+    // 已准备完成但还没有开始播放时，资源还没有交给线程
+    if (mediaPrepared) {
+        mediaPrepared = false;
+        closeMedia();
+        std::lock_guard<std::mutex> lock(window_mutex);
+        replaceWindowLocked(nullptr);
     }
     return 0;
 }
 
+// 设置音量（0~1），经过混音器的渐变生效
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_example_androidplayer_Player_nativeSetVolume(JNIEnv *env, jobject thiz, jfloat volume) {
+    audio_volume = volume;
+    AudioMixer::setGain(audio_source, volume);
+}
+
+// 音频处理：增益（dB）
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_example_androidplayer_Player_nativeSetAudioGain(JNIEnv *env, jobject thiz, jfloat gainDb) {
+    audioDsp.setGainDb(gainDb);
+}
+
+// 音频处理：第 index 段均衡，type 取值同 AudioDsp::BandType
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_example_androidplayer_Player_nativeSetEqBand(JNIEnv *env, jobject thiz, jint index, jint type,
+                                                      jfloat freq, jfloat gainDb, jfloat q) {
+    audioDsp.setBand(index, (AudioDsp::BandType)type, freq, gainDb, q);
+}
+
+// 音频处理：前视限幅，thresholdDb 为 dBFS
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_example_androidplayer_Player_nativeSetLimiter(JNIEnv *env, jobject thiz, jboolean enabled, jfloat thresholdDb) {
+    audioDsp.setLimiter(enabled == JNI_TRUE, thresholdDb);
+}
+
+// 音频处理的耗时测试，返回每个 1024 帧块的平均纳秒数
+extern "C"
+JNIEXPORT jdouble JNICALL
+Java_com_example_androidplayer_Player_nativeBenchmarkAudioDsp(JNIEnv *env, jclass clazz, jint bands,
+                                                              jboolean limiter, jint blocks) {
+    return AudioDsp::benchmark(bands, limiter == JNI_TRUE, blocks);
+}
+
 // 设置播放速度
 extern "C"
 JNIEXPORT jint JNICALL
@@ -424,20 +2048,81 @@ Java_com_example_androidplayer_Player_nativeSetSpeed(JNIEnv *env, jobject thiz,
     return 0;
 }
 
-// 获取播放进度，存在bug
+// 倒放开关：开启后从当前帧向前倒序播放，关闭或倒放到开头后从停下的位置恢复正向播放。
+// 视频解码线程已结束（播放完毕）时返回 -1
+extern "C"
+JNIEXPORT jint JNICALL
+Java_com_example_androidplayer_Player_nativeSetReverse(JNIEnv *env, jobject thiz, jboolean reverse) {
+    if (reverse == JNI_TRUE && !videoDecoding) {
+        return -1;
+    }
+    reverse_requested = (reverse == JNI_TRUE);
+    return 0;
+}
+
+// 倒放的帧缓存上限（字节，0 为默认）；reducedResolution 为 true 时缓存的帧总是缩小到显示尺寸。下一次倒放时生效
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_example_androidplayer_Player_nativeSetReverseOptions(JNIEnv *env, jobject thiz, jlong budgetBytes,
+                                                             jboolean reducedResolution) {
+    size_t budget = ReverseDecoder::DEFAULT_MEMORY_BUDGET;
+    if (budgetBytes > 0) {
+        budget = (size_t)budgetBytes;
+    }
+    reverseDecoder.setMemoryBudget(budget);
+    reverse_reduced = (reducedResolution == JNI_TRUE);
+}
+
+// 逐帧前进（direction > 0）或后退一帧，播放中调用时先暂停。倒放期间或视频已结束时返回 -1
+extern "C"
+JNIEXPORT jint JNICALL
+Java_com_example_androidplayer_Player_nativeStep(JNIEnv *env, jobject thiz, jint direction) {
+    if (!videoDecoding || reverse_requested || direction == 0) {
+        return -1;
+    }
+    if (!isPaused) {
+        isPaused = true;
+        audioClock.setPaused(true);
+        AudioMixer::setPaused(audio_source, true);
+    }
+    stepped = true;
+    step_request_us = PlayerStats::nowUs();
+    pending_steps += direction > 0 ? 1 : -1;
+    return 0;
+}
+
+// 逐帧历史缓存的上限（字节，0 为默认，负数不缓存），下一帧上屏时生效
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_example_androidplayer_Player_nativeSetStepHistoryBudget(JNIEnv *env, jobject thiz, jlong budgetBytes) {
+    size_t budget = FrameHistory::DEFAULT_BUDGET;
+    if (budgetBytes > 0) {
+        budget = (size_t)budgetBytes;
+    } else if (budgetBytes < 0) {
+        budget = 0;
+    }
+    frameHistory.setBudget(budget);
+}
+
+// 获取播放进度：最近上屏的一帧，由解码线程维护，不访问解封装上下文（停止后和播放列表切换时同样安全）
 extern "C" JNIEXPORT jdouble JNICALL
 Java_com_example_androidplayer_Player_nativeGetPosition(JNIEnv *env, jobject thiz) {
-    int64_t position = fmt_ctx->streams[video_stream_index]->cur_dts; // 获取当前视频流的时间戳（微秒）
-    if (position == AV_NOPTS_VALUE) {// 如果获取失败，返回 -1
-        return -1.0;
+    // 后台时视频不上屏，进度取音频时钟
+    if (video_detached && !reverse_requested && !stepped) {
+        double audio_time = audioClock.now();
+        if (!std::isnan(audio_time)) {
+            playback_position = audio_time;
+            return audio_time;
+        }
     }
-    jdouble progress = position / (double)AV_TIME_BASE; // 微秒转秒
-    LOGI("nativeGetPosition: %f", progress);
-        return progress;
+    jdouble progress = playback_position;
+    LOG_EVERY_MS(1000, LOG_LEVEL_DEBUG, LOG_TAG, "nativeGetPosition: %f", progress);
+    return progress;
 }
 
 // 获取播放时长
 extern "C" JNIEXPORT jdouble JNICALL
 Java_com_example_androidplayer_Player_nativeGetDuration(JNIEnv *env, jobject thiz) {
-    return duration;
+    std::lock_guard<std::mutex> lock(snapshot_mutex);
+    return mediaSnapshot.duration;
 }
@@ -103,6 +103,8 @@ public class MainActivity extends AppCompatActivity {
         player = new Player();
         // 设置视频源
         File rootDir = Environment.getExternalStorageDirectory();
+        Player.setCacheDir(new File(getCacheDir(), "streaminfo").getAbsolutePath());
+        Player.setBlockCache(new File(getCacheDir(), "blocks").getAbsolutePath(), 512L * 1024 * 1024);
         player.setDataSource(rootDir.getAbsolutePath()  + "/kuangbiao.mp4");
         Log.d("Videopath:", rootDir.getAbsolutePath()  + "/kuangbiao.mp4");  // /storage/emulated/0/1.mp4
 
@@ -115,9 +117,11 @@ public class MainActivity extends AppCompatActivity {
             }
             @Override
             public void surfaceChanged(@NonNull SurfaceHolder holder, int format, int width, int height) {
+                player.setSurfaceSize(width, height); // 按窗口实际尺寸解码和转换
             }
             @Override
             public void surfaceDestroyed(@NonNull SurfaceHolder holder) {
+                player.detachSurface(); // 进入后台只播放音频
             }
         });
 
@@ -139,16 +143,34 @@ public class MainActivity extends AppCompatActivity {
         // 播放和暂停
         Button play = findViewById(R.id.button);
         play.setText("播放");
-        play.setOnClickListener(v -> {
-            switch (player.getState()) { // 获取当前状态转换
-                case None:
-                case End:
-                    player.start(); // 播放
+        // 异步准备的结果
+        player.setEventListener((p, what, arg1, arg2) -> {
+            switch (what) {
+                case Player.EVENT_PREPARED:
+                    p.start(); // 播放
                     ShowInfo(); // 显示视频信息
                     if (!progressThread.isAlive())
                         progressThread.start();  // 开启progressThread线程，更新进度条
                     play.setText("暂停");
                     break;
+                case Player.EVENT_ERROR:
+                    Toast.makeText(this, "打开失败：" + arg1, Toast.LENGTH_SHORT).show();
+                    play.setText("播放");
+                    break;
+                case Player.EVENT_CANCELLED:
+                    play.setText("播放");
+                    break;
+                default:
+                    break;
+            }
+        });
+        play.setOnClickListener(v -> {
+            switch (player.getState()) { // 获取当前状态转换
+                case None:
+                case End:
+                    player.prepareAsync(); // 异步打开，准备完成后在事件回调中开始播放
+                    play.setText("打开中");
+                    break;
                 case Playing:
                     player.pause(true); // 暂停
                     play.setText("播放");
@@ -24,6 +24,8 @@ public class Player {
     private long nativeContext;
     public enum PlayerState {
         None,
+        Preparing,
+        Prepared,
         Playing,
         Paused,
         End,
@@ -38,6 +40,42 @@ public class Player {
     SurfaceView surfaceView; // 用于设置宽高
     public MediaInfo mediaInfo; // 视频信息
 
+    // native 事件，与 EventQueue.h 中的 PlayerEvent 一致
+    public static final int EVENT_PREPARE_PROGRESS = 1; // arg1: 0 打开, 1 读取流信息, 2 打开解码器
+    public static final int EVENT_PREPARED = 2;
+    public static final int EVENT_ERROR = 3;            // arg1: FFmpeg 错误码
+    public static final int EVENT_CANCELLED = 4;
+    public static final int EVENT_PLAYLIST_ITEM = 5;    // arg1: 切换到的播放列表序号
+    public static final int EVENT_REVERSE_FINISHED = 6; // 倒放到开头，之后从开头正向播放
+
+    // 本地文件读取后端，与 FileIO.h 中的 Backend 一致
+    public static final int IO_BACKEND_AUTO = 0;        // 小文件 mmap，大文件预读
+    public static final int IO_BACKEND_STOCK = 1;       // FFmpeg 自带 file: 协议
+    public static final int IO_BACKEND_MMAP = 2;
+    public static final int IO_BACKEND_READAHEAD = 3;
+    // benchmarkAudioConvert 的用例，取值同 native SampleConvert::BenchmarkCase
+    public static final int CONVERT_FLTP_STEREO = 0;
+    public static final int CONVERT_S16P_STEREO = 1;
+    public static final int CONVERT_DOWNMIX_5_1 = 2;
+    public static final int CONVERT_DOWNMIX_7_1 = 3;
+    // 均衡段类型，与 AudioDsp.h 中的 BandType 一致
+    public static final int EQ_BAND_OFF = 0;
+    public static final int EQ_BAND_PEAK = 1;
+    public static final int EQ_BAND_LOW_SHELF = 2;
+    public static final int EQ_BAND_HIGH_SHELF = 3;
+    public static final int EQ_MAX_BANDS = 8;
+    // 轨道类型，与 FFmpeg 的 AVMediaType 一致
+    public static final int TRACK_VIDEO = 0;
+    public static final int TRACK_AUDIO = 1;
+    public static final int TRACK_SUBTITLE = 3;
+
+    // 事件监听，在主线程回调
+    public interface EventListener {
+        void onEvent(Player player, int what, int arg1, int arg2);
+    }
+    private EventListener eventListener;
+    private final Handler mainHandler = new Handler(Looper.getMainLooper());
+
     public void setDataSource(String uri) {
         fileUri = uri;
     }
@@ -48,8 +86,43 @@ public class Player {
 
     public void setSurface(Surface surface) {
         mSurface = surface;
+        // 准备中或播放中换上新窗口（从后台回到前台）时恢复视频
+        if (holdsWindow()) {
+            nativeAttachSurface(surface);
+        }
+    }
+    // 窗口销毁时调用：停止视频解码与渲染，只播放音频，setSurface 提供新窗口后恢复。
+    // 准备期间 native 层同样持有窗口，也要分离，否则 start 会把 EGL 绑定到已销毁的窗口
+    public void detachSurface() {
+        mSurface = null;
+        if (holdsWindow()) {
+            nativeDetachSurface();
+        }
+    }
+    // 从 prepareAsync/start 到 stop 之间 native 层持有窗口
+    private boolean holdsWindow() {
+        return mState != PlayerState.None && mState != PlayerState.End;
+    }
+    // 窗口尺寸变化时通知native层，按实际显示尺寸解码和转换
+    public void setSurfaceSize(int width, int height) {
+        nativeSetSurfaceSize(width, height);
+    }
+    public void setEventListener(EventListener listener) {
+        eventListener = listener;
+    }
+    // 异步准备，打开和探测在native线程进行，完成后通过 EVENT_PREPARED 通知，再调用 start 开始播放
+    public void prepareAsync() {
+        mState = PlayerState.Preparing;
+        if (nativePrepareAsync(fileUri, mSurface) < 0) {
+            mState = PlayerState.None;
+        }
     }
     public void start() {
+        if (mState == PlayerState.Prepared) {
+            nativeStart();
+            mState = PlayerState.Playing;
+            return;
+        }
         mediaInfo = nativePlay(fileUri, mSurface);   // debug
         mState = PlayerState.Playing;
         duration = nativeGetDuration(); // 获取视频时长
@@ -63,6 +136,11 @@ public class Player {
         }
     }
     public void stop() {
+        if (mState == PlayerState.Preparing || mState == PlayerState.Prepared) {
+            nativeCancelPrepare();
+            mState = PlayerState.End;
+            return;
+        }
         nativeStop();
         mState = PlayerState.End;
     }
@@ -78,13 +156,178 @@ public class Player {
     public void setSpeed(float speed) {
         nativeSetSpeed(speed);
     }
+    // 音频处理增益（dB），约 20ms 平滑过渡；可大于0，配合限幅使用
+    public void setAudioGain(float gainDb) {
+        nativeSetAudioGain(gainDb);
+    }
+    // 设置第 index 段（0 ~ EQ_MAX_BANDS-1）均衡：频率（Hz）、增益（dB）与 Q 值，type 为 EQ_BAND_OFF 时关闭
+    public void setEqBand(int index, int type, float freq, float gainDb, float q) {
+        nativeSetEqBand(index, type, freq, gainDb, q);
+    }
+    // 前视限幅，峰值超过 thresholdDb（dBFS）时提前压低增益
+    public void setLimiter(boolean enabled, float thresholdDb) {
+        nativeSetLimiter(enabled, thresholdDb);
+    }
+    // 音频处理的耗时测试，返回每个 1024 帧块的平均纳秒数
+    public static double benchmarkAudioDsp(int bands, boolean limiter, int blocks) {
+        return nativeBenchmarkAudioDsp(bands, limiter, blocks);
+    }
+    // 设置音量（0~1），多个播放器共用进程内的一路音频输出，各自的音量渐变生效
+    public void setVolume(float volume) {
+        nativeSetVolume(volume);
+    }
+    // 倒放：开启后从当前帧向前倒序播放（音频暂停），关闭后从停下的位置恢复正向播放；播放已结束时返回 -1
+    public int setReverse(boolean reverse) {
+        return nativeSetReverse(reverse);
+    }
+    // 倒放帧缓存的内存上限（字节，0 为默认），reducedResolution 为 true 时缓存的帧缩小到显示尺寸
+    public void setReverseOptions(long budgetBytes, boolean reducedResolution) {
+        nativeSetReverseOptions(budgetBytes, reducedResolution);
+    }
+    // 逐帧前进一帧，播放中调用时先暂停；倒放期间或播放已结束时返回 -1
+    public int stepForward() {
+        return step(1);
+    }
+    // 逐帧后退一帧，最近上屏的帧直接取缓存，更早的帧从之前的关键帧解码
+    public int stepBackward() {
+        return step(-1);
+    }
+    private int step(int direction) {
+        int ret = nativeStep(direction);
+        if (ret == 0) {
+            mState = PlayerState.Paused;
+        }
+        return ret;
+    }
+    // 逐帧历史缓存的内存上限（字节，0 为默认，负数不缓存），放不下足够帧数时缓存缩小一半的副本
+    public void setStepHistoryBudget(long budgetBytes) {
+        nativeSetStepHistoryBudget(budgetBytes);
+    }
+    // 列出媒体中的全部轨道，准备完成后可用
+    public TrackInfo[] getTracks() {
+        return nativeGetTracks();
+    }
+    // 播放中切换音轨（TrackInfo.index），只重建音频解码，视频不中断；成功返回0
+    public int selectTrack(int index) {
+        return nativeSelectTrack(index);
+    }
+    // 轨道偏好，对之后打开的媒体生效：language 如 "en"/"chi"，codec 如 "aac"，为空不限制；maxBitrate 为0不限制码率。
+    // 没有选中的轨道在解封装层丢弃，不读取数据包
+    public static void setTrackPreference(int type, String language, String codec, long maxBitrate) {
+        nativeSetTrackPreference(type, language, codec, maxBitrate);
+    }
+    // 播放列表：从列表中的当前地址开始按顺序无缝播放，下一项提前打开，crossfadeMs为音频交叉淡化时长（0为不淡化）
+    public void setPlaylist(String[] urls, int crossfadeMs) {
+        nativeSetPlaylist(urls, crossfadeMs);
+    }
+    // 短视频列表预加载：传入接下来要播放的地址，靠前的优先，后台打开并缓存开头几秒，切换时直接接管
+    public void preload(String[] urls) {
+        nativePreload(urls);
+    }
+    // budget为所有预加载条目共享的内存预算（字节），seconds为每个条目缓存的时长，decodeFirstFrame为是否预解码首帧
+    public void setPreloadOptions(long budget, double seconds, boolean decodeFirstFrame) {
+        nativeSetPreloadOptions(budget, seconds, decodeFirstFrame);
+    }
+    public void clearPreload() {
+        nativeClearPreload();
+    }
+    // 设置流信息缓存目录，再次打开同一文件时跳过流信息探测并从上次位置续播
+    public static void setCacheDir(String dir) {
+        nativeSetCacheDir(dir);
+    }
+    // 设置远程（http/https）输入的磁盘块缓存，重播和跳转时已下载的部分不再请求，dir 为 null 时关闭
+    public static void setBlockCache(String dir, long capacityBytes) {
+        nativeSetBlockCache(dir, capacityBytes);
+    }
+    // 远程输入的并行分块下载：connections 个 keep-alive 连接，读取位置之后预读 aheadBlocks 块（每块 256 KiB）
+    public static void setRangeFetch(int connections, int aheadBlocks) {
+        nativeSetRangeFetch(connections, aheadBlocks);
+    }
+    // 选择本地文件的读取后端，下一次打开时生效
+    public static void setIOBackend(int backend) {
+        nativeSetIOBackend(backend);
+    }
+    // 用指定后端读取一遍文件的全部数据包（不解码），返回 {数据包数, 字节数, 耗时秒, CPU 秒}，失败返回 null
+    public static double[] benchmarkIO(String path, int backend) {
+        return nativeBenchmarkIO(path, backend);
+    }
+    // 用合成信号比较音频转换核与 swresample（frames 帧），返回 {转换核 ns/帧, swr ns/帧, 最大误差}，不支持时返回 null
+    public static double[] benchmarkAudioConvert(int benchCase, int frames) {
+        return nativeBenchmarkAudioConvert(benchCase, frames);
+    }
+    // 快速起播：限制探测量、并行打开解码器、首帧解码后立即上屏，在 start 之前设置
+    public void setFastStart(boolean enable) {
+        nativeSetFastStart(enable);
+    }
+    // 获取native管线统计快照（JSON）：各阶段耗时分布、帧数计数、队列深度、音画偏差与启动耗时
+    public String getStats() {
+        return nativeGetStats();
+    }
+    // 定期把统计快照写入日志，intervalMs为0时关闭
+    public void setStatsDumpInterval(int intervalMs) {
+        nativeSetStatsDumpInterval(intervalMs);
+    }
+    // 设置native日志级别，tag为null时设置全局级别，级别取值同android.util.Log（VERBOSE=2 ... ERROR=6）
+    public static void setLogLevel(String tag, int level) {
+        nativeSetLogLevel(tag, level);
+    }
+    // 设置视频帧缓冲池的内存上限，超过上限的帧由FFmpeg默认分配器分配
+    public void setFramePoolLimit(long bytes) {
+        nativeSetFramePoolLimit(bytes);
+    }
+    // 记录管线 trace 事件，dumpTrace 输出 Chrome JSON，可在 chrome://tracing 或 Perfetto 中查看
+    public void startTrace() {
+        nativeSetTraceEnabled(true);
+    }
+    public void stopTrace() {
+        nativeSetTraceEnabled(false);
+    }
+    public int dumpTrace(String path) {
+        return nativeDumpTrace(path);
+    }
     public native MediaInfo nativePlay(String file, Surface surface); // private native void play(String file, Surface surface);
+    private native int nativePrepareAsync(String file, Surface surface);
+    private native int nativeStart();
+    private native void nativeCancelPrepare();
+    private native MediaInfo nativeGetMediaInfo();
+    private native TrackInfo[] nativeGetTracks();
+    private native int nativeSelectTrack(int index);
+    private static native void nativeSetTrackPreference(int type, String language, String codec, long maxBitrate);
     private native void nativePause(boolean p); // 暂停
     private native int nativeSeek(double position);
     private native int nativeStop(); // 停止
     private native int nativeSetSpeed(float speed);
+    private native int nativeSetReverse(boolean reverse);
+    private native void nativeSetReverseOptions(long budgetBytes, boolean reducedResolution);
+    private native int nativeStep(int direction);
+    private native void nativeSetStepHistoryBudget(long budgetBytes);
+    private native void nativeSetVolume(float volume);
+    private native void nativeSetAudioGain(float gainDb);
+    private native void nativeSetEqBand(int index, int type, float freq, float gainDb, float q);
+    private native void nativeSetLimiter(boolean enabled, float thresholdDb);
+    private static native double nativeBenchmarkAudioDsp(int bands, boolean limiter, int blocks);
     private native double nativeGetPosition();
     private native double nativeGetDuration();
+    private native void nativeSetSurfaceSize(int width, int height);
+    private native void nativeAttachSurface(Surface surface);
+    private native void nativeDetachSurface();
+    private native void nativeSetFastStart(boolean enable);
+    private static native void nativeSetCacheDir(String dir);
+    private static native void nativeSetBlockCache(String dir, long capacityBytes);
+    private static native void nativeSetRangeFetch(int connections, int aheadBlocks);
+    private static native void nativeSetIOBackend(int backend);
+    private static native double[] nativeBenchmarkIO(String path, int backend);
+    private static native double[] nativeBenchmarkAudioConvert(int benchCase, int frames);
+    private native void nativeSetPlaylist(String[] urls, int crossfadeMs);
+    private native void nativePreload(String[] urls);
+    private native void nativeSetPreloadOptions(long budget, double seconds, boolean decodeFirstFrame);
+    private native void nativeClearPreload();
+    private native void nativeSetFramePoolLimit(long bytes);
+    private static native void nativeSetLogLevel(String tag, int level);
+    private native String nativeGetStats();
+    private native void nativeSetStatsDumpInterval(int intervalMs);
+    private native void nativeSetTraceEnabled(boolean enable);
+    private native int nativeDumpTrace(String path);
 
 
     // 创建音频播放对象
@@ -132,6 +375,34 @@ public class Player {
         audioTrack.write(buffer, 0, length);
     }
 
+    // native 事件投递线程调用，转到主线程处理
+    private void onNativeEvent(int what, int arg1, int arg2) {
+        mainHandler.post(() -> {
+            if (what == EVENT_PREPARED) {
+                if (mState != PlayerState.Preparing) {
+                    return; // 已取消
+                }
+                mediaInfo = nativeGetMediaInfo();
+                duration = nativeGetDuration();
+                if (mediaInfo != null && surfaceView != null) {
+                    onSizeChange(mediaInfo.videoWidth, mediaInfo.videoHeight);
+                }
+                mState = PlayerState.Prepared;
+            } else if (what == EVENT_PLAYLIST_ITEM) {
+                mediaInfo = nativeGetMediaInfo();
+                duration = nativeGetDuration();
+                if (mediaInfo != null && surfaceView != null) {
+                    onSizeChange(mediaInfo.videoWidth, mediaInfo.videoHeight);
+                }
+            } else if (what == EVENT_ERROR || what == EVENT_CANCELLED) {
+                mState = PlayerState.None;
+            }
+            if (eventListener != null) {
+                eventListener.onEvent(this, what, arg1, arg2);
+            }
+        });
+    }
+
     // 用于自适应视频宽高比
     public void onSizeChange(int width, int height) { // 动态宽高比，需要debug
         float ratio = width / (float) height;
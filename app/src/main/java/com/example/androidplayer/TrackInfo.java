@@ -0,0 +1,31 @@
+package com.example.androidplayer;
+
+public class TrackInfo {
+    public int index;       // 流编号，用于 Player.selectTrack
+    public int type;        // Player.TRACK_*
+    public String language; // 没有时为空字符串
+    public String codec;    // 编码格式
+    public long bitrate;    // 未知时为0
+    public int channels;
+    public int sampleRate;
+    public int width;
+    public int height;
+    public boolean isDefault;
+    public boolean selected;
+
+    public TrackInfo(int index, int type, String language, String codec, long bitrate,
+                     int channels, int sampleRate, int width, int height,
+                     boolean isDefault, boolean selected) {
+        this.index = index;
+        this.type = type;
+        this.language = language;
+        this.codec = codec;
+        this.bitrate = bitrate;
+        this.channels = channels;
+        this.sampleRate = sampleRate;
+        this.width = width;
+        this.height = height;
+        this.isDefault = isDefault;
+        this.selected = selected;
+    }
+}
@@ -0,0 +1,116 @@
+#include <math.h>
+#include <time.h>
+#include <chrono>
+#include <thread>
+#include "AudioClock.h"
+#include "TestUtil.h"
+
+// 用 SimulatedLatencySource 代替 AAudio 时间戳驱动 AudioClock：模拟设备按采样率消费数据，
+// 检查时钟扣除了输出延迟、估计的延迟与设定一致，以及暂停时停住
+
+namespace {
+
+const int SAMPLE_RATE = 48000;
+const int LATENCY_MS = 100;
+const int CALLBACK_MS = 10;
+const double ANCHOR_PTS = 10.0;
+
+int64_t monotonicNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// 模拟的输出流：每次回调按实际经过的时间写出帧，环形缓冲区读位置与写给设备的帧数相同（没有补静音）
+struct SimulatedStream {
+    AudioClock* clock;
+    SimulatedLatencySource* source;
+    int64_t start_ns = monotonicNs();
+    int64_t written = 0;
+    int64_t last_write_ns = 0;
+
+    void callback() {
+        int64_t now_ns = monotonicNs();
+        int64_t target = (now_ns - start_ns) * SAMPLE_RATE / 1000000000;
+        if (source) {
+            source->onFramesWritten(target - written);
+        }
+        written = target;
+        last_write_ns = now_ns;
+        clock->onCallback(written, written);
+    }
+
+    // 按 duration 毫秒运行回调，期间和解码线程一样不断查询时钟
+    void run(int durationMs) {
+        auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(durationMs);
+        while (std::chrono::steady_clock::now() < end) {
+            callback();
+            clock->now();
+            std::this_thread::sleep_for(std::chrono::milliseconds(CALLBACK_MS));
+        }
+        callback();
+    }
+};
+
+void testLatencyCompensation() {
+    AudioClock clock;
+    SimulatedLatencySource source(SAMPLE_RATE, LATENCY_MS);
+    clock.reset(&source);
+    clock.setSampleRate(SAMPLE_RATE);
+    clock.setAnchor(0, ANCHOR_PTS);
+    SimulatedStream stream{&clock, &source};
+    stream.run(500);
+
+    double value = clock.now();
+    // 正在被听到的是 LATENCY_MS 之前写出的帧，写出之后按采样率继续推进
+    double since_write = (monotonicNs() - stream.last_write_ns) / 1e9;
+    double expected = ANCHOR_PTS + (double)stream.written / SAMPLE_RATE - LATENCY_MS / 1000.0 + since_write;
+    printf("补偿延迟：时钟 %.4f，期望 %.4f，估计延迟 %lld us\n", value, expected, (long long)clock.latencyUs());
+    CHECK(fabs(value - expected) < 0.005);
+    // 估计的延迟为设定延迟减去距上次写出的时间，不超过一个回调周期
+    CHECK(clock.latencyUs() <= LATENCY_MS * 1000);
+    CHECK(clock.latencyUs() >= (LATENCY_MS - 3 * CALLBACK_MS) * 1000);
+}
+
+void testWithoutSource() {
+    AudioClock clock;
+    clock.reset(nullptr);
+    clock.setSampleRate(SAMPLE_RATE);
+    clock.setAnchor(0, ANCHOR_PTS);
+    SimulatedStream stream{&clock, nullptr};
+    stream.run(300);
+
+    // 没有呈现来源时不计输出延迟，时钟就是环形缓冲区的读位置
+    double value = clock.now();
+    double expected = ANCHOR_PTS + (double)stream.written / SAMPLE_RATE;
+    CHECK(fabs(value - expected) < 0.005);
+    CHECK(clock.latencyUs() == 0);
+}
+
+void testPaused() {
+    AudioClock clock;
+    SimulatedLatencySource source(SAMPLE_RATE, LATENCY_MS);
+    clock.reset(&source);
+    clock.setSampleRate(SAMPLE_RATE);
+    clock.setAnchor(0, ANCHOR_PTS);
+    SimulatedStream stream{&clock, &source};
+    stream.run(300);
+
+    clock.setPaused(true);
+    double paused = clock.now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    CHECK(clock.now() == paused);
+    CHECK(fabs(clock.mediaTimeAt(stream.written) - (ANCHOR_PTS + (double)stream.written / SAMPLE_RATE)) < 1e-9);
+    clock.setPaused(false);
+    CHECK(!isnan(clock.now()));
+}
+
+}
+
+int main() {
+    testLatencyCompensation();
+    testWithoutSource();
+    testPaused();
+    printf("AudioClockTest 通过\n");
+    return 0;
+}
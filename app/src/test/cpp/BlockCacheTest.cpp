@@ -0,0 +1,119 @@
+#include <string.h>
+#include <chrono>
+#include <thread>
+#include "BlockCache.h"
+#include "HttpTestServer.h"
+#include "TestUtil.h"
+
+// BlockCache 对本地源站的读取：冷读取内容一致、再次打开全部命中、预读失败的块在读到时重新下载，
+// 不支持范围请求的源站不缓存，交回 FFmpeg http 顺序读取
+
+namespace {
+
+const int BLOCK_SIZE = 256 * 1024;
+const int64_t FILE_SIZE = 16 * BLOCK_SIZE + 12345;
+const AVIOInterruptCB NO_INTERRUPT = {nullptr, nullptr};
+
+std::vector<uint8_t> readAll(AVIOContext* pb) {
+    std::vector<uint8_t> out;
+    uint8_t buf[100 * 1024];
+    int n;
+    while ((n = avio_read(pb, buf, sizeof(buf))) > 0) {
+        out.insert(out.end(), buf, buf + n);
+    }
+    return out;
+}
+
+void testColdRead(HttpTestServer& server, const std::vector<uint8_t>& data) {
+    std::string url = server.url("/media.bin");
+    AVIOContext* pb = BlockCache::open(url.c_str(), &NO_INTERRUPT);
+    CHECK(pb != nullptr);
+    CHECK(BlockCache::owns(pb));
+    CHECK(avio_size(pb) == FILE_SIZE);
+    // 同一 URL 正在使用时不允许重复打开
+    CHECK(BlockCache::open(url.c_str(), &NO_INTERRUPT) == nullptr);
+    CHECK(readAll(pb) == data);
+
+    // 跳转后读到的内容与源数据一致
+    int64_t offset = 11 * BLOCK_SIZE - 100;
+    uint8_t buf[300];
+    CHECK(avio_seek(pb, offset, SEEK_SET) == offset);
+    CHECK(avio_read(pb, buf, sizeof(buf)) == (int)sizeof(buf));
+    CHECK(memcmp(buf, data.data() + offset, sizeof(buf)) == 0);
+    BlockCache::close(&pb);
+    CHECK(pb == nullptr);
+}
+
+void testWarmRead(HttpTestServer& server, const std::vector<uint8_t>& data) {
+    int requests = server.requests();
+    std::string url = server.url("/media.bin");
+    AVIOContext* pb = BlockCache::open(url.c_str(), &NO_INTERRUPT);
+    CHECK(pb != nullptr);
+    CHECK(readAll(pb) == data);
+    BlockCache::close(&pb);
+    // 所有块都已缓存，不产生任何请求
+    CHECK(server.requests() == requests);
+}
+
+void testRetryAfterFailedPrefetch(HttpTestServer& server, const std::vector<uint8_t>& data) {
+    server.failNextRequestCovering(5 * BLOCK_SIZE + 100, 503);
+    std::string url = server.url("/retry.bin");
+    AVIOContext* pb = BlockCache::open(url.c_str(), &NO_INTERRUPT);
+    CHECK(pb != nullptr);
+
+    // 读第一块，之后的预读窗口中覆盖该偏移的请求失败
+    uint8_t first;
+    CHECK(avio_read(pb, &first, 1) == 1);
+    CHECK(first == data[0]);
+    auto begin = std::chrono::steady_clock::now();
+    while (server.failures() == 0 && TestUtil::elapsedMs(begin) < 5000) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    CHECK(server.failures() == 1);
+    // 等下载线程把错误交给缓存
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+
+    // 直接跳到失败的块读取，应重新下载成功，而不是返回之前预读留下的错误
+    int64_t failed = server.lastFailedStart() / BLOCK_SIZE;
+    std::vector<uint8_t> block(BLOCK_SIZE);
+    CHECK(avio_seek(pb, failed * BLOCK_SIZE, SEEK_SET) == failed * BLOCK_SIZE);
+    CHECK(avio_read(pb, block.data(), BLOCK_SIZE) == BLOCK_SIZE);
+    CHECK(memcmp(block.data(), data.data() + failed * BLOCK_SIZE, BLOCK_SIZE) == 0);
+    BlockCache::close(&pb);
+}
+
+void testNonRangeOrigin(HttpTestServer& server, const std::vector<uint8_t>& data) {
+    server.setRangeSupport(false);
+    std::string url = server.url("/plain.bin");
+    // 源站忽略 Range 时不建立缓存条目，FileIO 据此改用 avformat_open_input
+    CHECK(BlockCache::open(url.c_str(), &NO_INTERRUPT) == nullptr);
+    AVIOContext* pb = nullptr;
+    CHECK(avio_open2(&pb, url.c_str(), AVIO_FLAG_READ, &NO_INTERRUPT, nullptr) >= 0);
+    CHECK(readAll(pb) == data);
+    avio_closep(&pb);
+    // 同一地址之后仍然不走缓存
+    CHECK(BlockCache::open(url.c_str(), &NO_INTERRUPT) == nullptr);
+    server.setRangeSupport(true);
+}
+
+}
+
+int main() {
+    avformat_network_init();
+    std::vector<uint8_t> data = TestUtil::randomBytes(FILE_SIZE, 39);
+    HttpTestServer server(data);
+    CHECK(server.start());
+    std::string dir = TestUtil::makeTempDir("blockcache");
+    BlockCache::setDirectory(dir.c_str(), 64 * 1024 * 1024);
+    BlockCache::setFetchOptions(4, 8);
+
+    testColdRead(server, data);
+    testWarmRead(server, data);
+    testRetryAfterFailedPrefetch(server, data);
+    testNonRangeOrigin(server, data);
+
+    server.stop();
+    TestUtil::removeDir(dir);
+    printf("BlockCacheTest 通过\n");
+    return 0;
+}
@@ -0,0 +1,193 @@
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include "BlockCache.h"
+#include "FileIO.h"
+#include "HttpTestServer.h"
+#include "TestUtil.h"
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+}
+
+// 限速、高延迟的本地源站上，比较直接用 FFmpeg http 打开与经过 BlockCache 打开的首帧耗时。
+// 素材是 moov 在文件尾的 MP4：直接打开要依次请求文件头、文件尾、再回到数据起点，
+// 块缓存把文件尾与文件头并行下载，再次打开时全部命中。同时检查下载连接是否被复用
+
+namespace {
+
+const int WIDTH = 640;
+const int HEIGHT = 360;
+const int FRAME_RATE = 25;
+const int FRAMES = 8 * FRAME_RATE;
+const int LATENCY_MS = 300;
+const int64_t BYTES_PER_SECOND = 8 * 1024 * 1024;
+const int CONNECTIONS = 4;
+
+// 用 mpeg4 编码噪声画面，写出 moov 在文件尾（非 faststart）的 MP4
+std::vector<uint8_t> makeMp4(const std::string& path) {
+    AVFormatContext* oc = nullptr;
+    CHECK(avformat_alloc_output_context2(&oc, nullptr, "mp4", path.c_str()) >= 0);
+    const AVCodec* codec = avcodec_find_encoder(AV_CODEC_ID_MPEG4);
+    CHECK(codec != nullptr);
+    AVStream* stream = avformat_new_stream(oc, nullptr);
+    AVCodecContext* enc = avcodec_alloc_context3(codec);
+    CHECK(stream != nullptr && enc != nullptr);
+    enc->width = WIDTH;
+    enc->height = HEIGHT;
+    enc->pix_fmt = AV_PIX_FMT_YUV420P;
+    enc->time_base = {1, FRAME_RATE};
+    enc->framerate = {FRAME_RATE, 1};
+    enc->gop_size = FRAME_RATE;
+    enc->bit_rate = 6000000;
+    if (oc->oformat->flags & AVFMT_GLOBALHEADER) {
+        enc->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    }
+    CHECK(avcodec_open2(enc, codec, nullptr) >= 0);
+    CHECK(avcodec_parameters_from_context(stream->codecpar, enc) >= 0);
+    stream->time_base = enc->time_base;
+    CHECK(avio_open(&oc->pb, path.c_str(), AVIO_FLAG_WRITE) >= 0);
+    CHECK(avformat_write_header(oc, nullptr) >= 0);
+
+    AVFrame* frame = av_frame_alloc();
+    AVPacket* pkt = av_packet_alloc();
+    frame->format = enc->pix_fmt;
+    frame->width = WIDTH;
+    frame->height = HEIGHT;
+    CHECK(av_frame_get_buffer(frame, 0) >= 0);
+    uint32_t state = 1;
+    for (int i = 0; i <= FRAMES; i++) {
+        AVFrame* input = nullptr;
+        if (i < FRAMES) {
+            CHECK(av_frame_make_writable(frame) >= 0);
+            for (int plane = 0; plane < 3; plane++) {
+                int h = plane ? HEIGHT / 2 : HEIGHT;
+                int w = plane ? WIDTH / 2 : WIDTH;
+                for (int y = 0; y < h; y++) {
+                    uint8_t* row = frame->data[plane] + y * frame->linesize[plane];
+                    for (int x = 0; x < w; x++) {
+                        state = state * 1664525u + 1013904223u;
+                        row[x] = (uint8_t)(state >> 24);
+                    }
+                }
+            }
+            frame->pts = i;
+            input = frame;
+        }
+        CHECK(avcodec_send_frame(enc, input) >= 0);
+        while (avcodec_receive_packet(enc, pkt) == 0) {
+            av_packet_rescale_ts(pkt, enc->time_base, stream->time_base);
+            pkt->stream_index = stream->index;
+            CHECK(av_interleaved_write_frame(oc, pkt) >= 0);
+        }
+    }
+    CHECK(av_write_trailer(oc) >= 0);
+    av_packet_free(&pkt);
+    av_frame_free(&frame);
+    avcodec_free_context(&enc);
+    avio_closep(&oc->pb);
+    avformat_free_context(oc);
+
+    FILE* fp = fopen(path.c_str(), "rb");
+    CHECK(fp != nullptr);
+    std::vector<uint8_t> data;
+    uint8_t buf[64 * 1024];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) {
+        data.insert(data.end(), buf, buf + n);
+    }
+    fclose(fp);
+    return data;
+}
+
+int64_t findAtom(const std::vector<uint8_t>& data, const char* type) {
+    const uint8_t* begin = data.data();
+    const uint8_t* end = begin + data.size();
+    const uint8_t* found = std::search(begin, end, type, type + 4);
+    return found == end ? -1 : found - begin;
+}
+
+// 打开输入直到解码出第一帧视频，返回耗时（毫秒）。readAll 时之后再读完所有数据包
+double openToFirstFrame(const std::string& url, bool cached, bool readAll) {
+    auto begin = std::chrono::steady_clock::now();
+    AVFormatContext* ctx = nullptr;
+    int ret = cached ? FileIO::openInput(&ctx, url.c_str(), nullptr)
+                     : avformat_open_input(&ctx, url.c_str(), nullptr, nullptr);
+    CHECK(ret >= 0);
+    CHECK(!cached || BlockCache::owns(ctx->pb));
+    CHECK(avformat_find_stream_info(ctx, nullptr) >= 0);
+    int index = av_find_best_stream(ctx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    CHECK(index >= 0);
+    const AVCodec* codec = avcodec_find_decoder(ctx->streams[index]->codecpar->codec_id);
+    AVCodecContext* dec = avcodec_alloc_context3(codec);
+    CHECK(dec != nullptr);
+    CHECK(avcodec_parameters_to_context(dec, ctx->streams[index]->codecpar) >= 0);
+    CHECK(avcodec_open2(dec, codec, nullptr) >= 0);
+
+    AVPacket* pkt = av_packet_alloc();
+    AVFrame* frame = av_frame_alloc();
+    bool decoded = false;
+    while (!decoded && av_read_frame(ctx, pkt) >= 0) {
+        if (pkt->stream_index == index && avcodec_send_packet(dec, pkt) >= 0) {
+            decoded = avcodec_receive_frame(dec, frame) == 0;
+        }
+        av_packet_unref(pkt);
+    }
+    CHECK(decoded);
+    double elapsed = TestUtil::elapsedMs(begin);
+    if (readAll) {
+        while (av_read_frame(ctx, pkt) >= 0) {
+            av_packet_unref(pkt);
+        }
+    }
+    av_frame_free(&frame);
+    av_packet_free(&pkt);
+    avcodec_free_context(&dec);
+    if (cached) {
+        FileIO::closeInput(&ctx);
+    } else {
+        avformat_close_input(&ctx);
+    }
+    return elapsed;
+}
+
+}
+
+int main() {
+    avformat_network_init();
+    std::string dir = TestUtil::makeTempDir("firstframe");
+    std::vector<uint8_t> data = makeMp4(dir + "/source.mp4");
+    int64_t mdat = findAtom(data, "mdat");
+    int64_t moov = findAtom(data, "moov");
+    CHECK(mdat > 0 && moov > mdat);
+    printf("素材 %zu 字节，moov 位于 %lld\n", data.size(), (long long)moov);
+
+    HttpTestServer server(data);
+    CHECK(server.start());
+    server.setThrottle(BYTES_PER_SECOND, LATENCY_MS);
+    std::string url = server.url("/source.mp4");
+
+    double direct = openToFirstFrame(url, false, false);
+
+    BlockCache::setDirectory((dir + "/cache").c_str(), 256 * 1024 * 1024);
+    BlockCache::setFetchOptions(CONNECTIONS, 8);
+    int connections = server.connections();
+    int requests = server.requests();
+    double cold = openToFirstFrame(url, true, true);
+    connections = server.connections() - connections;
+    requests = server.requests() - requests;
+    double warm = openToFirstFrame(url, true, false);
+
+    printf("首帧耗时：直接打开 %.0f ms，块缓存首次 %.0f ms，再次打开 %.0f ms\n", direct, cold, warm);
+    printf("读完整个文件：%d 个连接，%d 个请求\n", connections, requests);
+    CHECK(cold < direct);
+    CHECK(warm < direct / 2);
+    // 探测大小的连接加上每个下载线程一个连接，之后的请求都沿用这些连接
+    CHECK(connections <= CONNECTIONS + 1);
+    CHECK(requests > connections * 2);
+
+    server.stop();
+    TestUtil::removeDir(dir);
+    printf("FirstFrameTest 通过\n");
+    return 0;
+}
@@ -0,0 +1,256 @@
+#include "HttpTestServer.h"
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+const int SEND_CHUNK = 16 * 1024;
+
+const char* reasonPhrase(int status) {
+    switch (status) {
+        case 200: return "OK";
+        case 206: return "Partial Content";
+        case 404: return "Not Found";
+        case 416: return "Range Not Satisfiable";
+        case 500: return "Internal Server Error";
+        case 503: return "Service Unavailable";
+        default: return "Error";
+    }
+}
+
+bool sendAll(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+// 取请求头中某一字段的值（不区分大小写），没有时返回空串
+std::string headerValue(const std::string& head, const char* name) {
+    size_t name_len = strlen(name);
+    size_t pos = head.find("\r\n");
+    while (pos != std::string::npos && pos + 2 < head.size()) {
+        size_t line = pos + 2;
+        size_t end = head.find("\r\n", line);
+        if (end == std::string::npos) {
+            break;
+        }
+        if (end - line > name_len && head[line + name_len] == ':'
+            && strncasecmp(head.c_str() + line, name, name_len) == 0) {
+            size_t value = line + name_len + 1;
+            while (value < end && head[value] == ' ') {
+                value++;
+            }
+            return head.substr(value, end - value);
+        }
+        pos = end;
+    }
+    return "";
+}
+
+}
+
+HttpTestServer::HttpTestServer(std::vector<uint8_t> body) : body(std::move(body)) {
+}
+
+HttpTestServer::~HttpTestServer() {
+    stop();
+}
+
+bool HttpTestServer::start() {
+    listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        return false;
+    }
+    int on = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    socklen_t addr_len = sizeof(addr);
+    if (bind(listen_fd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listen_fd, 16) != 0
+        || getsockname(listen_fd, (sockaddr*)&addr, &addr_len) != 0) {
+        close(listen_fd);
+        listen_fd = -1;
+        return false;
+    }
+    port = ntohs(addr.sin_port);
+    acceptor = std::thread(&HttpTestServer::acceptLoop, this);
+    return true;
+}
+
+void HttpTestServer::stop() {
+    if (listen_fd < 0) {
+        return;
+    }
+    stopping = true;
+    shutdown(listen_fd, SHUT_RDWR);
+    acceptor.join();
+    close(listen_fd);
+    listen_fd = -1;
+    {
+        std::lock_guard<std::mutex> lock(clients_mutex);
+        for (int fd : client_fds) {
+            shutdown(fd, SHUT_RDWR);
+        }
+    }
+    for (std::thread& client : clients) {
+        client.join();
+    }
+    clients.clear();
+}
+
+std::string HttpTestServer::url(const char* path) const {
+    return "http://127.0.0.1:" + std::to_string(port) + path;
+}
+
+void HttpTestServer::setThrottle(int64_t bytesPerSecond, int latencyMs) {
+    bytes_per_second = bytesPerSecond;
+    latency_ms = latencyMs;
+}
+
+void HttpTestServer::failNextRequestCovering(int64_t offset, int status) {
+    fail_status = status;
+    fail_offset = offset;
+}
+
+void HttpTestServer::setRangeSupport(bool enabled) {
+    range_support = enabled;
+}
+
+void HttpTestServer::acceptLoop() {
+    while (!stopping) {
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) {
+            if (stopping) {
+                break;
+            }
+            continue;
+        }
+        connection_count++;
+        std::lock_guard<std::mutex> lock(clients_mutex);
+        client_fds.insert(fd);
+        clients.emplace_back(&HttpTestServer::serve, this, fd);
+    }
+}
+
+// 按连接限速发送 [start, start + len)，对端提前关闭时返回 false
+bool HttpTestServer::sendBody(int fd, int64_t start, int64_t len) {
+    auto begin = std::chrono::steady_clock::now();
+    int64_t sent = 0;
+    while (sent < len && !stopping) {
+        int chunk = (int)std::min<int64_t>(SEND_CHUNK, len - sent);
+        if (!sendAll(fd, (const char*)body.data() + start + sent, chunk)) {
+            return false;
+        }
+        sent += chunk;
+        int64_t rate = bytes_per_second;
+        if (rate > 0) {
+            std::this_thread::sleep_until(begin + std::chrono::microseconds(sent * 1000000 / rate));
+        }
+    }
+    return sent == len;
+}
+
+void HttpTestServer::serve(int fd) {
+    std::string pending;
+    char buf[4096];
+    int64_t size = (int64_t)body.size();
+    while (!stopping) {
+        size_t head_end;
+        while ((head_end = pending.find("\r\n\r\n")) == std::string::npos) {
+            ssize_t n = recv(fd, buf, sizeof(buf), 0);
+            if (n <= 0) {
+                head_end = std::string::npos;
+                break;
+            }
+            pending.append(buf, n);
+        }
+        if (head_end == std::string::npos) {
+            break;
+        }
+        std::string head = pending.substr(0, head_end + 2);
+        pending.erase(0, head_end + 4);
+        request_count++;
+        if (latency_ms > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(latency_ms));
+        }
+
+        bool is_head = head.compare(0, 5, "HEAD ") == 0;
+        bool keep_alive = strcasecmp(headerValue(head, "Connection").c_str(), "close") != 0;
+        std::string range = headerValue(head, "Range");
+        int64_t start = 0;
+        int64_t end = size - 1;
+        int status = 200;
+        if (!range.empty() && range_support) {
+            long long first = 0;
+            long long last = -1;
+            int fields = sscanf(range.c_str(), "bytes=%lld-%lld", &first, &last);
+            if (fields < 1) {
+                first = 0;
+            }
+            start = first;
+            end = fields == 2 ? std::min<int64_t>(last, size - 1) : size - 1;
+            status = 206;
+        }
+
+        char header[512];
+        int header_len;
+        int64_t fail_at = fail_offset;
+        if (start >= size || end < start) {
+            header_len = snprintf(header, sizeof(header),
+                    "HTTP/1.1 416 %s\r\nContent-Range: bytes */%lld\r\nContent-Length: 0\r\n\r\n",
+                    reasonPhrase(416), (long long)size);
+            if (!sendAll(fd, header, header_len)) {
+                break;
+            }
+            continue;
+        }
+        if (fail_at > 0 && start > 0 && start <= fail_at && fail_at <= end
+            && fail_offset.compare_exchange_strong(fail_at, -1)) {
+            failed_start = start;
+            failure_count++;
+            header_len = snprintf(header, sizeof(header), "HTTP/1.1 %d %s\r\nContent-Length: 0\r\n\r\n",
+                    (int)fail_status, reasonPhrase(fail_status));
+            if (!sendAll(fd, header, header_len)) {
+                break;
+            }
+            continue;
+        }
+        int64_t len = end - start + 1;
+        if (status == 206) {
+            header_len = snprintf(header, sizeof(header),
+                    "HTTP/1.1 206 %s\r\nContent-Type: application/octet-stream\r\nAccept-Ranges: bytes\r\n"
+                    "Content-Range: bytes %lld-%lld/%lld\r\nContent-Length: %lld\r\nConnection: %s\r\n\r\n",
+                    reasonPhrase(206), (long long)start, (long long)end, (long long)size, (long long)len,
+                    keep_alive ? "keep-alive" : "close");
+        } else {
+            header_len = snprintf(header, sizeof(header),
+                    "HTTP/1.1 200 %s\r\nContent-Type: application/octet-stream\r\n%s"
+                    "Content-Length: %lld\r\nConnection: %s\r\n\r\n",
+                    reasonPhrase(200), range_support ? "Accept-Ranges: bytes\r\n" : "",
+                    (long long)len, keep_alive ? "keep-alive" : "close");
+        }
+        if (!sendAll(fd, header, header_len) || (!is_head && !sendBody(fd, start, len)) || !keep_alive) {
+            break;
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(clients_mutex);
+        client_fds.erase(fd);
+    }
+    close(fd);
+}
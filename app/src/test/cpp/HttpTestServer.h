@@ -0,0 +1,66 @@
+#ifndef ANDROIDPLAYER_HTTPTESTSERVER_H
+#define ANDROIDPLAYER_HTTPTESTSERVER_H
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 测试用的本地 HTTP/1.1 源站：任意路径都返回同一段内存数据，支持 Range（可关闭）与 keep-alive。
+// 可为每个请求加固定延迟、按连接限速，模拟移动网络；可让下一个覆盖某偏移的请求返回错误状态。
+// 记录建立的连接数和请求数，用来检查连接是否被复用
+class HttpTestServer {
+public:
+    explicit HttpTestServer(std::vector<uint8_t> body);
+    ~HttpTestServer();
+
+    // 监听 127.0.0.1 的随机端口
+    bool start();
+    void stop();
+
+    std::string url(const char* path) const;
+
+    // 每个请求在响应前等待 latencyMs 毫秒，响应体按每连接 bytesPerSecond 限速，0 表示不限速
+    void setThrottle(int64_t bytesPerSecond, int latencyMs);
+
+    // 下一个范围覆盖 offset 且不从 0 开始的请求返回 status（空响应体，连接保持）
+    void failNextRequestCovering(int64_t offset, int status);
+
+    // 关闭后忽略 Range，总是以 200 返回完整数据且不带 Accept-Ranges，模拟不支持范围请求的源站
+    void setRangeSupport(bool enabled);
+
+    int connections() const { return connection_count; }
+    int requests() const { return request_count; }
+    int failures() const { return failure_count; }
+    // 最近一次按 failNextRequestCovering 返回错误的请求的起始偏移
+    int64_t lastFailedStart() const { return failed_start; }
+
+private:
+    void acceptLoop();
+    void serve(int fd);
+    bool sendBody(int fd, int64_t start, int64_t len);
+
+    std::vector<uint8_t> body;
+    int listen_fd = -1;
+    int port = 0;
+    std::atomic<bool> stopping{false};
+    std::atomic<int64_t> bytes_per_second{0};
+    std::atomic<int> latency_ms{0};
+    std::atomic<bool> range_support{true};
+    std::atomic<int64_t> fail_offset{-1};
+    std::atomic<int> fail_status{0};
+    std::atomic<int64_t> failed_start{-1};
+    std::atomic<int> connection_count{0};
+    std::atomic<int> request_count{0};
+    std::atomic<int> failure_count{0};
+
+    std::thread acceptor;
+    std::mutex clients_mutex;
+    std::set<int> client_fds;
+    std::vector<std::thread> clients;
+};
+
+#endif //ANDROIDPLAYER_HTTPTESTSERVER_H
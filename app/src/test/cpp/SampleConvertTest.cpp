@@ -0,0 +1,132 @@
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <vector>
+#include "SampleConvert.h"
+#include "TestUtil.h"
+extern "C" {
+#include <libavutil/channel_layout.h>
+#include <libavutil/samplefmt.h>
+#include <libswresample/swresample.h>
+}
+
+// 转换核与 swr 的输出对比：fltp/s16p 立体声必须逐位一致，5.1/7.1 下混误差不超过 1 LSB。
+// 向量路径随主机而定（x86 为 SSE2，arm64 为 NEON，可交叉编译后用 CMAKE_CROSSCOMPILING_EMULATOR 运行）；
+// 按长短不一的分段转换，同时覆盖向量循环、标量尾部和不对齐的起始位置
+
+namespace {
+
+const int RATE = 48000;
+const int FRAMES = RATE + 5;
+// 分段长度：短于向量宽度的段只走标量，其余段带不同长度的尾部
+const int CHUNKS[] = {1, 3, 7, 8, 9, 15, 16, 17, 64, 255, 1024};
+
+struct Case {
+    const char* name;
+    AVSampleFormat format;
+    uint64_t layout;
+    SampleConvert::Kernel kernel;
+    int max_diff;
+};
+
+// 输入混合了普通幅度、正好落在半个 LSB 上的值（检查就近取偶）、满幅与超出满幅的值
+std::vector<std::vector<uint8_t>> makeInput(AVSampleFormat format, int channels, uint32_t seed) {
+    int bytes = av_get_bytes_per_sample(format);
+    std::vector<std::vector<uint8_t>> planes(channels, std::vector<uint8_t>((size_t)FRAMES * bytes));
+    uint32_t state = seed;
+    auto next = [&state]() {
+        state = state * 1664525u + 1013904223u;
+        return state;
+    };
+    for (int ch = 0; ch < channels; ch++) {
+        for (int i = 0; i < FRAMES; i++) {
+            if (format == AV_SAMPLE_FMT_S16P) {
+                ((int16_t*)planes[ch].data())[i] = (int16_t)(next() >> 16);
+                continue;
+            }
+            float v;
+            switch (next() % 4) {
+                case 0: v = ((int)(next() % 65536) - 32768 + 0.5f) / 32768.0f; break;
+                case 1: v = (next() % 2 ? 1.0f : -1.0f) * (1.0f + (next() % 1000) / 2000.0f); break;
+                default: v = ((int64_t)(next() >> 8) - (1 << 23)) / (float)(1 << 23) * 1.1f; break;
+            }
+            ((float*)planes[ch].data())[i] = v;
+        }
+    }
+    return planes;
+}
+
+std::vector<int16_t> convertWithSwr(const Case& c, const std::vector<const uint8_t*>& in) {
+    SwrContext* swr = swr_alloc_set_opts(nullptr, AV_CH_LAYOUT_STEREO, AV_SAMPLE_FMT_S16, RATE,
+                                         c.layout, c.format, RATE, 0, nullptr);
+    CHECK(swr != nullptr && swr_init(swr) >= 0);
+    std::vector<int16_t> out((size_t)FRAMES * 2);
+    uint8_t* dst = (uint8_t*)out.data();
+    std::vector<const uint8_t*> src = in;
+    CHECK(swr_convert(swr, &dst, FRAMES, src.data(), FRAMES) == FRAMES);
+    swr_free(&swr);
+    return out;
+}
+
+std::vector<int16_t> convertWithKernel(const SampleConvert::Plan& plan, const std::vector<const uint8_t*>& in) {
+    std::vector<int16_t> out((size_t)FRAMES * 2);
+    size_t next_chunk = 0;
+    for (int offset = 0; offset < FRAMES;) {
+        int frames = std::min(CHUNKS[next_chunk++ % (sizeof(CHUNKS) / sizeof(CHUNKS[0]))], FRAMES - offset);
+        SampleConvert::run(plan, in.data(), offset, out.data() + (size_t)offset * 2, frames);
+        offset += frames;
+    }
+    return out;
+}
+
+void testCase(const Case& c) {
+    int channels = av_get_channel_layout_nb_channels(c.layout);
+    SampleConvert::Plan plan = SampleConvert::choose(c.format, c.layout, channels, RATE, RATE);
+    CHECK(plan.kernel == c.kernel);
+
+    std::vector<std::vector<uint8_t>> planes = makeInput(c.format, channels, 44);
+    std::vector<const uint8_t*> in(channels);
+    for (int ch = 0; ch < channels; ch++) {
+        in[ch] = planes[ch].data();
+    }
+    std::vector<int16_t> ref = convertWithSwr(c, in);
+    std::vector<int16_t> fast = convertWithKernel(plan, in);
+    int max_diff = 0;
+    for (size_t i = 0; i < ref.size(); i++) {
+        max_diff = std::max(max_diff, abs(fast[i] - ref[i]));
+    }
+    printf("%s：与 swr 最大误差 %d LSB\n", c.name, max_diff);
+    CHECK(max_diff <= c.max_diff);
+
+    // 内置测试的合成信号同样满足误差要求
+    SampleConvert::BenchmarkCase bench = c.kernel == SampleConvert::KERNEL_FLTP_STEREO ? SampleConvert::BENCH_FLTP_STEREO
+            : c.kernel == SampleConvert::KERNEL_S16P_STEREO ? SampleConvert::BENCH_S16P_STEREO
+            : c.layout == AV_CH_LAYOUT_7POINT1 ? SampleConvert::BENCH_DOWNMIX_7_1 : SampleConvert::BENCH_DOWNMIX_5_1;
+    SampleConvert::BenchmarkResult result;
+    CHECK(SampleConvert::benchmark(bench, FRAMES, &result) == 0);
+    CHECK(result.maxDiff <= c.max_diff);
+}
+
+}
+
+int main() {
+#if defined(__SSE2__)
+    printf("向量路径：SSE2\n");
+#elif defined(__aarch64__)
+    printf("向量路径：NEON\n");
+#else
+    printf("向量路径：无（标量）\n");
+#endif
+    const Case cases[] = {
+        {"fltp 立体声", AV_SAMPLE_FMT_FLTP, AV_CH_LAYOUT_STEREO, SampleConvert::KERNEL_FLTP_STEREO, 0},
+        {"s16p 立体声", AV_SAMPLE_FMT_S16P, AV_CH_LAYOUT_STEREO, SampleConvert::KERNEL_S16P_STEREO, 0},
+        {"fltp 5.1 下混", AV_SAMPLE_FMT_FLTP, AV_CH_LAYOUT_5POINT1, SampleConvert::KERNEL_FLTP_DOWNMIX, 1},
+        {"fltp 5.1(back) 下混", AV_SAMPLE_FMT_FLTP, AV_CH_LAYOUT_5POINT1_BACK, SampleConvert::KERNEL_FLTP_DOWNMIX, 1},
+        {"fltp 7.1 下混", AV_SAMPLE_FMT_FLTP, AV_CH_LAYOUT_7POINT1, SampleConvert::KERNEL_FLTP_DOWNMIX, 1},
+    };
+    for (const Case& c : cases) {
+        testCase(c);
+    }
+    printf("SampleConvertTest 通过\n");
+    return 0;
+}
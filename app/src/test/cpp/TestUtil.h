@@ -0,0 +1,53 @@
+#ifndef ANDROIDPLAYER_TESTUTIL_H
+#define ANDROIDPLAYER_TESTUTIL_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+// 主机测试的断言：失败时打印位置并以非零码退出，ctest 据此判定失败
+#define CHECK(cond)                                                                 \
+    do {                                                                            \
+        if (!(cond)) {                                                              \
+            fprintf(stderr, "%s:%d: 检查失败：%s\n", __FILE__, __LINE__, #cond);      \
+            exit(1);                                                                \
+        }                                                                           \
+    } while (0)
+
+namespace TestUtil {
+    // 每次运行内容相同的伪随机数据
+    inline std::vector<uint8_t> randomBytes(size_t size, uint32_t seed) {
+        std::vector<uint8_t> data(size);
+        uint32_t state = seed;
+        for (size_t i = 0; i < size; i++) {
+            state = state * 1664525u + 1013904223u;
+            data[i] = (uint8_t)(state >> 24);
+        }
+        return data;
+    }
+
+    // 在 /tmp 下新建空目录
+    inline std::string makeTempDir(const char* name) {
+        std::string pattern = std::string("/tmp/") + name + ".XXXXXX";
+        std::vector<char> path(pattern.begin(), pattern.end());
+        path.push_back('\0');
+        CHECK(mkdtemp(path.data()) != nullptr);
+        return path.data();
+    }
+
+    inline void removeDir(const std::string& dir) {
+        std::string command = "rm -rf '" + dir + "'";
+        if (system(command.c_str()) != 0) {
+            fprintf(stderr, "无法删除 %s\n", dir.c_str());
+        }
+    }
+
+    inline double elapsedMs(std::chrono::steady_clock::time_point since) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+    }
+}
+
+#endif //ANDROIDPLAYER_TESTUTIL_H